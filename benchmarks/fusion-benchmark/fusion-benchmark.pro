@@ -0,0 +1,20 @@
+TEMPLATE = app
+
+QT = core
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS -= -O2
+QMAKE_CXXFLAGS_RELEASE -= -O2
+
+QMAKE_CXXFLAGS += -O3
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+#Same fusion core and precision flags as the plugin
+include(../../src/imu-core.pri)
+
+#Command line parsing shared with the other tools
+include(../../tools/common/tool-options.pri)
+
+SOURCES += src/main.cpp
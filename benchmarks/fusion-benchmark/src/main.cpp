@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "FixedExtendedKalmanFilter.h"
+#include "IMUFusion.h"
+#include "IMUFusionBatch.h"
+#include "SampleMerger.h"
+#include "SensorLog.h"
+#include "ToolOptions.h"
+
+//Every heap allocation of the process goes through here so that steps can be checked to be allocation free
+static std::atomic<unsigned long long> allocations(0);
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if(ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+//Latency distribution and allocations of one step
+class Profile{
+
+public:
+
+    Profile(char const* name, std::size_t capacity) :
+        name(name),
+        allocs(0)
+    {
+        latencies.reserve(capacity);
+    }
+
+    template<typename Step> void time(Step step){
+        unsigned long long before = allocations;
+        Clock::time_point start = Clock::now();
+        step();
+        Clock::time_point end = Clock::now();
+        allocs += allocations - before;
+        latencies.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    double percentile(double p) const {
+        std::vector<double> sorted(latencies);
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[std::min(sorted.size() - 1, (std::size_t)(p*sorted.size()))];
+    }
+
+    void print() const {
+        if(latencies.empty()){
+            std::printf("%-28s %9d\n", name, 0);
+            return;
+        }
+        double sum = 0;
+        for(double latency : latencies)
+            sum += latency;
+        std::printf("%-28s %9zu %9.0f %9.0f %9.0f %9.0f %11.3f\n", name, latencies.size(),
+            sum/latencies.size(), percentile(0.5), percentile(0.99), percentile(1.0), allocs/(double)latencies.size());
+    }
+
+    static void printHeader(){
+        std::printf("%-28s %9s %9s %9s %9s %9s %11s\n", "step", "calls", "mean ns", "p50 ns", "p99 ns", "max ns", "allocs/call");
+    }
+
+private:
+
+    char const* name;
+    std::vector<double> latencies;
+    unsigned long long allocs;
+};
+
+//Gyroscope at 200 Hz, accelerometer at 100 Hz and magnetometer at 50 Hz, in Qt Sensors units, with a slow wobble and noise
+static std::vector<IMUFusion::Sample> syntheticStream(double seconds, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<IMUFusion::Sample> samples;
+
+    const quint64 start = 1000000;
+    const quint64 end = start + (quint64)(seconds*1000000);
+    for(quint64 t = start; t < end; t += 5000){
+        double phase = (t - start)*1e-6;
+        IMUFusion::Sample sample;
+        sample.timestamp = t;
+
+        sample.type = IMUFusion::Sample::GYROSCOPE;
+        sample.x = 30*std::sin(0.7*phase) + 0.5*noise(random);
+        sample.y = 20*std::cos(1.1*phase) + 0.5*noise(random);
+        sample.z = 10*std::sin(0.3*phase) + 0.5*noise(random);
+        samples.push_back(sample);
+
+        if((t - start) % 10000 == 0){
+            sample.type = IMUFusion::Sample::ACCELEROMETER;
+            sample.x = 2*std::sin(0.7*phase) + 0.05*noise(random);
+            sample.y = 2*std::cos(1.1*phase) + 0.05*noise(random);
+            sample.z = 9.81 + 0.05*noise(random);
+            samples.push_back(sample);
+        }
+
+        if((t - start) % 20000 == 0){
+            sample.type = IMUFusion::Sample::MAGNETOMETER;
+            sample.x = 20e-6 + 0.5e-6*noise(random);
+            sample.y = 0.5e-6*noise(random);
+            sample.z = -40e-6 + 0.5e-6*noise(random);
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+//Reads a sensor log in the order the fusion core would see it, i.e after merging
+static bool recordedStream(QString const& fileName, std::vector<IMUFusion::Sample>& samples)
+{
+    SensorLogReader reader;
+    if(!reader.open(fileName))
+        return false;
+
+    SampleMerger merger;
+    IMUFusion::Sample sample;
+    for(quint64 i = 0; i < reader.size(); i++){
+        merger.push(reader.at(i));
+        while(merger.pop(sample))
+            samples.push_back(sample);
+    }
+    merger.setGating(IMUFusion::Sample::GYROSCOPE, false);
+    merger.setGating(IMUFusion::Sample::ACCELEROMETER, false);
+    while(merger.pop(sample))
+        samples.push_back(sample);
+    return !samples.empty();
+}
+
+//Drives a stream through a fusion core of the given precision and times each step of each sample on a copy of the core, about to take the sample
+template<typename Scalar, typename CovScalar = Scalar> class FusionBenchmark{
+
+public:
+
+    typedef BasicIMUFusion<Scalar, CovScalar> Fusion;
+
+    FusionBenchmark(std::vector<IMUFusionBase::Sample> const& samples, IMUFusionBase::Parameters const& params) :
+        samples(samples),
+        params(params),
+        calculateProcess("calculateProcess", samples.size()),
+        predict("predictLeadingBlock<4>", samples.size()),
+        calculateObservation("calculateObservation", samples.size()),
+        correct(params.measurementUpdate == IMUFusion::FULL_UPDATE ? "correct" :
+            params.measurementUpdate == IMUFusion::SEQUENTIAL_UPDATE ? "correctSequential" : "correct/correctLeadingRows<3>", samples.size()),
+        calculateOutput("calculateOutput", samples.size()),
+        updateDisplacement("updateDisplacement", samples.size()),
+        processSample("processSample", samples.size())
+    {}
+
+    void run(){
+
+        //No startup so that every step does its full work from the first sample
+        Fusion fusion(0);
+        fusion.setParameters(params);
+
+        for(auto const& sample : samples){
+            if(sample.type == IMUFusion::Sample::GYROSCOPE && fusion.lastGyroTimestamp > 0 && sample.timestamp > fusion.lastGyroTimestamp){
+                Fusion f = fusion;
+                const qreal degToRad = (qreal)M_PI/180.0f;
+                f.wDeltaT = ((qreal)(sample.timestamp - f.lastGyroTimestamp))/1000000.0f;
+                f.w = typename Fusion::Vector(sample.x*degToRad, sample.y*degToRad, sample.z*degToRad);
+                f.w_norm = (Scalar)cv::norm(f.w);
+
+                calculateProcess.time([&](){ f.calculateProcess(); });
+                predict.time([&](){ f.filter.template predictLeadingBlock<4>(f.process); });
+                f.filter.statePost = f.filter.statePre;
+                calculateOutput.time([&](){ f.calculateOutput(); });
+            }
+            else if(sample.type == IMUFusion::Sample::ACCELEROMETER && fusion.lastAccTimestamp > 0 && sample.timestamp > fusion.lastAccTimestamp){
+                Fusion f = fusion;
+                f.aDeltaT = ((qreal)(sample.timestamp - f.lastAccTimestamp))/1000000.0f;
+                f.a = typename Fusion::Vector(sample.x - params.a_bias(0), sample.y - params.a_bias(1), sample.z - params.a_bias(2));
+                f.a_norm = (Scalar)cv::norm(f.a);
+
+                bool magObserved = false;
+                calculateObservation.time([&](){ magObserved = f.calculateObservation(); });
+                correct.time([&](){
+                    if(params.measurementUpdate == IMUFusion::SEQUENTIAL_UPDATE)
+                        f.filter.correctSequential(f.observation, f.predictedObservation, magObserved ? 6 : 3);
+                    else if(params.measurementUpdate == IMUFusion::ACTIVE_ROWS_UPDATE && !magObserved)
+                        f.filter.template correctLeadingRows<3>(f.observation, f.predictedObservation);
+                    else
+                        f.filter.correct(f.observation, f.predictedObservation);
+                });
+                calculateOutput.time([&](){ f.calculateOutput(); });
+                updateDisplacement.time([&](){ f.updateDisplacement(); });
+            }
+
+            processSample.time([&](){ fusion.processSample(sample); });
+        }
+    }
+
+    void print() const {
+        calculateProcess.print();
+        predict.print();
+        calculateObservation.print();
+        correct.print();
+        calculateOutput.print();
+        updateDisplacement.print();
+        processSample.print();
+    }
+
+private:
+
+    std::vector<IMUFusionBase::Sample> const& samples;
+    IMUFusionBase::Parameters params;
+
+    Profile calculateProcess;
+    Profile predict;
+    Profile calculateObservation;
+    Profile correct;
+    Profile calculateOutput;
+    Profile updateDisplacement;
+    Profile processSample;
+};
+
+//Times the filter steps alone with the given scalar types, on a fixed rotation and random positive definite covariance
+template<typename Scalar, typename CovScalar = Scalar> static void benchmarkFilter(char const* scalarName, int iterations)
+{
+    typedef FixedExtendedKalmanFilter<7, 6, Scalar, CovScalar> Filter;
+    Filter filter;
+
+    const Scalar q[4] = {0.9238795f, 0.0f, 0.3826834f, 0.0f};
+    const Scalar w[3] = {0.3f, -1.2f, 0.7f};
+    const Scalar dt = 0.005f;
+    const Scalar g = 9.81f;
+
+    filter.transitionMatrix = Filter::StateMatrix::zeros();
+    for(int i = 0; i < 4; i++)
+        filter.transitionMatrix(i,i) = 1.0f;
+    filter.transitionMatrix(0,1) = -0.5f*dt*w[0];   filter.transitionMatrix(0,2) = -0.5f*dt*w[1];   filter.transitionMatrix(0,3) = -0.5f*dt*w[2];
+    filter.transitionMatrix(1,0) = +0.5f*dt*w[0];   filter.transitionMatrix(1,2) = +0.5f*dt*w[2];   filter.transitionMatrix(1,3) = -0.5f*dt*w[1];
+    filter.transitionMatrix(2,0) = +0.5f*dt*w[1];   filter.transitionMatrix(2,1) = -0.5f*dt*w[2];   filter.transitionMatrix(2,3) = +0.5f*dt*w[0];
+    filter.transitionMatrix(3,0) = +0.5f*dt*w[2];   filter.transitionMatrix(3,1) = +0.5f*dt*w[1];   filter.transitionMatrix(3,2) = -0.5f*dt*w[0];
+    for(int i = 4; i < 7; i++)
+        for(int j = 0; j < 4; j++)
+            filter.transitionMatrix(i,j) = 2*q[(i + j) % 4];
+
+    typename Filter::StateMatrix M;
+    for(int i = 0; i < 7*7; i++)
+        M.val[i] = std::rand()/(CovScalar)RAND_MAX - 0.5f;
+    filter.errorCovPost = M*M.t() + Filter::StateMatrix::eye();
+    filter.processNoiseCov = Filter::StateMatrix::eye()*(CovScalar)(1e-4f*dt);
+    filter.statePost = typename Filter::StateVector(q[0], q[1], q[2], q[3], 0.0f, 0.0f, 0.0f);
+
+    //Observation Jacobian of IMUFusion::calculateObservation() at q
+    filter.observationMatrix = Filter::ObservationMatrix::zeros();
+    const Scalar H[6][4] = {
+        {-2*g*q[2], +2*g*q[3], -2*g*q[0], +2*g*q[1]},
+        {+2*g*q[1], +2*g*q[0], +2*g*q[3], +2*g*q[2]},
+        {+2*g*q[0], -2*g*q[1], -2*g*q[2], +2*g*q[3]},
+        {+2*q[3],   +2*q[2],   +2*q[1],   +2*q[0]},
+        {+2*q[0],   -2*q[1],   +2*q[2],   -2*q[3]},
+        {-2*q[1],   -2*q[0],   +2*q[3],   +2*q[2]}};
+    for(int i = 0; i < 6; i++)
+        for(int j = 0; j < 4; j++)
+            filter.observationMatrix(i,j) = H[i][j];
+    filter.observationNoiseCov = Filter::ObservationCovMatrix::eye();
+    const typename Filter::ObservationVector observation(0.1f, -0.2f, 9.8f, 0.0f, 1.0f, 0.0f);
+    const typename Filter::ObservationVector predictedObservation(0.0f, 0.0f, 9.81f, 0.05f, 0.99f, 0.0f);
+
+    Profile densePredict("predict", iterations);
+    Profile blockPredict("predictLeadingBlock<4>", iterations);
+    Profile denseCorrect("correct", iterations);
+    Profile leadingCorrect("correctLeadingRows<3>", iterations);
+    Profile sequentialCorrect("correctSequential", iterations);
+
+    //All steps of an iteration start from the same state, the last correction feeds the next iteration
+    for(int i = 0; i < iterations; i++){
+        typename Filter::StateVector process = filter.statePost;
+        densePredict.time([&](){ filter.predict(process); });
+        blockPredict.time([&](){ filter.template predictLeadingBlock<4>(process); });
+        denseCorrect.time([&](){ filter.correct(observation, predictedObservation); });
+        leadingCorrect.time([&](){ filter.template correctLeadingRows<3>(observation, predictedObservation); });
+        sequentialCorrect.time([&](){ filter.correctSequential(observation, predictedObservation); });
+    }
+
+    std::printf("\nfilter steps, %s:\n", scalarName);
+    Profile::printHeader();
+    densePredict.print();
+    blockPredict.print();
+    denseCorrect.print();
+    leadingCorrect.print();
+    sequentialCorrect.print();
+}
+
+//Times the fusion steps and the throughput of full streams through a fusion core of the given precision
+template<typename Scalar, typename CovScalar = Scalar> static void benchmarkFusion(char const* precisionName,
+    std::vector<IMUFusionBase::Sample> const& samples, IMUFusionBase::Parameters const& params, Profile const& empty, int repeat, double recorded)
+{
+    //Per step latencies
+    FusionBenchmark<Scalar, CovScalar> benchmark(samples, params);
+    benchmark.run();
+    std::printf("\nfusion steps, %s:\n", precisionName);
+    Profile::printHeader();
+    empty.print();
+    benchmark.print();
+
+    //Throughput without the per call clocks
+    unsigned long long before = allocations;
+    Clock::time_point start = Clock::now();
+    unsigned long long published = 0;
+    for(int i = 0; i < repeat; i++){
+        BasicIMUFusion<Scalar, CovScalar> fusion(0);
+        fusion.setParameters(params);
+        for(auto const& sample : samples)
+            if(fusion.processSample(sample))
+                published++;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    unsigned long long allocs = allocations - before;
+    std::printf("\nsamples/s:          %.0f\n", samples.size()*repeat/seconds);
+    std::printf("real time factor:   %.0fx\n", recorded*repeat/seconds);
+    std::printf("allocs/sample:      %.3f\n", allocs/(double)(samples.size()*repeat));
+    std::printf("published states:   %llu\n", published/repeat);
+}
+
+//Throughput of the scalar core of the given precision as configured like a batch lane, the baseline of the batch speedups
+template<typename Scalar, typename CovScalar = Scalar> static double scalarLaneThroughput(
+    std::vector<IMUFusionBase::Sample> const& samples, IMUFusionBase::Parameters params, int repeat)
+{
+    params.engine = IMUFusionBase::QUATERNION_ENGINE;
+    params.measurementUpdate = IMUFusionBase::SEQUENTIAL_UPDATE;
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < repeat; i++){
+        BasicIMUFusion<Scalar, CovScalar> fusion(0);
+        fusion.setParameters(params);
+        for(auto const& sample : samples)
+            fusion.processSample(sample);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return samples.size()*repeat/seconds;
+}
+
+//Largest difference of the states, relative to their magnitude above 1
+template<typename State> static double stateDifference(State const& lhs, State const& rhs)
+{
+    double diff = 0;
+    auto compare = [&](double l, double r){ diff = std::max(diff, std::fabs(l - r)/std::max(1.0, std::fabs(l))); };
+    for(int i = 0; i < 4; i++)
+        compare(lhs.rotation(i), rhs.rotation(i));
+    for(int i = 0; i < 3; i++){
+        compare(lhs.linearAcceleration(i), rhs.linearAcceleration(i));
+        compare(lhs.velocity(i), rhs.velocity(i));
+        compare(lhs.dispTranslation(i), rhs.dispTranslation(i));
+    }
+    return diff;
+}
+
+//Largest state difference between lane 0 of the batch, alone in it, and the scalar core configured like a lane, over the stream; infinite if they disagree on which samples publish
+template<int N, typename Scalar, typename CovScalar = Scalar> static double batchDisagreement(
+    std::vector<IMUFusionBase::Sample> const& samples, IMUFusionBase::Parameters params)
+{
+    params.engine = IMUFusionBase::QUATERNION_ENGINE;
+    params.measurementUpdate = IMUFusionBase::SEQUENTIAL_UPDATE;
+    BasicIMUFusion<Scalar, CovScalar> fusion(0);
+    fusion.setParameters(params);
+    IMUFusionBatch<N, Scalar, CovScalar> batch(0);
+    batch.setParameters(0, params);
+
+    IMUFusionBase::Sample lanes[N];
+    bool present[N] = {true};
+    double diff = 0;
+    for(auto const& sample : samples){
+        lanes[0] = sample;
+        bool changed = fusion.processSample(sample);
+        if(changed != (bool)(batch.processSamples(lanes, present) & 1))
+            return INFINITY;
+        diff = std::max(diff, stateDifference(fusion.getState(), batch.getState(0)));
+    }
+    return diff;
+}
+
+//Throughput of N copies of the stream through the batched fusion of the given precision, one per lane, its speedup over the scalar core and its disagreement with it
+template<int N, typename Scalar, typename CovScalar = Scalar> static bool benchmarkBatch(char const* precisionName,
+    std::vector<IMUFusionBase::Sample> const& samples, IMUFusionBase::Parameters const& params, int repeat)
+{
+    IMUFusionBase::Sample lanes[N];
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < repeat; i++){
+        IMUFusionBatch<N, Scalar, CovScalar> batch(0);
+        for(int l = 0; l < N; l++)
+            batch.setParameters(l, params);
+        for(auto const& sample : samples){
+            for(int l = 0; l < N; l++)
+                lanes[l] = sample;
+            batch.processSamples(lanes);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double throughput = samples.size()*repeat*N/seconds;
+    double diff = batchDisagreement<N, Scalar, CovScalar>(samples, params);
+    std::printf("%-28s %9d %12.0f %9.2fx %12.3g\n", precisionName, N, throughput,
+        throughput/scalarLaneThroughput<Scalar, CovScalar>(samples, params, repeat), diff);
+
+    //Rounding only, a tolerance far above it still catches a batch kernel that does not follow the core anymore
+    const double tolerance = std::is_same<Scalar, double>::value ? 1e-9 : 1e-2;
+    if(!(diff <= tolerance)){
+        std::fprintf(stderr, "Batched %s lanes differ from the core by %g, more than %g\n", precisionName, diff, tolerance);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the steps of the fusion hot path on a synthetic or recorded stream");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Sensor log recorded with the recordFile property of IMU, a synthetic stream if not given", "[log]");
+    QCommandLineOption secondsOption(QStringList() << "d" << "duration", "Length of the synthetic stream in seconds", "seconds", "60");
+    QCommandLineOption updateOption(QStringList() << "u" << "measurement-update", "Measurement update: full, active or sequential", "mode", "active");
+    QCommandLineOption integratorOption(QStringList() << "i" << "integrator", "Integrator: first-order, exponential, coning or rk4", "integrator", "first-order");
+    QCommandLineOption iterationsOption(QStringList() << "k" << "iterations", "Iterations of the filter steps alone", "count", "100000");
+    QCommandLineOption repeatOption(QStringList() << "r" << "repeat", "Untimed passes over the stream for the throughput", "count", "10");
+    parser.addOption(secondsOption);
+    parser.addOption(updateOption);
+    parser.addOption(integratorOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(repeatOption);
+    parser.process(app);
+
+    IMUFusion::Parameters params;
+    if(!ToolOptions::applyMeasurementUpdate(parser.value(updateOption), params) ||
+            !ToolOptions::applyIntegrator(parser.value(integratorOption), params))
+        return 1;
+
+    std::vector<IMUFusion::Sample> samples;
+    QString source;
+    if(parser.positionalArguments().size() > 0){
+        source = parser.positionalArguments()[0];
+        if(!recordedStream(source, samples)){
+            std::fprintf(stderr, "Could not read any samples from %s\n", qPrintable(source));
+            return 1;
+        }
+    }
+    else{
+        source = "synthetic";
+        samples = syntheticStream(std::max(1.0, parser.value(secondsOption).toDouble()), 1);
+    }
+    double recorded = (samples.back().timestamp - samples.front().timestamp)*1e-6;
+
+    std::printf("stream:             %s, %.1f s, %zu samples\n", qPrintable(source), recorded, samples.size());
+    std::printf("measurement update: %s\n", qPrintable(parser.value(updateOption)));
+    std::printf("integrator:         %s\n", qPrintable(parser.value(integratorOption)));
+
+    //Clock overhead, included in every latency below
+    Profile empty("(clock overhead)", 10000);
+    for(int i = 0; i < 10000; i++)
+        empty.time([](){});
+
+    int repeat = std::max(1, parser.value(repeatOption).toInt());
+    benchmarkFusion<double>("double", samples, params, empty, repeat, recorded);
+    benchmarkFusion<float>("float", samples, params, empty, repeat, recorded);
+    benchmarkFusion<float, double>("float, double covariance", samples, params, empty, repeat, recorded);
+
+    //Batched lanes, the float lanes are twice as many per vector register; speedup over the scalar core in the lane configuration
+    std::printf("\nbatched fusion:\n");
+    std::printf("%-28s %9s %12s %10s %12s\n", "precision", "lanes", "samples/s", "speedup", "max diff");
+    bool agree = benchmarkBatch<4, double>("double", samples, params, repeat);
+    agree &= benchmarkBatch<8, double>("double", samples, params, repeat);
+    agree &= benchmarkBatch<8, float>("float", samples, params, repeat);
+    agree &= benchmarkBatch<16, float>("float", samples, params, repeat);
+    agree &= benchmarkBatch<8, float, double>("float, double covariance", samples, params, repeat);
+
+    //Filter steps alone, in all precisions regardless of qreal
+    int iterations = std::max(1, parser.value(iterationsOption).toInt());
+    benchmarkFilter<float>("float", iterations);
+    benchmarkFilter<double>("double", iterations);
+    benchmarkFilter<float, double>("float, double covariance", iterations);
+    return agree ? 0 : 1;
+}
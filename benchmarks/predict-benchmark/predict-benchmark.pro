@@ -0,0 +1,20 @@
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS -= -O2
+QMAKE_CXXFLAGS_RELEASE -= -O2
+
+QMAKE_CXXFLAGS += -O3
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+INCLUDEPATH += ../../src
+
+HEADERS += \
+    ../../src/FixedExtendedKalmanFilter.h \
+    ../../src/SymmetricSolver.h
+
+SOURCES += src/main.cpp
+
+LIBS += -lopencv_core
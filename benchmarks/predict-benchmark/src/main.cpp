@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "FixedExtendedKalmanFilter.h"
+
+typedef FixedExtendedKalmanFilter<7, 6, double> Filter;
+
+//Fills the transition matrix in the same way IMU::calculateProcess() does
+static void fillTransition(Filter::StateMatrix& F, double const* q, double const* w, double const* a, double dt)
+{
+    F = Filter::StateMatrix::zeros();
+    for(int i = 0; i < 4; i++)
+        F(i,i) = 1.0;
+
+    F(0,1) = -0.5*dt*w[0];  F(0,2) = -0.5*dt*w[1];  F(0,3) = -0.5*dt*w[2];
+    F(1,0) = +0.5*dt*w[0];  F(1,2) = +0.5*dt*w[2];  F(1,3) = -0.5*dt*w[1];
+    F(2,0) = +0.5*dt*w[1];  F(2,1) = -0.5*dt*w[2];  F(2,3) = +0.5*dt*w[0];
+    F(3,0) = +0.5*dt*w[2];  F(3,1) = +0.5*dt*w[1];  F(3,2) = -0.5*dt*w[0];
+
+    F(4,0) = 2*(+q[0]*a[0] - q[3]*a[1] + q[2]*a[2]); F(4,1) = 2*(+q[1]*a[0] + q[2]*a[1] + q[3]*a[2]);
+    F(4,2) = 2*(-q[2]*a[0] + q[1]*a[1] + q[0]*a[2]); F(4,3) = 2*(-q[3]*a[0] - q[0]*a[1] + q[1]*a[2]);
+    F(5,0) = 2*(+q[3]*a[0] + q[0]*a[1] - q[1]*a[2]); F(5,1) = 2*(+q[2]*a[0] - q[1]*a[1] - q[0]*a[2]);
+    F(5,2) = 2*(+q[1]*a[0] + q[2]*a[1] + q[3]*a[2]); F(5,3) = 2*(+q[0]*a[0] - q[3]*a[1] + q[2]*a[2]);
+    F(6,0) = 2*(-q[2]*a[0] + q[1]*a[1] + q[0]*a[2]); F(6,1) = 2*(+q[3]*a[0] + q[0]*a[1] - q[1]*a[2]);
+    F(6,2) = 2*(-q[0]*a[0] + q[3]*a[1] - q[2]*a[2]); F(6,3) = 2*(+q[1]*a[0] + q[2]*a[1] + q[3]*a[2]);
+}
+
+//Initializes both filters with the same transition, noise and a random symmetric positive definite covariance
+static void setup(Filter& dense, Filter& block)
+{
+    const double q[4] = {0.9238795, 0.0, 0.3826834, 0.0};
+    const double w[3] = {0.3, -1.2, 0.7};
+    const double a[3] = {0.4, 0.1, 9.9};
+    const double dt = 0.0025;
+
+    fillTransition(dense.transitionMatrix, q, w, a, dt);
+
+    Filter::StateMatrix M;
+    for(int i = 0; i < 7*7; i++)
+        M.val[i] = std::rand()/(double)RAND_MAX - 0.5;
+    dense.errorCovPost = M*M.t() + Filter::StateMatrix::eye();
+
+    dense.processNoiseCov = Filter::StateMatrix::eye()*(1e-4*dt);
+    dense.statePost = Filter::StateVector(q[0], q[1], q[2], q[3], 0.0, 0.0, 0.0);
+
+    block = dense;
+}
+
+template<typename Step> static double nanosecondsPerStep(Filter& filter, Step step, int iterations)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+        step(filter);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()/iterations;
+}
+
+static void densePredict(Filter& filter){ filter.predict(filter.statePost); }
+static void blockPredict(Filter& filter){ filter.predictLeadingBlock<4>(filter.statePost); }
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if(iterations <= 0)
+        iterations = 1000000;
+
+    Filter dense, block;
+
+    //Both paths must agree
+    setup(dense, block);
+    dense.predict(dense.statePost);
+    block.predictLeadingBlock<4>(block.statePost);
+    double maxError = 0;
+    for(int i = 0; i < 7*7; i++)
+        maxError = std::max(maxError, std::abs(dense.errorCovPre.val[i] - block.errorCovPre.val[i]));
+
+    //Warm up, then time
+    setup(dense, block);
+    nanosecondsPerStep(dense, densePredict, iterations/10);
+    nanosecondsPerStep(block, blockPredict, iterations/10);
+    setup(dense, block);
+    double denseNs = nanosecondsPerStep(dense, densePredict, iterations);
+    double blockNs = nanosecondsPerStep(block, blockPredict, iterations);
+
+    //Multiplications in F*P*Ft
+    const int DP = 7, NB = 4;
+    const int denseMuls = 2*DP*DP*DP;
+    const int blockMuls = DP*NB*NB + DP*(DP + 1)/2*NB;
+
+    std::printf("iterations:         %d\n", iterations);
+    std::printf("max |dense - block|: %g\n", maxError);
+    std::printf("dense predict:      %8.1f ns/step  %4d mul/step\n", denseNs, denseMuls);
+    std::printf("block predict:      %8.1f ns/step  %4d mul/step\n", blockNs, blockMuls);
+    std::printf("speedup:            %8.2fx         %4.2fx fewer mul\n", denseNs/blockNs, denseMuls/(double)blockMuls);
+
+    //Keep the results observable
+    return dense.errorCovPost(0,0) + block.errorCovPost(0,0) > 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+TEMPLATE = lib
+TARGET = imucore
+
+QT = core
+
+CONFIG += staticlib c++11
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS -= -O2
+QMAKE_CXXFLAGS_RELEASE -= -O2
+
+QMAKE_CXXFLAGS += -O3
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+#Same fusion core as the plugin without QML or Qt Sensors, see src/imu-core.pri for the precision flags
+include(../src/imu-core.pri)
+
+#Install library and headers, link with -limucore -lopencv_core and QtCore
+unix {
+    headers.files = $$HEADERS
+    headers.path = $$[QT_INSTALL_HEADERS]/imucore
+    target.path = $$[QT_INSTALL_LIBS]
+    INSTALLS += target headers
+}
@@ -12,23 +12,33 @@ QMAKE_CXXFLAGS_RELEASE -= -O2
 QMAKE_CXXFLAGS += -O3
 QMAKE_CXXFLAGS_RELEASE += -O3
 
+#Per sample logging is compiled out of release builds, add CONFIG+=imu_sample_logging to keep it
+CONFIG(release, debug|release):!imu_sample_logging: DEFINES += IMU_NO_SAMPLE_LOGGING
+
 TARGET = $$qtLibraryTarget($$TARGET)
 uri = IMU
 
+#Fusion core, see src/imu-core.pri for CONFIG+=imu_float and CONFIG+=imu_float_covariance
+include(src/imu-core.pri)
+
 HEADERS += \
-    src/ExtendedKalmanFilter.h \
+    src/IMUStats.h \
+    src/SensorHub.h \
     src/IMU.h \
+    src/IMUView.h \
+    src/IMUHistory.h \
     src/AccelerometerBiasEstimator.h \
     src/IMUPlugin.h
 
 SOURCES += \
-    src/ExtendedKalmanFilter.cpp \
+    src/IMUStats.cpp \
+    src/SensorHub.cpp \
     src/IMU.cpp \
+    src/IMUView.cpp \
+    src/IMUHistory.cpp \
     src/AccelerometerBiasEstimator.cpp \
     src/IMUPlugin.cpp
 
-LIBS += -lopencv_core
-
 android {
 
     #Enable automatic NEON vectorization
@@ -11,7 +11,7 @@ Window {
 
     IMU{
         id: imu
-        accBias: Qt.vector3d(0.397, -0.008, -0.005)
+        engine: IMU.ErrorStateBiasEngine
 
         //Adds the rotation described by q1 to the one described by q2
         function qmul(q1,q2){
@@ -47,16 +47,16 @@ Window {
         //Adds the latest displacement to poses and resets the displacement for next interval
         function addDisplacement(){
 
-            //Device
-            targetTranslation = Qt.vector3d(0,0,0);
-            targetRotation = Qt.quaternion(1,0,0,0);
+            //Device is target 0, point on device is target 1; each has linear, angular and floor vector entries
+            var disp = getTargetDisplacements();
 
-            var deltaTDevice = rotatedVector(r_C_G, getLinearDisplacement());
+            //Device
+            var deltaTDevice = rotatedVector(r_C_G, disp[0]);
             deviceTrans.x += deltaTDevice.x;
             deviceTrans.y += deltaTDevice.y;
             deviceTrans.z += deltaTDevice.z;
 
-            deviceRot = qmul(deviceRot, getAngularDisplacement());
+            deviceRot = qmul(deviceRot, disp[1]);
             var norm = deviceRot.scalar*deviceRot.scalar + deviceRot.x*deviceRot.x + deviceRot.y*deviceRot.y + deviceRot.z*deviceRot.z;
             deviceRot.scalar /= norm;
             deviceRot.x /= norm;
@@ -64,15 +64,12 @@ Window {
             deviceRot.z /= norm;
 
             //Point on device
-            targetTranslation = pointR;
-            targetRotation = pointOmega;
-
-            var deltaTPoint = rotatedVector(r_C_G, rotatedVector(pointOmega, getLinearDisplacement()));
+            var deltaTPoint = rotatedVector(r_C_G, rotatedVector(pointOmega, disp[3]));
             pointTrans.x += deltaTPoint.x;
             pointTrans.y += deltaTPoint.y;
             pointTrans.z += deltaTPoint.z;
 
-            pointRot = qmul(pointRot, getAngularDisplacement());
+            pointRot = qmul(pointRot, disp[4]);
             norm = pointRot.scalar*pointRot.scalar + pointRot.x*pointRot.x + pointRot.y*pointRot.y + pointRot.z*pointRot.z;
             pointRot.scalar /= norm;
             pointRot.x /= norm;
@@ -84,6 +81,11 @@ Window {
             r_C_G = rotQuat
         }
 
+        Component.onCompleted: {
+            addTarget(Qt.vector3d(0,0,0), Qt.quaternion(1,0,0,0));
+            addTarget(pointR, pointOmega);
+        }
+
         //Describes the static translation of the local point in device frame
         property vector3d pointR: Qt.vector3d(0,0.076,0)
 
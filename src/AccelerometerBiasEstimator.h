@@ -32,7 +32,7 @@
 #include<QtSensors/QAccelerometerReading>
 #include<QVector3D>
 
-#include"ExtendedKalmanFilter.h"
+#include"AccelerometerBiasFilter.h"
 
 class AccelerometerBiasEstimator : public QQuickItem {
 Q_OBJECT
@@ -118,7 +118,7 @@ private:
     /**
      * @brief Attempts to open accelerometer with given id
      *
-     * If successful, sets rate to maximum and starts sensor
+     * If successful, releases the previous one; the sensor is shared with its other consumers through SensorHub
      *
      * @param id Identifier of the sensor to be opened
      *
@@ -126,31 +126,11 @@ private:
      */
     bool openAcc(QByteArray const& id);
 
-    /**
-     * @brief Calculates and records predicted observation values
-     *
-     * Calculates the following:
-     * Observation value z(k)
-     * Predicted observation value h(x'(k|k+1))
-     * Observation matrix H(k)
-     */
-    void calculateObservation();
-
-    static const int CV_TYPE;       ///< CV_64F or CV_32f
-
     QString accId;                  ///< Accelerometer identifier, empty string when not open
-    QAccelerometer* acc;            ///< Accelerometer sensor, nullptr when not open
-    quint64 lastAccTimestamp;       ///< Most recent accelerometer measurement timestamp
-
-    ExtendedKalmanFilter filter;    ///< Filter that estimates current tilt and linear acceleration in ground frame
-
-    cv::Mat observation;            ///< Temporary matrix to hold the gravity observation, assumed to be accelerometer value
-    cv::Mat predictedObservation;   ///< Temporary matrix to hold what we expect gravity vector is based on rotation
+    QAccelerometer* acc;            ///< Accelerometer sensor shared through SensorHub, nullptr when not open
 
-    qreal R_g_k_0;                  ///< Gravity observation constant noise coefficient
-    qreal R_g_k_g;                  ///< Gravity observation gravity norm dependent noise coefficient
+    AccelerometerBiasFilter filter; ///< Estimates the bias from the readings
 
-    QVector3D a;                    ///< Latest acceleration vector in local frame in m/s^2
     QVector3D bias;                 ///< Accelerometer bias in local frame in m/s^2
     qreal covTrace;                 ///< Trace of the covariance matrix estimate
 };
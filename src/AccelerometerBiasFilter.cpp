@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file AccelerometerBiasFilter.cpp
+ * @brief Implementation of the headless accelerometer bias estimation
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"AccelerometerBiasFilter.h"
+
+#include<cmath>
+
+AccelerometerBiasFilter::AccelerometerBiasFilter() :
+    R_g_k_0(1e+3f),  //This depends on the coefficient below
+    R_g_k_g(1e+6f),  //This depends on accelerometer sensor limits, typically 2g
+    lastAccTimestamp(0),
+    a(0.0f, 0.0f, 0.0f)
+{
+    //Just do assumptions for initial values
+    filter.statePre =   Filter::StateVector(0.0f, 0.0f, 0.0f);
+    filter.statePost =  Filter::StateVector(0.0f, 0.0f, 0.0f);
+
+    observation =           Filter::ObservationVector(0.0f, 0.0f, 0.0f);
+    predictedObservation =  Filter::ObservationVector(0.0f, 0.0f, 0.0f);
+
+    filter.transitionMatrix = Filter::StateMatrix(
+            1.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,
+            0.0f,   0.0f,   1.0f);
+
+    filter.observationMatrix = Filter::ObservationMatrix(
+            1.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,
+            0.0f,   0.0f,   1.0f);
+
+    filter.processNoiseCov = Filter::StateMatrix(
+            1.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,
+            0.0f,   0.0f,   1.0f);
+
+    filter.errorCovPre = Filter::StateMatrix(
+            1.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,
+            0.0f,   0.0f,   1.0f);
+
+    filter.errorCovPost = Filter::StateMatrix(
+            1.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,
+            0.0f,   0.0f,   1.0f);
+}
+
+bool AccelerometerBiasFilter::push(quint64 timestamp, qreal x, qreal y, qreal z)
+{
+    bool updated = false;
+
+    if(lastAccTimestamp > 0)
+        if(((qreal)(timestamp - lastAccTimestamp))/1000000.0f > 0){
+            a = Vector(x, y, z); //Linear acceleration in m/s^2
+
+            filter.predict(filter.statePost);
+            calculateObservation();
+            filter.correct(observation, predictedObservation);
+            updated = true;
+        }
+
+    lastAccTimestamp = timestamp;
+    return updated;
+}
+
+void AccelerometerBiasFilter::calculateObservation()
+{
+    //cv::Matx data pointers
+    qreal* statePrePtr = filter.statePre.val;
+    qreal* observationPtr = observation.val;
+    qreal* predictedObservationPtr = predictedObservation.val;
+
+    qreal ax = a(0);
+    qreal ay = a(1);
+    qreal az = a(2);
+    const qreal g = 9.81f;
+
+    //We assume here that the device is lying completely flat so that only one axis feels gravity
+    if(ax > std::abs(ay) && ax > std::abs(az))
+        ax -= g;
+    else if(-ax > std::abs(ay) && -ax > std::abs(az))
+        ax += g;
+    else if(ay > std::abs(ax) && ay > std::abs(az))
+        ay -= g;
+    else if(-ay > std::abs(ax) && -ay > std::abs(az))
+        ay += g;
+    else if(az > std::abs(ax) && az > std::abs(ay))
+        az -= g;
+    else
+        az += g;
+
+    observationPtr[0] = ax;
+    observationPtr[1] = ay;
+    observationPtr[2] = az;
+    predictedObservationPtr[0] = statePrePtr[0];
+    predictedObservationPtr[1] = statePrePtr[1];
+    predictedObservationPtr[2] = statePrePtr[2];
+
+    qreal R = R_g_k_0 + R_g_k_g*std::fabs(g - cv::norm(a));
+    filter.observationNoiseCov(0,0) = R;
+    filter.observationNoiseCov(1,1) = R;
+    filter.observationNoiseCov(2,2) = R;
+}
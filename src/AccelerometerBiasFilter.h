@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file AccelerometerBiasFilter.h
+ * @brief Headless estimation of the accelerometer bias of a device lying flat
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef ACCELEROMETERBIASFILTER_H
+#define ACCELEROMETERBIASFILTER_H
+
+#include<QtGlobal>
+
+#include"FixedExtendedKalmanFilter.h"
+
+/**
+ * @brief Estimates the accelerometer bias from readings taken while the device lies flat on one of its axes
+ *
+ * The axis closest to the gravity vector is assumed to feel exactly g, everything else measured is bias.
+ */
+class AccelerometerBiasFilter{
+
+public:
+
+    typedef cv::Vec<qreal, 3> Vector;
+
+    /**
+     * @brief Creates a new filter with zero bias and unit covariance
+     */
+    AccelerometerBiasFilter();
+
+    /**
+     * @brief Updates the estimate with a new accelerometer reading
+     *
+     * @param timestamp Timestamp of the reading in microseconds
+     * @param x Reading along x axis in m/s^2
+     * @param y Reading along y axis in m/s^2
+     * @param z Reading along z axis in m/s^2
+     *
+     * @return Whether the estimate was updated, false for the first reading and readings that are not newer
+     */
+    bool push(quint64 timestamp, qreal x, qreal y, qreal z);
+
+    /**
+     * @brief Gets the latest estimated bias
+     *
+     * @return Latest estimated bias in local frame in m/s^2
+     */
+    Vector getBias() const { return Vector(filter.statePost(0), filter.statePost(1), filter.statePost(2)); }
+
+    /**
+     * @brief Gets the covariance matrix estimate trace
+     *
+     * @return Covariance matrix estimate trace
+     */
+    qreal getCovTrace() const { return filter.errorCovPost(0,0) + filter.errorCovPost(1,1) + filter.errorCovPost(2,2); }
+
+private:
+
+    /**
+     * @brief Calculates and records predicted observation values
+     *
+     * Calculates the following:
+     * Observation value z(k)
+     * Predicted observation value h(x'(k|k+1))
+     * Observation matrix H(k)
+     */
+    void calculateObservation();
+
+    typedef FixedExtendedKalmanFilter<3, 3, qreal> Filter;
+
+    Filter filter;                              ///< Filter that estimates the bias
+
+    Filter::ObservationVector observation;      ///< Temporary matrix to hold the gravity observation, assumed to be accelerometer value
+    Filter::ObservationVector predictedObservation; ///< Temporary matrix to hold what we expect gravity vector is based on rotation
+
+    qreal R_g_k_0;                  ///< Gravity observation constant noise coefficient
+    qreal R_g_k_g;                  ///< Gravity observation gravity norm dependent noise coefficient
+
+    quint64 lastAccTimestamp;       ///< Most recent accelerometer measurement timestamp
+    Vector a;                       ///< Latest acceleration vector in local frame in m/s^2
+};
+
+#endif /* ACCELEROMETERBIASFILTER_H */
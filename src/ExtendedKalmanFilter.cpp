@@ -25,9 +25,14 @@
 
 #include"ExtendedKalmanFilter.h"
 
-ExtendedKalmanFilter::ExtendedKalmanFilter() {}
-
-ExtendedKalmanFilter::ExtendedKalmanFilter(int dynamParams, int measureParams, int type)
+ExtendedKalmanFilter::ExtendedKalmanFilter() :
+    decompositionMethod(SymmetricSolver::CHOLESKY),
+    decompositionFallbacks(0)
+{}
+
+ExtendedKalmanFilter::ExtendedKalmanFilter(int dynamParams, int measureParams, int type) :
+    decompositionMethod(SymmetricSolver::CHOLESKY),
+    decompositionFallbacks(0)
 {
     init(dynamParams, measureParams, type);
 }
@@ -54,6 +59,7 @@ void ExtendedKalmanFilter::init(int DP, int MP, int type)
     temp3.create(MP, MP, type);
     temp4.create(MP, DP, type);
     temp5.create(MP, 1, type);
+    temp6.create(MP, MP, type);
 }
 
 cv::Mat const& ExtendedKalmanFilter::predict(cv::Mat const& process)
@@ -83,7 +89,7 @@ cv::Mat const& ExtendedKalmanFilter::correct(cv::Mat const& observation, cv::Mat
     cv::gemm(temp2, observationMatrix, 1, observationNoiseCov, 1, temp3, cv::GEMM_2_T);
 
     //temp4 = inv(temp3)*temp2 = K(k)t
-    cv::solve(temp3, temp2, temp4, cv::DECOMP_SVD);
+    solveInnovation();
 
     //K(k)
     gain = temp4.t();
@@ -100,3 +106,31 @@ cv::Mat const& ExtendedKalmanFilter::correct(cv::Mat const& observation, cv::Mat
     return statePost;
 }
 
+void ExtendedKalmanFilter::solveInnovation()
+{
+    //Factor a copy, temp3 is still needed if we fall back to SVD
+    temp3.copyTo(temp6);
+    temp2.copyTo(temp4);
+
+    bool solved = false;
+    if(decompositionMethod == SymmetricSolver::CHOLESKY){
+        if(temp3.type() == CV_64F)
+            solved = SymmetricSolver::cholesky((double*)temp6.ptr(), temp6.rows, (double*)temp4.ptr(), temp4.cols);
+        else
+            solved = SymmetricSolver::cholesky((float*)temp6.ptr(), temp6.rows, (float*)temp4.ptr(), temp4.cols);
+    }
+    else if(decompositionMethod == SymmetricSolver::LDLT){
+        if(temp3.type() == CV_64F)
+            solved = SymmetricSolver::ldlt((double*)temp6.ptr(), temp6.rows, (double*)temp4.ptr(), temp4.cols);
+        else
+            solved = SymmetricSolver::ldlt((float*)temp6.ptr(), temp6.rows, (float*)temp4.ptr(), temp4.cols);
+    }
+
+    //temp3 is not positive definite or is singular, or SVD is explicitly requested
+    if(!solved){
+        if(decompositionMethod != SymmetricSolver::SVD)
+            decompositionFallbacks++;
+        cv::solve(temp3, temp2, temp4, cv::DECOMP_SVD);
+    }
+}
+
@@ -54,6 +54,8 @@
 
 #include <opencv2/core.hpp>
 
+#include"SymmetricSolver.h"
+
 /**
  * @brief Standard EKF, see http://en.wikipedia.org/wiki/Extended_Kalman_filter
  */
@@ -113,13 +115,22 @@ public:
     cv::Mat statePost;              ///< Corrected state                                x'(k|k) := x'(k|k-1) + K(k)*(z(k) - h(x'(k|k-1)))
     cv::Mat errorCovPost;           ///< A posteriori error estimate covariance matrix  P(k|k) := (I - K(k)*H(k))*P(k|k-1)
 
+    SymmetricSolver::Method decompositionMethod;    ///< How temp3 = H(k)*P(k|k-1)*H(k)t + R(k) is inverted, CHOLESKY by default
+    unsigned int decompositionFallbacks;            ///< Number of times CHOLESKY or LDLT failed and SVD was used instead
+
 private:
 
+    /**
+     * @brief Calculates temp4 = inv(temp3)*temp2 with the chosen decomposition, falling back to SVD on failure
+     */
+    void solveInnovation();
+
     cv::Mat temp1;
     cv::Mat temp2;
     cv::Mat temp3;
     cv::Mat temp4;
     cv::Mat temp5;
+    cv::Mat temp6;
 };
 
 #endif /* EXTENDEDKALMANFILTER_H */
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FixedExtendedKalmanFilter.h
+ * @brief Extended Kalman filter with compile-time dimensions
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef FIXEDEXTENDEDKALMANFILTER_H
+#define FIXEDEXTENDEDKALMANFILTER_H
+
+#include <opencv2/core.hpp>
+
+#include"SymmetricSolver.h"
+
+/**
+ * @brief Standard EKF with dimensions known at compile time, see http://en.wikipedia.org/wiki/Extended_Kalman_filter
+ *
+ * Same algorithm and member layout as ExtendedKalmanFilter, but every matrix is a cv::Matx that lives inside
+ * the object. predict() and correct() therefore do no heap allocations, except when correct() has to fall back
+ * to SVD. ExtendedKalmanFilter remains the choice when the dimensions are only known at runtime.
+ *
+ * The state and observation vectors may be kept in a lower precision than the covariance, the Jacobians and the
+ * gain; the covariance update is where rounding accumulates, the vectors are recalculated at every step.
+ *
+ * @tparam DP Dimensionality of the state
+ * @tparam MP Dimensionality of the observation
+ * @tparam Scalar float or double, of the state and observation vectors
+ * @tparam CovScalar float or double, of the covariance, Jacobian, noise and gain matrices, Scalar by default
+ */
+template<int DP, int MP, typename Scalar = float, typename CovScalar = Scalar>
+class FixedExtendedKalmanFilter{
+
+public:
+
+    typedef cv::Matx<Scalar, DP, 1> StateVector;                ///< x
+    typedef cv::Matx<Scalar, MP, 1> ObservationVector;          ///< z
+    typedef cv::Matx<CovScalar, DP, DP> StateMatrix;            ///< F, P, Q
+    typedef cv::Matx<CovScalar, MP, DP> ObservationMatrix;      ///< H
+    typedef cv::Matx<CovScalar, MP, MP> ObservationCovMatrix;   ///< R
+    typedef cv::Matx<CovScalar, DP, MP> GainMatrix;             ///< K
+    typedef cv::Matx<CovScalar, MP, 1> InnovationVector;        ///< z - h(x)
+
+    /**
+     * @brief Initializes the filter in the same way ExtendedKalmanFilter::init() does
+     */
+    FixedExtendedKalmanFilter() :
+        statePre(StateVector::zeros()),
+        processNoiseCov(StateMatrix::eye()),
+        transitionMatrix(StateMatrix::eye()),
+        errorCovPre(StateMatrix::zeros()),
+        observationMatrix(ObservationMatrix::zeros()),
+        observationNoiseCov(ObservationCovMatrix::eye()),
+        gain(GainMatrix::zeros()),
+        statePost(StateVector::zeros()),
+        errorCovPost(StateMatrix::zeros()),
+        decompositionMethod(SymmetricSolver::CHOLESKY),
+        decompositionFallbacks(0)
+    {}
+
+    /**
+     * @brief Performs predict step
+     *
+     * @param process Process value calculated from previous a posteriori state estimate and control input i.e f(x'(k-1|k-1), u(k-1))
+     *
+     * @return Predicted (a priori) state estimate
+     */
+    StateVector const& predict(StateVector const& process)
+    {
+        //Update the state: x'(k|k-1) = f(x'(k-1|k-1), u(k-1))
+        statePre = process;
+
+        //Update error covariance matrices: temp1 = F(k-1)*P(k-1|k-1)
+        temp1 = transitionMatrix*errorCovPost;
+
+        //P(k|k-1) = temp1*F(k-1)t + Q(k-1)
+        errorCovPre = temp1*transitionMatrix.t() + processNoiseCov;
+
+        //Handle the case when there will be measurement before the next predict
+        //statePre.copyTo(statePost); //We will do this outside after corrections
+        errorCovPost = errorCovPre;
+
+        return statePre;
+    }
+
+    /**
+     * @brief Performs predict step for a transition matrix whose last DP - NB columns are zero
+     *
+     * With F(k-1) = [F_a | 0] where F_a is DP x NB, F(k-1)*P(k-1|k-1)*F(k-1)t only depends on the leading NB x NB
+     * block of P(k-1|k-1), i.e F_a*P_aa*F_at. Since the result is symmetric, only its upper triangle is calculated
+     * and it is mirrored onto the lower triangle. Q(k-1) must be symmetric. The result is the same as predict()
+     * for such transitions, in roughly DP*NB*(NB + (DP + 1)/2) instead of 2*DP^3 multiplications.
+     *
+     * @tparam NB Number of leading state components that the transition depends on
+     *
+     * @param process Process value calculated from previous a posteriori state estimate and control input i.e f(x'(k-1|k-1), u(k-1))
+     *
+     * @return Predicted (a priori) state estimate
+     */
+    template<int NB> StateVector const& predictLeadingBlock(StateVector const& process)
+    {
+        static_assert(NB > 0 && NB <= DP, "Leading block must be within the state");
+
+        //Update the state: x'(k|k-1) = f(x'(k-1|k-1), u(k-1))
+        statePre = process;
+
+        //temp1(:,0:NB) = F_a(k-1)*P_aa(k-1|k-1)
+        for(int i = 0; i < DP; i++){
+            CovScalar const* Fi = transitionMatrix.val + i*DP;
+            CovScalar* Ti = temp1.val + i*DP;
+            for(int j = 0; j < NB; j++){
+                CovScalar sum = 0;
+                for(int k = 0; k < NB; k++)
+                    sum += Fi[k]*errorCovPost.val[k*DP + j];
+                Ti[j] = sum;
+            }
+        }
+
+        //P(k|k-1) = temp1(:,0:NB)*F_a(k-1)t + Q(k-1), upper triangle then mirrored
+        for(int i = 0; i < DP; i++){
+            CovScalar const* Ti = temp1.val + i*DP;
+            for(int j = i; j < DP; j++){
+                CovScalar const* Fj = transitionMatrix.val + j*DP;
+                CovScalar sum = processNoiseCov.val[i*DP + j];
+                for(int k = 0; k < NB; k++)
+                    sum += Ti[k]*Fj[k];
+                errorCovPre.val[i*DP + j] = sum;
+                errorCovPre.val[j*DP + i] = sum;
+            }
+        }
+
+        //Handle the case when there will be measurement before the next predict
+        errorCovPost = errorCovPre;
+
+        return statePre;
+    }
+
+    /**
+     * @brief Performs update state
+     *
+     * @param observation Observation vector i.e z(k)
+     * @param predictedObservation Observation calculated from a priori state estimate i.e h(x'(k|k-1))
+     *
+     * @return Updated (a posteriori) state estimate
+     */
+    StateVector const& correct(ObservationVector const& observation, ObservationVector const& predictedObservation)
+    {
+        //temp2 = H(k)*P(k|k-1)
+        temp2 = observationMatrix*errorCovPre;
+
+        //temp3 = temp2*H(k)t + R(k)
+        temp3 = temp2*observationMatrix.t() + observationNoiseCov;
+
+        //temp4 = inv(temp3)*temp2 = K(k)t
+        solveInnovation(temp3, temp2, temp4);
+
+        //K(k)
+        gain = temp4.t();
+
+        //temp5 = z(k) - h(x'(k|k-1))
+        temp5 = observation - predictedObservation;
+
+        //x'(k|k) = x'(k|k-1) + K(k)*temp5
+        statePost = statePre + StateVector(gain*temp5);
+
+        //P(k|k) = P(k|k-1) - K(k)*temp2
+        errorCovPost = errorCovPre - gain*temp2;
+
+        return statePost;
+    }
+
+    /**
+     * @brief Performs update state using only the first MR rows of the observation
+     *
+     * Equivalent to correct() when the remaining rows of H(k) and z(k) - h(x'(k|k-1)) are zero and R(k) is block
+     * diagonal, but only an MR x MR system is solved.
+     *
+     * @tparam MR Number of leading observation rows to correct with
+     *
+     * @param observation Observation vector i.e z(k), only the first MR rows are used
+     * @param predictedObservation Observation calculated from a priori state estimate i.e h(x'(k|k-1)), only the first MR rows are used
+     *
+     * @return Updated (a posteriori) state estimate
+     */
+    template<int MR> StateVector const& correctLeadingRows(ObservationVector const& observation, ObservationVector const& predictedObservation)
+    {
+        static_assert(MR > 0 && MR <= MP, "Leading rows must be within the observation");
+
+        cv::Matx<CovScalar, MR, DP> H = observationMatrix.template get_minor<MR, DP>(0, 0);
+
+        //HP = H(k)*P(k|k-1)
+        cv::Matx<CovScalar, MR, DP> HP = H*errorCovPre;
+
+        //S = HP*H(k)t + R(k)
+        cv::Matx<CovScalar, MR, MR> S = HP*H.t() + observationNoiseCov.template get_minor<MR, MR>(0, 0);
+
+        //KT = inv(S)*HP = K(k)t
+        cv::Matx<CovScalar, MR, DP> KT;
+        solveInnovation(S, HP, KT);
+
+        //K(k), columns of the unused rows are zero
+        cv::Matx<CovScalar, DP, MR> K = KT.t();
+        gain = GainMatrix::zeros();
+        for(int i = 0; i < DP; i++)
+            for(int j = 0; j < MR; j++)
+                gain(i,j) = K(i,j);
+
+        //x'(k|k) = x'(k|k-1) + K(k)*(z(k) - h(x'(k|k-1)))
+        cv::Matx<CovScalar, MR, 1> innovation = InnovationVector(observation - predictedObservation).template get_minor<MR, 1>(0, 0);
+        statePost = statePre + StateVector(K*innovation);
+
+        //P(k|k) = P(k|k-1) - K(k)*HP
+        errorCovPost = errorCovPre - K*HP;
+
+        return statePost;
+    }
+
+    /**
+     * @brief Performs update state one observation row at a time, without any matrix inversion
+     *
+     * Each row is a scalar Kalman update on the state and covariance left by the previous rows, with the innovation
+     * relinearized around the updated state. This is equivalent to correct() when R(k) is diagonal; off-diagonal
+     * entries of R(k) are ignored. Rows whose innovation variance is not positive are skipped. Column r of gain holds
+     * the scalar gain of row r.
+     *
+     * @param observation Observation vector i.e z(k)
+     * @param predictedObservation Observation calculated from a priori state estimate i.e h(x'(k|k-1))
+     * @param rows Number of leading observation rows to correct with
+     *
+     * @return Updated (a posteriori) state estimate
+     */
+    StateVector const& correctSequential(ObservationVector const& observation, ObservationVector const& predictedObservation, int rows = MP)
+    {
+        statePost = statePre;
+        errorCovPost = errorCovPre;
+        gain = GainMatrix::zeros();
+
+        for(int r = 0; r < rows && r < MP; r++){
+            CovScalar const* Hr = observationMatrix.val + r*DP;
+
+            //PHt = P*Hr^t, s = Hr*P*Hr^t + R_rr
+            cv::Matx<CovScalar, DP, 1> PHt;
+            CovScalar s = observationNoiseCov(r,r);
+            for(int i = 0; i < DP; i++){
+                CovScalar sum = 0;
+                for(int j = 0; j < DP; j++)
+                    sum += errorCovPost.val[i*DP + j]*Hr[j];
+                PHt(i) = sum;
+                s += Hr[i]*sum;
+            }
+            if(!(s > 0))
+                continue;
+
+            //Innovation around the state corrected by the previous rows
+            CovScalar innovation = observation(r) - predictedObservation(r);
+            for(int j = 0; j < DP; j++)
+                innovation -= Hr[j]*(statePost(j) - statePre(j));
+
+            //x = x + k*innovation, k = PHt/s
+            for(int i = 0; i < DP; i++){
+                CovScalar k = PHt(i)/s;
+                gain(i,r) = k;
+                statePost(i) += k*innovation;
+            }
+
+            //P = P - k*PHt^t, upper triangle then mirrored
+            for(int i = 0; i < DP; i++)
+                for(int j = i; j < DP; j++){
+                    CovScalar p = errorCovPost.val[i*DP + j] - gain(i,r)*PHt(j);
+                    errorCovPost.val[i*DP + j] = p;
+                    errorCovPost.val[j*DP + i] = p;
+                }
+        }
+
+        return statePost;
+    }
+
+    /**
+     * @brief Calculates the squared Mahalanobis distance of the innovation of some observation rows, e.g to gate them
+     *
+     * d^2 = yt*inv(S)*y with y = z(k) - h(x'(k|k-1)) and S = H(k)*P(k|k-1)*H(k)t + R(k), both restricted to rows FR
+     * to FR + NR - 1. If the filter is consistent, d^2 is chi-square distributed with NR degrees of freedom. Only takes
+     * NR*DP*(DP + NR) multiplications and an NR x NR Cholesky decomposition, a fraction of a correction.
+     *
+     * @tparam FR First observation row
+     * @tparam NR Number of observation rows
+     *
+     * @param observation Observation vector i.e z(k)
+     * @param predictedObservation Observation calculated from a priori state estimate i.e h(x'(k|k-1))
+     *
+     * @return Squared Mahalanobis distance, 0 if S is not positive definite so that the correction handles it
+     */
+    template<int FR, int NR> CovScalar mahalanobis(ObservationVector const& observation, ObservationVector const& predictedObservation) const
+    {
+        static_assert(FR >= 0 && NR > 0 && FR + NR <= MP, "Rows must be within the observation");
+
+        cv::Matx<CovScalar, NR, DP> H = observationMatrix.template get_minor<NR, DP>(FR, 0);
+        cv::Matx<CovScalar, NR, NR> S = H*errorCovPre*H.t() + observationNoiseCov.template get_minor<NR, NR>(FR, FR);
+        cv::Matx<CovScalar, NR, 1> innovation = InnovationVector(observation - predictedObservation).template get_minor<NR, 1>(FR, 0);
+
+        //x = inv(S)*y
+        cv::Matx<CovScalar, NR, 1> x = innovation;
+        if(!SymmetricSolver::cholesky(S.val, NR, x.val, 1))
+            return 0;
+        return innovation.dot(x);
+    }
+
+    StateVector statePre;                       ///< Predicted state                                x'(k|k-1) := f(x'(k-1|k-1), u(k-1))
+    StateMatrix processNoiseCov;                ///< Process noise covariance matrix                Q(k-1)
+    StateMatrix transitionMatrix;               ///< State transition matrix i.e process Jacobian   F(k-1) := (delf/delx)(x'(k-1|k-1), u(k-1))
+    StateMatrix errorCovPre;                    ///< A priori error estimate covariance matrix      P'(k|k-1) := F(k-1)*P(k-1|k-1)*F(k-1)t + Q(k-1)
+    ObservationMatrix observationMatrix;        ///< Observation matrix i.e observation Jacobian    H(k):= (delh/delx)(x'(k|k-1))
+    ObservationCovMatrix observationNoiseCov;   ///< Observation noise covariance matrix            R(k)
+    GainMatrix gain;                            ///< Kalman gain                                    K(k) := P(k|k-1)*H(k)t*inv(H(k)*P(k|k-1)*H(k)t+R(k))
+    StateVector statePost;                      ///< Corrected state                                x'(k|k) := x'(k|k-1) + K(k)*(z(k) - h(x'(k|k-1)))
+    StateMatrix errorCovPost;                   ///< A posteriori error estimate covariance matrix  P(k|k) := (I - K(k)*H(k))*P(k|k-1)
+
+    SymmetricSolver::Method decompositionMethod;    ///< How temp3 = H(k)*P(k|k-1)*H(k)t + R(k) is inverted, CHOLESKY by default
+    unsigned int decompositionFallbacks;            ///< Number of times CHOLESKY or LDLT failed and SVD was used instead
+
+private:
+
+    /**
+     * @brief Calculates X = inv(S)*B with the chosen decomposition, falling back to SVD on failure
+     *
+     * @param S Symmetric innovation covariance, e.g temp3
+     * @param B Right hand side, e.g temp2
+     * @param X Solution, e.g temp4
+     */
+    template<int M> void solveInnovation(cv::Matx<CovScalar, M, M> const& S, cv::Matx<CovScalar, M, DP> const& B, cv::Matx<CovScalar, M, DP>& X)
+    {
+        cv::Matx<CovScalar, M, M> factor = S;
+        X = B;
+
+        bool solved = false;
+        if(decompositionMethod == SymmetricSolver::CHOLESKY)
+            solved = SymmetricSolver::cholesky(factor.val, M, X.val, DP);
+        else if(decompositionMethod == SymmetricSolver::LDLT)
+            solved = SymmetricSolver::ldlt(factor.val, M, X.val, DP);
+
+        //S is not positive definite or is singular, or SVD is explicitly requested
+        if(!solved){
+            if(decompositionMethod != SymmetricSolver::SVD)
+                decompositionFallbacks++;
+            X = S.solve(B, cv::DECOMP_SVD);
+        }
+    }
+
+    StateMatrix temp1;
+    ObservationMatrix temp2;
+    ObservationCovMatrix temp3;
+    ObservationMatrix temp4;
+    InnovationVector temp5;
+};
+
+#endif /* FIXEDEXTENDEDKALMANFILTER_H */
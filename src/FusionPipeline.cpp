@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionPipeline.cpp
+ * @brief Implementation of the headless fusion of samples into states
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"FusionPipeline.h"
+
+FusionPipeline::FusionPipeline(IMUFusion const& fusion) :
+    fusion(fusion),
+    history(nullptr),
+    trajectory(nullptr)
+{}
+
+bool FusionPipeline::push(IMUFusion::Sample const& sample)
+{
+    if(!scheduler.process(fusion, sample))
+        return false;
+    if(fusion.isStartupComplete()){
+        if(history)
+            history->record(fusion.getState());
+        if(trajectory)
+            trajectory->write(fusion.getState());
+    }
+    return true;
+}
+
+void FusionPipeline::setParameters(IMUFusion::Parameters const& params)
+{
+    fusion.setParameters(params);
+    scheduler.clear();
+}
+
+bool FusionPipeline::restartStartup(qreal startupTime)
+{
+    scheduler.clear();
+    return fusion.restartStartup(startupTime);
+}
+
+void FusionPipeline::resetDisplacement()
+{
+    fusion.resetDisplacement();
+    scheduler.clear();
+}
+
+bool FusionPipeline::warmStart(IMUFusion::WarmStart const& warmStart, qreal startupTime)
+{
+    if(!fusion.warmStart(warmStart, startupTime))
+        return false;
+    scheduler.clear();
+    return true;
+}
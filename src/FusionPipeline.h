@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionPipeline.h
+ * @brief Headless fusion of samples into states, the part of the IMU item that needs neither QML nor Qt Sensors
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef FUSIONPIPELINE_H
+#define FUSIONPIPELINE_H
+
+#include"FusionScheduler.h"
+#include"IMUFusion.h"
+#include"StateRing.h"
+#include"TrajectoryLog.h"
+
+/**
+ * @brief A fusion core behind its scheduler, with optional sinks for the state after every sample
+ *
+ * This is what the IMU item and its worker thread run, usable as is from servers, tools and benchmarks:
+ *
+ * @code
+ * FusionPipeline pipeline;
+ * for(IMUFusion::Sample const& sample : samples)
+ *     if(pipeline.push(sample))
+ *         use(pipeline.getState());
+ * @endcode
+ *
+ * Samples should come in timestamp order, e.g through a SampleMerger when they come from several live streams; late
+ * ones are rolled back within Parameters::rollbackWindow. The scheduler is cleared whenever the core is changed
+ * from outside, so that the calls below can be made at any time. Not thread safe.
+ */
+class FusionPipeline{
+
+public:
+
+    /**
+     * @brief Creates a new pipeline without sinks
+     *
+     * @param fusion Initial fusion core, copied
+     */
+    explicit FusionPipeline(IMUFusion const& fusion = IMUFusion());
+
+    /**
+     * @brief Fuses a sample and writes the new state to the sinks once startup is complete
+     *
+     * @param sample New sample
+     *
+     * @return Whether the output state changed
+     */
+    bool push(IMUFusion::Sample const& sample);
+
+    /**
+     * @brief Gets the latest snapshot
+     *
+     * @return Latest snapshot of the state
+     */
+    IMUFusion::State const& getState() const { return fusion.getState(); }
+
+    /**
+     * @brief Gets the current parameters
+     *
+     * @return Current parameters
+     */
+    IMUFusion::Parameters const& getParameters() const { return fusion.getParameters(); }
+
+    /**
+     * @brief Sets new parameters, see IMUFusion::setParameters()
+     *
+     * @param params New parameters
+     */
+    void setParameters(IMUFusion::Parameters const& params);
+
+    /**
+     * @brief Gets whether the startup period ended
+     *
+     * @return Whether startup is complete
+     */
+    bool isStartupComplete() const { return fusion.isStartupComplete(); }
+
+    /**
+     * @brief Restarts startup, see IMUFusion::restartStartup()
+     *
+     * @param startupTime Startup time in seconds, must be larger than 0 to have an effect
+     *
+     * @return Whether startup was restarted
+     */
+    bool restartStartup(qreal startupTime);
+
+    /**
+     * @brief Sets the last pose as the current pose for the displacement calculation
+     */
+    void resetDisplacement();
+
+    /**
+     * @brief Warm starts the core, see IMUFusion::warmStart()
+     *
+     * @param warmStart Values taken from an earlier core
+     * @param startupTime Startup time in seconds
+     *
+     * @return Whether the values were taken, false if samples were already processed
+     */
+    bool warmStart(IMUFusion::WarmStart const& warmStart, qreal startupTime);
+
+    /**
+     * @brief Gets what a new core can be warm started from, see IMUFusion::getWarmStart()
+     *
+     * @param warmStart Assigned the values of the core
+     *
+     * @return Whether startup is complete and the values are worth keeping
+     */
+    bool getWarmStart(IMUFusion::WarmStart& warmStart) const { return fusion.getWarmStart(warmStart); }
+
+    /**
+     * @brief Sets whether the core accumulates statistics, see IMUFusion::setStatisticsEnabled()
+     *
+     * @param enabled Whether statistics are accumulated
+     */
+    void setStatisticsEnabled(bool enabled){ fusion.setStatisticsEnabled(enabled); }
+
+    /**
+     * @brief Gets the statistics accumulated since the last call, see IMUFusion::takeStatistics()
+     *
+     * @return Statistics since the last call
+     */
+    IMUFusion::Statistics takeStatistics(){ return fusion.takeStatistics(); }
+
+    /**
+     * @brief Sets the ring the state after every sample that changes it is recorded to once startup is complete
+     *
+     * @param history Ring to record to, nullptr for none
+     */
+    void setHistory(StateRing* history){ this->history = history; }
+
+    /**
+     * @brief Sets the log the state after every sample that changes it is streamed to once startup is complete
+     *
+     * @param trajectory Open trajectory log, nullptr for none
+     */
+    void setTrajectory(TrajectoryLogWriter* trajectory){ this->trajectory = trajectory; }
+
+    /**
+     * @brief Gets the fusion core, e.g to copy it
+     *
+     * @return The fusion core
+     */
+    IMUFusion const& getFusion() const { return fusion; }
+
+private:
+
+    IMUFusion fusion;                   ///< The fusion core
+    FusionScheduler scheduler;          ///< Fuses late samples into fusion by rolling back
+    StateRing* history;                 ///< Records the state after every sample that changes it, nullptr if none
+    TrajectoryLogWriter* trajectory;    ///< Streams the state after every sample that changes it, nullptr if none
+};
+
+#endif /* FUSIONPIPELINE_H */
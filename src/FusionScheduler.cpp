@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionScheduler.cpp
+ * @brief Implementation of the rollback and replay of late samples
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"FusionScheduler.h"
+
+FusionScheduler::FusionScheduler(unsigned int capacity, unsigned int numCheckpoints) :
+    capacity(capacity > 0 ? capacity : 1),
+    history(this->capacity),
+    processed(0),
+    oldest(0),
+    newest(0),
+    checkpoints(numCheckpoints > 0 ? numCheckpoints : 1),
+    firstCheckpoint(0),
+    numCheckpoints(0)
+{
+    replay.reserve(this->capacity + 1); //Never allocates afterwards
+}
+
+void FusionScheduler::clear()
+{
+    processed = 0;
+    oldest = 0;
+    newest = 0;
+    firstCheckpoint = 0;
+    numCheckpoints = 0;
+}
+
+bool FusionScheduler::process(IMUFusion& fusion, IMUFusion::Sample const& sample)
+{
+    const qreal window = fusion.getParameters().rollbackWindow;
+    if(window <= 0){
+        if(processed > 0)
+            clear();
+        return fusion.processSample(sample);
+    }
+    const quint64 interval = (quint64)(window*1000000.0f/checkpoints.size());
+
+    //Restore the latest checkpoint before the late sample whose kept samples are still there
+    if(processed > 0 && sample.timestamp < newest)
+        for(unsigned int i = numCheckpoints; i > 0; i--){
+            unsigned int index = (firstCheckpoint + i - 1) % checkpoints.size();
+            Checkpoint const& checkpoint = checkpoints[index];
+            if(checkpoint.sequence < oldest)
+                break;
+            if(checkpoint.timestamp <= sample.timestamp){
+                rollBack(fusion, index, sample, interval);
+                return true;
+            }
+        }
+
+    return step(fusion, sample, interval);
+}
+
+bool FusionScheduler::step(IMUFusion& fusion, IMUFusion::Sample const& sample, quint64 interval)
+{
+    //Take a checkpoint before the sample if the latest one is an interval old, overwriting the oldest one
+    const unsigned int size = checkpoints.size();
+    if(numCheckpoints == 0 || sample.timestamp >= checkpoints[(firstCheckpoint + numCheckpoints - 1) % size].timestamp + interval){
+        unsigned int index;
+        if(numCheckpoints < size)
+            index = (firstCheckpoint + numCheckpoints++) % size;
+        else{
+            index = firstCheckpoint;
+            firstCheckpoint = (firstCheckpoint + 1) % size;
+        }
+        checkpoints[index].fusion = fusion;
+        checkpoints[index].timestamp = sample.timestamp;
+        checkpoints[index].sequence = processed;
+    }
+
+    bool changed = fusion.processSample(sample);
+
+    history[processed % capacity] = sample;
+    processed++;
+    if(processed - oldest > capacity)
+        oldest = processed - capacity;
+    if(sample.timestamp > newest)
+        newest = sample.timestamp;
+    return changed;
+}
+
+void FusionScheduler::rollBack(IMUFusion& fusion, unsigned int checkpoint, IMUFusion::Sample const& late, quint64 interval)
+{
+    Checkpoint const& restored = checkpoints[checkpoint];
+
+    //Kept samples since the checkpoint, with the late one after those not newer than it
+    replay.clear();
+    unsigned int lateIndex = processed - restored.sequence;
+    for(quint64 n = restored.sequence; n < processed; n++){
+        IMUFusion::Sample const& sample = history[n % capacity];
+        if(lateIndex == processed - restored.sequence && sample.timestamp > late.timestamp){
+            lateIndex = replay.size();
+            replay.push_back(late);
+        }
+        replay.push_back(sample);
+    }
+    if(lateIndex == replay.size())
+        replay.push_back(late);
+
+    //Later checkpoints are taken anew during the replay
+    const unsigned int size = checkpoints.size();
+    numCheckpoints = (checkpoint + size - firstCheckpoint) % size + 1;
+    processed = restored.sequence;
+    newest = restored.timestamp;
+
+    fusion.restore(restored.fusion);
+    for(IMUFusion::Sample const& sample : replay)
+        step(fusion, sample, interval);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionScheduler.h
+ * @brief Feeds a fusion core with ordered samples and fuses late ones by rolling back and replaying
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef FUSIONSCHEDULER_H
+#define FUSIONSCHEDULER_H
+
+#include<vector>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief Sits between a SampleMerger and a fusion core and fuses samples that arrive too late for the merger
+ *
+ * The samples of the last Parameters::rollbackWindow seconds are kept along with a few copies of the core taken at
+ * regular intervals. A sample older than the newest fused one restores the latest copy before it, and the kept
+ * samples are fused again with the late one at its place. Samples later than the window, or than the kept samples
+ * reach, are fused late as without a scheduler. Nothing is kept while the window is 0.
+ *
+ * The kept copies go stale when the core is changed from outside, clear() must be called after setParameters(),
+ * restartStartup() and resetDisplacement().
+ */
+class FusionScheduler{
+
+public:
+
+    /**
+     * @brief Creates a new empty scheduler
+     *
+     * @param capacity Number of samples to keep at most, bounds the cost of one rollback
+     * @param numCheckpoints Number of copies of the core spread over the window
+     */
+    FusionScheduler(unsigned int capacity = 1024, unsigned int numCheckpoints = 8);
+
+    /**
+     * @brief Fuses a sample, rolling back and replaying if it is late
+     *
+     * @param fusion Fusion core to drive, always the same one between calls to clear()
+     * @param sample New sample
+     *
+     * @return Whether the output state of the core changed
+     */
+    bool process(IMUFusion& fusion, IMUFusion::Sample const& sample);
+
+    /**
+     * @brief Forgets the kept samples and copies
+     */
+    void clear();
+
+private:
+
+    /**
+     * @brief Copy of the core before one of the kept samples was fused
+     */
+    struct Checkpoint{
+        IMUFusion fusion;                       ///< Copy of the core
+        quint64 timestamp;                      ///< Timestamp of the sample fused next
+        quint64 sequence;                       ///< Sequence number of the sample fused next
+    };
+
+    /**
+     * @brief Fuses a sample in order, keeps it and takes a checkpoint before it if one is due
+     *
+     * @param fusion Fusion core to drive
+     * @param sample New sample
+     * @param interval Time between checkpoints in microseconds
+     *
+     * @return Whether the output state of the core changed
+     */
+    bool step(IMUFusion& fusion, IMUFusion::Sample const& sample, quint64 interval);
+
+    /**
+     * @brief Restores a checkpoint and fuses the kept samples since it again, with the late sample at its place
+     *
+     * @param fusion Fusion core to drive
+     * @param checkpoint Index of the checkpoint in checkpoints
+     * @param late Late sample
+     * @param interval Time between checkpoints in microseconds
+     */
+    void rollBack(IMUFusion& fusion, unsigned int checkpoint, IMUFusion::Sample const& late, quint64 interval);
+
+    unsigned int capacity;                      ///< Number of samples to keep at most
+    std::vector<IMUFusion::Sample> history;     ///< Kept samples, the one with sequence number n at n % capacity
+    std::vector<IMUFusion::Sample> replay;      ///< Samples to fuse again during a rollback
+    quint64 processed;                          ///< Sequence number of the next sample
+    quint64 oldest;                             ///< Sequence number of the oldest kept sample
+    quint64 newest;                             ///< Timestamp of the newest fused sample
+
+    std::vector<Checkpoint> checkpoints;        ///< Ring of checkpoints
+    unsigned int firstCheckpoint;               ///< Index of the oldest checkpoint
+    unsigned int numCheckpoints;                ///< Number of valid checkpoints
+};
+
+#endif /* FUSIONSCHEDULER_H */
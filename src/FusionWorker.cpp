@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionWorker.cpp
+ * @brief Implementation of the fusion worker thread
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"FusionWorker.h"
+
+FusionWorker::FusionWorker(FusionPipeline const& pipeline, std::function<void()> const& stateReady) :
+    pipeline(pipeline),
+    stateReady(stateReady),
+    sleeping(false),
+    running(true),
+    thread(&FusionWorker::run, this)
+{}
+
+FusionWorker::~FusionWorker()
+{
+    if(thread.joinable())
+        stop();
+}
+
+bool FusionWorker::push(IMUFusion::Sample const& sample)
+{
+    if(!queue.push(sample))
+        return false;
+
+    //Pairs with the fence in run(): either the worker sees the new sample or we see that it sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleeping.load(std::memory_order_relaxed)){
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+    return true;
+}
+
+void FusionWorker::setParameters(IMUFusion::Parameters const& params)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    pipeline.setParameters(params);
+}
+
+bool FusionWorker::restartStartup(qreal startupTime)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    return pipeline.restartStartup(startupTime);
+}
+
+void FusionWorker::resetDisplacement()
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    pipeline.resetDisplacement();
+}
+
+bool FusionWorker::warmStart(IMUFusion::WarmStart const& warmStart, qreal startupTime)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    return pipeline.warmStart(warmStart, startupTime);
+}
+
+bool FusionWorker::getWarmStart(IMUFusion::WarmStart& warmStart)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    return pipeline.getWarmStart(warmStart);
+}
+
+IMUFusion::State FusionWorker::getState()
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    return pipeline.getState();
+}
+
+void FusionWorker::setStatisticsEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    pipeline.setStatisticsEnabled(enabled);
+}
+
+void FusionWorker::setTrajectory(TrajectoryLogWriter* trajectory)
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    pipeline.setTrajectory(trajectory);
+}
+
+IMUFusion::Statistics FusionWorker::takeStatistics()
+{
+    std::lock_guard<std::mutex> lock(fusionMutex);
+    return pipeline.takeStatistics();
+}
+
+FusionPipeline FusionWorker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false);
+        wakeCondition.notify_one();
+    }
+    thread.join();
+
+    //Nothing is lost when switching back to processing on the calling thread
+    IMUFusion::Sample sample;
+    while(queue.pop(sample))
+        pipeline.push(sample);
+    return pipeline;
+}
+
+void FusionWorker::run()
+{
+    IMUFusion::Sample sample;
+
+    while(running.load()){
+        bool changed = false;
+        unsigned int processed = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(fusionMutex);
+            while(processed < BATCH_SIZE && queue.pop(sample)){
+                changed |= pipeline.push(sample);
+                processed++;
+            }
+        }
+
+        if(changed)
+            stateReady();
+
+        //Sleep until the next sample if the queue was drained
+        if(processed == 0){
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [this]{ return !queue.empty() || !running.load(); });
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file FusionWorker.h
+ * @brief Runs an IMUFusion core on its own thread
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef FUSIONWORKER_H
+#define FUSIONWORKER_H
+
+#include<atomic>
+#include<condition_variable>
+#include<functional>
+#include<mutex>
+#include<thread>
+
+#include"FusionPipeline.h"
+#include"IMUFusion.h"
+#include"SPSCQueue.h"
+
+/**
+ * @brief Owns a fusion pipeline and feeds it samples on a dedicated thread
+ *
+ * Samples are pushed from a single producer thread through a lock-free queue. The pipeline is only touched under a mutex
+ * that the worker holds for one batch of samples at a time, so the rare control calls below are synchronous and
+ * the snapshot returned by getState() is always coherent.
+ */
+class FusionWorker{
+
+public:
+
+    /**
+     * @brief Starts a new worker thread
+     *
+     * @param pipeline Initial pipeline with its sinks, copied, its sinks are then written from the worker thread
+     * @param stateReady Called from the worker thread after a batch changed the output state, must be thread safe and cheap
+     */
+    FusionWorker(FusionPipeline const& pipeline, std::function<void()> const& stateReady);
+
+    /**
+     * @brief Stops the worker thread if still running
+     */
+    ~FusionWorker();
+
+    /**
+     * @brief Queues a new sample, producer thread only
+     *
+     * @param sample New sample
+     *
+     * @return Whether the sample was queued, false if the queue is full and the sample was dropped
+     */
+    bool push(IMUFusion::Sample const& sample);
+
+    /**
+     * @brief Sets new parameters, effective from the next batch on
+     *
+     * @param params New parameters
+     */
+    void setParameters(IMUFusion::Parameters const& params);
+
+    /**
+     * @brief Restarts startup, see IMUFusion::restartStartup()
+     *
+     * @param startupTime Startup time in seconds, must be larger than 0 to have an effect
+     *
+     * @return Whether startup was restarted
+     */
+    bool restartStartup(qreal startupTime);
+
+    /**
+     * @brief Sets the last pose as the current pose for the displacement calculation
+     */
+    void resetDisplacement();
+
+    /**
+     * @brief Warm starts the core, see IMUFusion::warmStart()
+     *
+     * @param warmStart Values taken from an earlier core
+     * @param startupTime Startup time in seconds
+     *
+     * @return Whether the values were taken, false if samples were already processed
+     */
+    bool warmStart(IMUFusion::WarmStart const& warmStart, qreal startupTime);
+
+    /**
+     * @brief Gets what a new core can be warm started from, see IMUFusion::getWarmStart()
+     *
+     * @param warmStart Assigned the values of the core
+     *
+     * @return Whether startup is complete and the values are worth keeping
+     */
+    bool getWarmStart(IMUFusion::WarmStart& warmStart);
+
+    /**
+     * @brief Gets a coherent copy of the latest snapshot
+     *
+     * @return Latest snapshot of the state
+     */
+    IMUFusion::State getState();
+
+    /**
+     * @brief Sets whether the core accumulates statistics, see IMUFusion::setStatisticsEnabled()
+     *
+     * @param enabled Whether statistics are accumulated
+     */
+    void setStatisticsEnabled(bool enabled);
+
+    /**
+     * @brief Gets the statistics accumulated since the last call, see IMUFusion::takeStatistics()
+     *
+     * @return Statistics since the last call
+     */
+    IMUFusion::Statistics takeStatistics();
+
+    /**
+     * @brief Sets the log the state after every sample that changes it is streamed to once startup is complete
+     *
+     * @param trajectory Open trajectory log, written from the worker thread from the next batch on, nullptr to stop
+     */
+    void setTrajectory(TrajectoryLogWriter* trajectory);
+
+    /**
+     * @brief Gets the number of samples waiting to be processed, approximate
+     *
+     * @return Number of queued samples
+     */
+    std::size_t queueDepth() const { return queue.size(); }
+
+    /**
+     * @brief Stops the worker thread, processes the samples left in the queue on the calling thread
+     *
+     * @return Final pipeline
+     */
+    FusionPipeline stop();
+
+private:
+
+    /**
+     * @brief Worker thread body, processes batches until stopped
+     */
+    void run();
+
+    static const unsigned int BATCH_SIZE = 64;   ///< Maximum number of samples processed while holding the core
+
+    SPSCQueue<IMUFusion::Sample, 1024> queue;   ///< Samples waiting to be processed
+
+    std::mutex fusionMutex;                     ///< Guards pipeline
+    FusionPipeline pipeline;                    ///< The fusion core behind its scheduler, with its sinks
+
+    std::function<void()> stateReady;           ///< Called after a batch changed the output state
+
+    std::mutex wakeMutex;                       ///< Guards the wakeup of the sleeping worker
+    std::condition_variable wakeCondition;      ///< Signaled when a sample arrives while the worker sleeps
+    std::atomic<bool> sleeping;                 ///< Whether the worker is about to sleep or sleeping
+    std::atomic<bool> running;                  ///< Whether the worker should keep running
+
+    std::thread thread;                         ///< The worker thread, started last
+};
+
+#endif /* FUSIONWORKER_H */
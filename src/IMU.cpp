@@ -24,6 +24,8 @@
  */
 
 #include"IMU.h"
+#include"IMULogging.h"
+#include"SensorHub.h"
 
 #include<type_traits>
 #include<cfloat>
@@ -31,7 +33,6 @@
 
 #include<QtMath>
 
-const int IMU::CV_TYPE = std::is_same<qreal, double>::value ? CV_64F : CV_32F;
 const qreal IMU::EPSILON = std::is_same<qreal, double>::value ? DBL_EPSILON : FLT_EPSILON;
 
 IMU::IMU(QQuickItem* parent) :
@@ -42,171 +43,141 @@ IMU::IMU(QQuickItem* parent) :
     gyro(nullptr),
     acc(nullptr),
     mag(nullptr),
-    lastGyroTimestamp(0),
-    lastAccTimestamp(0),
-    lastMagTimestamp(0),
-    gyroSilentCycles(0),
-    accSilentCycles(0),
-    magSilentCycles(0),
-    filter(7, 6, CV_TYPE),
-    startupTime(1.0f),
-    R_g_startup(1e-1f),
-    R_y_startup(1e-3f),
-    R_g_k_0(1.0f),  //This depends on the two coefficients below
-    R_g_k_w(7.5f),  //This depends on gyroscope sensor limits, typically 250 deg/s = 7.6 rad/s
-    R_g_k_g(10.0f), //This depends on accelerometer sensor limits, typically 2g
-    R_y_k_0(10.0f),  //This depends on the four coefficients below
-    R_y_k_w(7.5f),   //This depends on gyroscope sensor limits, typically 250 deg/s = 7.6 rad/s
-    R_y_k_g(10.0f),  //This depends on the accelerometer sensor limits, typically 2g
-    R_y_k_n(20.0f),  //This depends on magnetic vector magnitude in milliTeslas
-    R_y_k_d(15.0f),  //This depents on magnetic vector dip against floor vector, in radians
-    magDataReady(false),
-    m_norm_mean(-1),
-    m_dip_angle_mean(-1),
-    m_mean_alpha(0.99f),
-    a_bias(0, 0, 0),
-    velocityWDecay(15.0f),
-    velocityADecay(8.0f)
-{
-
-    //Open first encountered and valid gyroscope and accelerometer
-    for(auto const& type : QSensor::sensorTypes())
-        for(auto const& id : QSensor::sensorsForType(type))
-            if(type == "QGyroscope"){
-                if(openGyro(id))
-                    break;
-            }
-            else if(type == "QAccelerometer"){
-                if(openAcc(id))
-                    break;
-            }
-            else if(type == "QMagnetometer"){
-                if(openMag(id))
-                    break;
-            }
-
-    //Just do assumptions for initial values
-    process =           (cv::Mat_<qreal>(7,1) << 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-    filter.statePre =   (cv::Mat_<qreal>(7,1) << 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-    statePreHistory =   (cv::Mat_<qreal>(4,1) << 1.0f, 0.0f, 0.0f, 0.0f);
-    filter.statePost =  (cv::Mat_<qreal>(7,1) << 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f ,0.0f);
-    statePostHistory =  (cv::Mat_<qreal>(4,1) << 1.0f, 0.0f, 0.0f, 0.0f);
-
-    const qreal g = 9.81f;
-    observation =           (cv::Mat_<qreal>(6,1) << 0.0f, 0.0f, g, 0.0f, 1.0f, 0.0f);
-    predictedObservation =  (cv::Mat_<qreal>(6,1) << 0.0f, 0.0f, g, 0.0f, 1.0f, 0.0f);
-
-    filter.transitionMatrix = (cv::Mat_<qreal>(7,7) <<
-            1.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   1.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   1.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   1.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f);
-
-    //Process noise covariance matrix is deltaT*Q at each step
-    Q = (cv::Mat_<qreal>(7,7) <<
-            1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,   0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,
-            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   1e-2f);
-    Q.copyTo(filter.errorCovPre);
+    worker(nullptr),
+    publishPending(false),
+    publishMode(PerSample),
+    outputRate(60.0f),
+    outputPending(false),
+    bufferSize(1),
+    gyroDataRate(1000), //Probably will not go this high and will reach maximum
+    accDataRate(1000),
+    magDataRate(1000),
+    adaptiveDataRate(false),
+    idleDataRate(50),
+    idle(false),
+    flushPending(false),
+    trajectoryCompressed(true),
+    statsInterval(1000),
+    maxQueueDepth(0),
+    unreportedDrops(0),
+    warmStartupTime(0.1f),
+    history(HISTORY_CAPACITY),
+    outputRotation(1,0,0,0),
+    outputStationary(false),
+    dirtyOutputs(ALL_OUTPUTS)
+{
+    //Coefficients start from the defaults of the fusion core
+    IMUFusion::Parameters params = pipeline.getParameters();
+    R_g_startup = params.R_g_startup;
+    R_y_startup = params.R_y_startup;
+    R_g_k_0 = params.R_g_k_0;
+    R_g_k_w = params.R_g_k_w;
+    R_g_k_g = params.R_g_k_g;
+    R_y_k_0 = params.R_y_k_0;
+    R_y_k_w = params.R_y_k_w;
+    R_y_k_g = params.R_y_k_g;
+    R_y_k_n = params.R_y_k_n;
+    R_y_k_d = params.R_y_k_d;
+    engine = (Engine)params.engine;
+    measurementUpdate = (MeasurementUpdate)params.measurementUpdate;
+    integrator = (Integrator)params.integrator;
+    deferredCovariance = params.deferredCovariance;
+    m_mean_alpha = params.m_mean_alpha;
+    a_bias = QVector3D(params.a_bias(0), params.a_bias(1), params.a_bias(2));
+    velocityWDecay = params.velocityWDecay;
+    velocityADecay = params.velocityADecay;
+    Q_b_w = params.Q_b_w;
+    Q_b_a = params.Q_b_a;
+    R_s_w = params.R_s_w;
+    R_s_a = params.R_s_a;
+    stationaryWThreshold = params.stationaryWThreshold;
+    stationaryAThreshold = params.stationaryAThreshold;
+    stationaryTime = params.stationaryTime;
+    gravityGate = params.gravityGate;
+    magneticGate = params.magneticGate;
+    magneticDipGate = params.magneticDipGate;
+    timeAlignment = params.timeAlignment;
+    rollbackWindow = params.rollbackWindow;
+    state = pipeline.getState();
+    pipeline.setHistory(&history);
+
+    connect(this, &IMU::parametersChanged, this, &IMU::syncParameters);
+    connect(this, &QQuickItem::windowChanged, this, &IMU::changeWindow);
+    connect(&outputTimer, &QTimer::timeout, this, &IMU::outputTimerTimeout);
+    outputTimer.setInterval(qMax(1, qRound(1000.0f/outputRate)));
+
+    for(int i = 0; i < 3; i++)
+        queueDrops[i] = 0;
+    pipeline.setStatisticsEnabled(true);
+    connect(&statsTimer, &QTimer::timeout, this, &IMU::statsTimerTimeout);
+    connect(&warmStartTimer, &QTimer::timeout, this, &IMU::saveWarmStart);
+    warmStartTimer.setInterval(WARM_START_INTERVAL);
+    statsTimer.start(statsInterval);
+
+    //Open first valid gyroscope, accelerometer and magnetometer once the component is created, unless set meanwhile
+    SensorHub::discover(QGyroscope::type, this, [this](QByteArray const& id){ return gyro != nullptr || openGyro(id); });
+    SensorHub::discover(QAccelerometer::type, this, [this](QByteArray const& id){ return acc != nullptr || openAcc(id); });
+    SensorHub::discover(QMagnetometer::type, this, [this](QByteArray const& id){ return mag != nullptr || openMag(id); });
 }
 
 IMU::~IMU()
 {
-    delete gyro;
-    delete acc;
-    delete mag;
+    saveWarmStart();
+    delete worker;
+    SensorHub::release(gyro, this);
+    SensorHub::release(acc, this);
+    SensorHub::release(mag, this);
 }
 
 bool IMU::openGyro(QByteArray const& id)
 {
-    QGyroscope* newGyro = new QGyroscope(this);
-    newGyro->setIdentifier(id);
-    bool success = false;
-
-    //Sensor is fine
-    if(newGyro->connectToBackend()){
-        gyroId = QString(id);
-        emit gyroIdChanged();
-        delete gyro;
-        gyro = newGyro;
-        connect(gyro, &QGyroscope::readingChanged, this, &IMU::gyroReadingChanged);
-        gyro->setDataRate(1000); //Probably will not go this high and will reach maximum
-        if(gyro->start()){
-            qDebug() << "Opened gyroscope with identifier " << id;
-            success = true;
-        }
-    }
-
-    //Sensor could not be opened for some reason
-    if(!success){
-        qDebug() << "Error: Could not open gyroscope with identifier " << id;
-        delete newGyro;
-    }
-    return success;
+    //Shared with every other consumer of the same gyroscope
+    QGyroscope* newGyro = SensorHub::acquire<QGyroscope>(id, this, effectiveDataRate(gyroDataRate), bufferSize);
+    if(!newGyro)
+        return false;
+
+    SensorHub::release(gyro, this);
+    gyro = newGyro;
+    gyroId = QString(id);
+    emit gyroIdChanged();
+    connect(gyro, &QGyroscope::readingChanged, this, &IMU::gyroReadingChanged);
+
+    //Timestamps of the previous gyroscope should not hold the new one's samples back
+    merger.setGating(IMUFusion::Sample::GYROSCOPE, true);
+    return true;
 }
 
 bool IMU::openAcc(QByteArray const& id)
 {
-    QAccelerometer* newAcc = new QAccelerometer(this);
-    newAcc->setIdentifier(id);
-    bool success = false;
-
-    //Sensor is fine
-    if(newAcc->connectToBackend()){
-        accId = QByteArray(id);
-        emit accIdChanged();
-        delete acc;
-        acc = newAcc;
-        connect(acc, &QAccelerometer::readingChanged, this, &IMU::accReadingChanged);
-        acc->setDataRate(1000); //Probably will not go this high and will reach maximum
-        if(acc->start()){
-            qDebug() << "Opened accelerometer with identifier " << id;
-            success = true;
-        }
-    }
-
-    //Sensor could not be opened for some reason
-    if(!success){
-        qDebug() << "Error: Could not open accelerometer with identifier " << id;
-        delete newAcc;
-    }
-    return success;
+    //Shared with every other consumer of the same accelerometer
+    QAccelerometer* newAcc = SensorHub::acquire<QAccelerometer>(id, this, effectiveDataRate(accDataRate), bufferSize);
+    if(!newAcc)
+        return false;
+
+    SensorHub::release(acc, this);
+    acc = newAcc;
+    accId = QByteArray(id);
+    emit accIdChanged();
+    connect(acc, &QAccelerometer::readingChanged, this, &IMU::accReadingChanged);
+
+    //Timestamps of the previous accelerometer should not hold the new one's samples back
+    merger.setGating(IMUFusion::Sample::ACCELEROMETER, true);
+    return true;
 }
 
 bool IMU::openMag(QByteArray const& id)
 {
-    QMagnetometer* newMag = new QMagnetometer(this);
-    newMag->setIdentifier(id);
-    bool success = false;
-
-    //Sensor is fine
-    if(newMag->connectToBackend()){
-        magId = QByteArray(id);
-        emit magIdChanged();
-        delete mag;
-        mag = newMag;
-        connect(mag, &QMagnetometer::readingChanged, this, &IMU::magReadingChanged);
-        mag->setDataRate(1000); //Probably will not go this high and will reach maximum
-        mag->setReturnGeoValues(true); //Try to cancel out magnetic interference
-        if(mag->start()){
-            qDebug() << "Opened magnetometer with identifier " << id;
-            success = true;
-        }
-    }
-
-    //Sensor could not be opened for some reason
-    if(!success){
-        qDebug() << "Error: Could not open magnetometer with identifier " << id;
-        delete newMag;
-    }
-    return success;
+    //Shared with every other consumer of the same magnetometer, which returns geo values
+    QMagnetometer* newMag = SensorHub::acquire<QMagnetometer>(id, this, effectiveDataRate(magDataRate), bufferSize);
+    if(!newMag)
+        return false;
+
+    SensorHub::release(mag, this);
+    mag = newMag;
+    magId = QByteArray(id);
+    emit magIdChanged();
+    connect(mag, &QMagnetometer::readingChanged, this, &IMU::magReadingChanged);
+    return true;
 }
 
 void IMU::setGyroId(QString const& newId)
@@ -214,13 +185,13 @@ void IMU::setGyroId(QString const& newId)
     if(newId == gyroId)
         return;
 
-    for(auto const& id : QSensor::sensorsForType("QGyroscope"))
-        if(id == newId){
-            openGyro(id);
-            return;
-        }
+    QByteArray id = newId.toUtf8();
+    if(SensorHub::isAvailable(QGyroscope::type, id)){
+        openGyro(id);
+        return;
+    }
 
-    qDebug() << "Error: Gyroscope with identifier " << newId << " not found.";
+    qCWarning(imuSensors) << "Gyroscope with identifier " << newId << " not found.";
 }
 
 void IMU::setAccId(QString const& newId)
@@ -228,13 +199,13 @@ void IMU::setAccId(QString const& newId)
     if(newId == accId)
         return;
 
-    for(auto const& id : QSensor::sensorsForType("QAccelerometer"))
-        if(id == newId){
-            openAcc(id);
-            return;
-        }
+    QByteArray id = newId.toUtf8();
+    if(SensorHub::isAvailable(QAccelerometer::type, id)){
+        openAcc(id);
+        return;
+    }
 
-    qDebug() << "Error: Accelerometer with identifier " << newId << " not found.";
+    qCWarning(imuSensors) << "Accelerometer with identifier " << newId << " not found.";
 }
 
 void IMU::setMagId(QString const& newId)
@@ -242,455 +213,762 @@ void IMU::setMagId(QString const& newId)
     if(newId == magId)
         return;
 
-    for(auto const& id : QSensor::sensorsForType("QMagnetometer"))
-        if(id == newId){
-            openMag(id);
-            return;
-        }
+    QByteArray id = newId.toUtf8();
+    if(SensorHub::isAvailable(QMagnetometer::type, id)){
+        openMag(id);
+        return;
+    }
 
-    qDebug() << "Error: Magnetometer with identifier " << newId << " not found.";
+    qCWarning(imuSensors) << "Magnetometer with identifier " << newId << " not found.";
 }
 
 void IMU::gyroReadingChanged()
 {
-    quint64 timestamp = gyro->reading()->timestamp();
-
-    if(lastGyroTimestamp > 0){
-        wDeltaT = ((qreal)(timestamp - lastGyroTimestamp))/1000000.0f;
-        if(wDeltaT > 0){
-            gyroSilentCycles = 0;
-
-            //Take care of startup time
-            if(startupTime > 0){
-                startupTime -= wDeltaT;
-                if(startupTime < 0){
-                    startupTime = 0;
-                    resetDisplacement();
-                    velocity = QVector3D(0,0,0);
-                    qDebug() << "Startup is over";
-                    emit startupCompleteChanged();
-                }
-            }
-
-            w.setX(qDegreesToRadians(gyro->reading()->x())); //Angular velocity around x axis in rad/s
-            w.setY(qDegreesToRadians(gyro->reading()->y())); //Angular velocity around y axis in rad/s
-            w.setZ(qDegreesToRadians(gyro->reading()->z())); //Angular velocity around z axis in rad/s
-            w_norm = w.length();
+    IMUFusion::Sample sample;
+    sample.type = IMUFusion::Sample::GYROSCOPE;
+    sample.timestamp = gyro->reading()->timestamp();
+    sample.x = gyro->reading()->x();
+    sample.y = gyro->reading()->y();
+    sample.z = gyro->reading()->z();
+    processSample(sample);
+}
 
-            //Calculate process value, transition matrix and process noise covariance matrix
-            calculateProcess();
+void IMU::accReadingChanged()
+{
+    IMUFusion::Sample sample;
+    sample.type = IMUFusion::Sample::ACCELEROMETER;
+    sample.timestamp = acc->reading()->timestamp();
+    sample.x = acc->reading()->x();
+    sample.y = acc->reading()->y();
+    sample.z = acc->reading()->z();
+    processSample(sample);
+}
 
-            //Do prediction step
-            filter.predict(process);
+void IMU::magReadingChanged()
+{
+    IMUFusion::Sample sample;
+    sample.type = IMUFusion::Sample::MAGNETOMETER;
+    sample.timestamp = mag->reading()->timestamp();
+    sample.x = mag->reading()->x();
+    sample.y = mag->reading()->y();
+    sample.z = mag->reading()->z();
+    processSample(sample);
+}
 
-            //Ensure output quaternion is unit norm
-            normalizeQuat(filter.statePre);
+void IMU::processSample(IMUFusion::Sample const& sample)
+{
+    if(recorder.isOpen() && !recorder.write(sample)){
+        qCWarning(imuLog) << "Could not record to " << recordFile << ", stopping recording";
+        setRecordFile("");
+    }
 
-            //Ensure output quaternion doesn't unwind
-            shortestPathQuat(statePreHistory, filter.statePre);
+    merger.push(sample);
 
-            //Ensure a posteriori state reflects prediction in case measurement doesn't occur
-            filter.statePre.copyTo(filter.statePost);
+    //Readings of a buffered burst arrive in the same event loop pass, process them together afterwards
+    if(bufferSize == 1)
+        flushSamples();
+    else if(!flushPending){
+        flushPending = true;
+        QMetaObject::invokeMethod(this, "flushSamples", Qt::QueuedConnection);
+    }
+}
 
-            //Export rotation and linear acceleration
-            calculateOutput();
+void IMU::flushSamples()
+{
+    flushPending = false;
+
+    bool changed = false;
+    bool motionSample = false;
+    IMUFusion::Sample sample;
+    while(merger.pop(sample)){
+        IMU_SAMPLE_DEBUG(imuSamples) << "Sample of type " << sample.type << " at " << sample.timestamp
+            << ": " << sample.x << " " << sample.y << " " << sample.z;
+        if(worker){
+            if(!worker->push(sample)){
+                queueDrops[sample.type]++;
+                unreportedDrops++;
+            }
+            maxQueueDepth = qMax(maxQueueDepth, (int)worker->queueDepth());
+        }
+        else{
+            changed |= pipeline.push(sample);
+            motionSample |= sample.type != IMUFusion::Sample::MAGNETOMETER;
         }
     }
-    lastGyroTimestamp = timestamp;
+
+    if(changed)
+        stateReady();
+    else if(motionSample)
+        publish(false);
 }
 
-void IMU::accReadingChanged()
+void IMU::setBufferSize(int bufferSize)
 {
-    quint64 timestamp = acc->reading()->timestamp();
+    if(bufferSize < 0){
+        qCWarning(imuSensors) << "Buffer size must not be negative, got " << bufferSize;
+        return;
+    }
+    if(bufferSize == this->bufferSize)
+        return;
 
-    if(lastAccTimestamp > 0){
-        aDeltaT = ((qreal)(timestamp - lastAccTimestamp))/1000000.0f;
-        if(aDeltaT > 0){
-            accSilentCycles = 0;
-            a.setX(acc->reading()->x() - a_bias.x()); //Linear acceleration along x axis in m/s^2
-            a.setY(acc->reading()->y() - a_bias.y()); //Linear acceleration along y axis in m/s^2
-            a.setZ(acc->reading()->z() - a_bias.z()); //Linear acceleration along z axis in m/s^2
-            a_norm = a.length();
+    this->bufferSize = bufferSize;
+    requestSensors();
+    emit bufferSizeChanged();
+}
 
-            //Calculate observation value, predicted observation value and observation matrix
-            //We assume here that the magnetometer reading is less frequent compared to accelerometer
-            calculateObservation();
+void IMU::setGyroDataRate(int gyroDataRate)
+{
+    if(gyroDataRate <= 0){
+        qCWarning(imuSensors) << "Gyroscope data rate must be larger than 0, got " << gyroDataRate;
+        return;
+    }
+    if(gyroDataRate == this->gyroDataRate)
+        return;
 
-            //Do correction step
-            filter.correct(observation, predictedObservation);
+    this->gyroDataRate = gyroDataRate;
+    SensorHub::request(gyro, this, effectiveDataRate(gyroDataRate), bufferSize);
+    emit gyroDataRateChanged();
+}
 
-            //Ensure ouput quaternion is unit norm
-            normalizeQuat(filter.statePost);
+void IMU::setAccDataRate(int accDataRate)
+{
+    if(accDataRate <= 0){
+        qCWarning(imuSensors) << "Accelerometer data rate must be larger than 0, got " << accDataRate;
+        return;
+    }
+    if(accDataRate == this->accDataRate)
+        return;
 
-            //Ensure output quaternion doesn't unwind
-            shortestPathQuat(statePostHistory, filter.statePost);
+    this->accDataRate = accDataRate;
+    SensorHub::request(acc, this, effectiveDataRate(accDataRate), bufferSize);
+    emit accDataRateChanged();
+}
 
-            //Export rotation
-            calculateOutput();
+void IMU::setMagDataRate(int magDataRate)
+{
+    if(magDataRate <= 0){
+        qCWarning(imuSensors) << "Magnetometer data rate must be larger than 0, got " << magDataRate;
+        return;
+    }
+    if(magDataRate == this->magDataRate)
+        return;
 
-            //Update displacement values
-            updateDisplacement();
-        }
+    this->magDataRate = magDataRate;
+    SensorHub::request(mag, this, effectiveDataRate(magDataRate), bufferSize);
+    emit magDataRateChanged();
+}
+
+void IMU::setAdaptiveDataRate(bool adaptiveDataRate)
+{
+    if(adaptiveDataRate == this->adaptiveDataRate)
+        return;
+
+    this->adaptiveDataRate = adaptiveDataRate;
+    updateIdle();
+    emit adaptiveDataRateChanged();
+}
+
+void IMU::setIdleDataRate(int idleDataRate)
+{
+    if(idleDataRate <= 0){
+        qCWarning(imuSensors) << "Idle data rate must be larger than 0, got " << idleDataRate;
+        return;
     }
-    lastAccTimestamp = timestamp;
+    if(idleDataRate == this->idleDataRate)
+        return;
+
+    this->idleDataRate = idleDataRate;
+    if(idle)
+        requestSensors();
+    emit idleDataRateChanged();
 }
 
-void IMU::magReadingChanged()
+void IMU::requestSensors()
 {
-    quint64 timestamp = mag->reading()->timestamp();
+    SensorHub::request(gyro, this, effectiveDataRate(gyroDataRate), bufferSize);
+    SensorHub::request(acc, this, effectiveDataRate(accDataRate), bufferSize);
+    SensorHub::request(mag, this, effectiveDataRate(magDataRate), bufferSize);
+}
 
-    if(lastMagTimestamp > 0)
-        if(((qreal)(timestamp - lastMagTimestamp))/1000000.0f > 0){
-            magSilentCycles = 0;
-            m.setX(mag->reading()->x()*1000000.0f); //Magnetic flux along x axis in milliTeslas
-            m.setY(mag->reading()->y()*1000000.0f); //Magnetic flux along y axis in milliTeslas
-            m.setZ(mag->reading()->z()*1000000.0f); //Magnetic flux along z axis in milliTeslas
-            m_norm = m.length();
-            magDataReady = true;
-        }
-    lastMagTimestamp = timestamp;
+void IMU::updateIdle()
+{
+    //Full rates during startup so that it settles as quickly as without adaptation
+    bool idle = adaptiveDataRate && outputStationary && isStartupComplete();
+    if(idle == this->idle)
+        return;
+
+    this->idle = idle;
+    qCDebug(imuSensors) << (idle ? "Stationary, dropping data rates to " : "Moving, restoring data rates from ") << idleDataRate << " Hz";
+    requestSensors();
+    emit idleChanged();
 }
 
-inline void IMU::normalizeQuat(cv::Mat& quat)
+void IMU::setRecordFile(QString const& recordFile)
 {
-    qreal* q = (qreal*)quat.ptr();
-    qreal norm = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
-    if(norm > EPSILON){
-        q[0] /= norm;
-        q[1] /= norm;
-        q[2] /= norm;
-        q[3] /= norm;
+    if(recordFile == this->recordFile)
+        return;
+
+    recorder.close();
+    if(recordFile != "" && recorder.open(recordFile)){
+        qCDebug(imuLog) << "Recording raw readings to " << recordFile;
+        this->recordFile = recordFile;
     }
-    else{
-        q[0] = 1.0f;
-        q[1] = 1.0f;
-        q[2] = 1.0f;
-        q[3] = 1.0f;
-    }
-}
-
-inline void IMU::shortestPathQuat(cv::Mat& prevQuat, cv::Mat& quat)
-{
-    qreal* p = (qreal*)prevQuat.ptr();
-    qreal* q = (qreal*)quat.ptr();
-
-    //If -q would be closer to q_prev than +q, replace new q with -q
-    //The following comes from the derivation of |q - q_prev|^2 - |-q - q_prev|^2
-    if(q[0]*p[0] + q[1]*p[1] + q[2]*p[2] + q[3]*p[3] < 0){
-        q[0] = -q[0];
-        q[1] = -q[1];
-        q[2] = -q[2];
-        q[3] = -q[3];
-    }
-    p[0] = q[0];
-    p[1] = q[1];
-    p[2] = q[2];
-    p[3] = q[3];
-}
-
-void IMU::calculateProcess()
-{
-    //cv::Mat data pointers
-    qreal* processPtr = (qreal*)process.ptr();
-    qreal* F0 = (qreal*)filter.transitionMatrix.ptr(0);
-    qreal* F1 = (qreal*)filter.transitionMatrix.ptr(1);
-    qreal* F2 = (qreal*)filter.transitionMatrix.ptr(2);
-    qreal* F3 = (qreal*)filter.transitionMatrix.ptr(3);
-    qreal* F4 = (qreal*)filter.transitionMatrix.ptr(4);
-    qreal* F5 = (qreal*)filter.transitionMatrix.ptr(5);
-    qreal* F6 = (qreal*)filter.transitionMatrix.ptr(6);
-
-    //Calculate process value
-    const qreal q0 = filter.statePost.at<qreal>(0);
-    const qreal q1 = filter.statePost.at<qreal>(1);
-    const qreal q2 = filter.statePost.at<qreal>(2);
-    const qreal q3 = filter.statePost.at<qreal>(3);
-    const qreal wx = w.x();
-    const qreal wy = w.y();
-    const qreal wz = w.z();
-    const qreal ax = a.x();
-    const qreal ay = a.y();
-    const qreal az = a.z();
-    const qreal g = 9.81f;
-
-    //Absolute rotation
-    processPtr[0] = q0 + 0.5f*wDeltaT*(-q1*wx - q2*wy - q3*wz);
-    processPtr[1] = q1 + 0.5f*wDeltaT*(+q0*wx - q3*wy + q2*wz);
-    processPtr[2] = q2 + 0.5f*wDeltaT*(+q3*wx + q0*wy - q1*wz);
-    processPtr[3] = q3 + 0.5f*wDeltaT*(-q2*wx + q1*wy + q0*wz);
-
-    //Absolute linear acceleration
-    processPtr[4] = (q0*q0 + q1*q1 - q2*q2 - q3*q3)*ax + 2*(q1*q2 - q0*q3)*ay + 2*(q1*q3 + q0*q2)*az;
-    processPtr[5] = 2*(q1*q2 + q0*q3)*ax + (q0*q0 - q1*q1 + q2*q2 - q3*q3)*ay + 2*(q2*q3 - q0*q1)*az;
-    processPtr[6] = 2*(q1*q3 - q0*q2)*ax + 2*(q2*q3 + q0*q1)*ay + (q0*q0 - q1*q1 - q2*q2 + q3*q3)*az - g;
-
-    normalizeQuat(process);
-
-    //Calculate transition matrix
-    /* 1.0f */                  F0[1] = -0.5f*wDeltaT*wx;   F0[2] = -0.5f*wDeltaT*wy;   F0[3] = -0.5f*wDeltaT*wz;
-    F1[0] = +0.5f*wDeltaT*wx;   /* 1.0f */                  F1[2] = +0.5f*wDeltaT*wz;   F1[3] = -0.5f*wDeltaT*wy;
-    F2[0] = +0.5f*wDeltaT*wy;   F2[1] = -0.5f*wDeltaT*wz;   /* 1.0f */                  F2[3] = +0.5f*wDeltaT*wx;
-    F3[0] = +0.5f*wDeltaT*wz;   F3[1] = +0.5f*wDeltaT*wy;   F3[2] = -0.5f*wDeltaT*wx;  /* 1.0f */
-
-    F4[0] = 2*(+q0*ax - q3*ay + q2*az); F4[1] = 2*(+q1*ax + q2*ay + q3*az); F4[2] = 2*(-q2*ax + q1*ay + q0*az); F4[3] = 2*(-q3*ax - q0*ay + q1*az);
-    F5[0] = 2*(+q3*ax + q0*ay - q1*az); F5[1] = 2*(+q2*ax - q1*ay - q0*az); F5[2] = 2*(+q1*ax + q2*ay + q3*az); F5[3] = 2*(+q0*ax - q3*ay + q2*az);
-    F6[0] = 2*(-q2*ax + q1*ay + q0*az); F6[1] = 2*(+q3*ax + q0*ay - q1*az); F6[2] = 2*(-q0*ax + q3*ay - q2*az); F6[3] = 2*(+q1*ax + q2*ay + q3*az);
-
-    //Calculate process covariance matrix
-    filter.processNoiseCov = Q*wDeltaT; //TODO: We should not multiply the acceleration part with deltaT
-}
-
-void IMU::calculateObservation()
-{
-    //cv::Mat data pointers
-    qreal* statePrePtr = (qreal*)filter.statePre.ptr();
-    qreal* observationPtr = (qreal*)observation.ptr();
-    qreal* predictedObservationPtr = (qreal*)predictedObservation.ptr();
-    qreal* H0 = (qreal*)filter.observationMatrix.ptr(0);
-    qreal* H1 = (qreal*)filter.observationMatrix.ptr(1);
-    qreal* H2 = (qreal*)filter.observationMatrix.ptr(2);
-    qreal* H3 = (qreal*)filter.observationMatrix.ptr(3);
-    qreal* H4 = (qreal*)filter.observationMatrix.ptr(4);
-    qreal* H5 = (qreal*)filter.observationMatrix.ptr(5);
-
-    //Variables dependent on current state
-    const qreal q0 = statePrePtr[0];
-    const qreal q1 = statePrePtr[1];
-    const qreal q2 = statePrePtr[2];
-    const qreal q3 = statePrePtr[3];
-    const qreal g = 9.81f;
-    const qreal R_DCM_z0 = 2*(q1*q3 - q0*q2);
-    const qreal R_DCM_z1 = 2*(q2*q3 + q0*q1);
-    const qreal R_DCM_z2 = q0*q0 - q1*q1 - q2*q2 + q3*q3;
-
-    //Accelerometer observation and noise
-    observationPtr[0] = a.x();
-    observationPtr[1] = a.y();
-    observationPtr[2] = a.z();
-    predictedObservationPtr[0] = R_DCM_z0*g;
-    predictedObservationPtr[1] = R_DCM_z1*g;
-    predictedObservationPtr[2] = R_DCM_z2*g;
-    qreal R_g = R_g_k_0 + R_g_k_w*w_norm + R_g_k_g*std::fabs(g - a_norm);
-
-    //Magnetometer reading variables and observation
-    qreal R_y;
-    if(magDataReady){
-        qreal mx = m.x();
-        qreal my = m.y();
-        qreal mz = m.z();
-
-        const qreal dot_m_z = mx*R_DCM_z0 + my*R_DCM_z1 + mz*R_DCM_z2;
-
-        qreal m_dip_angle = acos(dot_m_z/m_norm);
-        if(std::isnan(m_dip_angle))
-            m_dip_angle = 0.0f;
-
-        if(m_norm_mean < 0) //For fast startup
-            m_norm_mean = m_norm;
-        else
-            m_norm_mean = m_mean_alpha*m_norm_mean + (1.0f - m_mean_alpha)*m_norm;
+    else
+        this->recordFile = "";
+    emit recordFileChanged();
+}
 
-        if(m_dip_angle_mean < 0) //For fast startup
-            m_dip_angle_mean = m_dip_angle;
+void IMU::setTrajectoryFile(QString const& trajectoryFile)
+{
+    if(trajectoryFile == this->trajectoryFile)
+        return;
+
+    //The fusion thread lets go of the log before it is closed
+    if(worker)
+        worker->setTrajectory(nullptr);
+    else
+        pipeline.setTrajectory(nullptr);
+    trajectory.close();
+    if(trajectoryFile != "" && trajectory.open(trajectoryFile, trajectoryCompressed)){
+        qCDebug(imuLog) << "Streaming fused states to " << trajectoryFile;
+        this->trajectoryFile = trajectoryFile;
+        if(worker)
+            worker->setTrajectory(&trajectory);
         else
-            m_dip_angle_mean = m_mean_alpha*m_dip_angle_mean + (1.0f - m_mean_alpha)*m_dip_angle;
-
-        mx = mx - dot_m_z*R_DCM_z0; //Reject magnetic component on Z axis
-        my = my - dot_m_z*R_DCM_z1; //Reject magnetic component on Z axis
-        mz = mz - dot_m_z*R_DCM_z2; //Reject magnetic component on Z axis
-        qreal uy_norm = sqrt(mx*mx + my*my + mz*mz);
-        if(uy_norm > EPSILON){
-            mx /= uy_norm;
-            my /= uy_norm;
-            mz /= uy_norm;
-        }
+            pipeline.setTrajectory(&trajectory);
+    }
+    else
+        this->trajectoryFile = "";
+    emit trajectoryFileChanged();
+}
+
+void IMU::setStatsInterval(int statsInterval)
+{
+    if(statsInterval < 0){
+        qCWarning(imuFusion) << "Statistics interval must not be negative, got " << statsInterval;
+        return;
+    }
+    if(statsInterval == this->statsInterval)
+        return;
+
+    this->statsInterval = statsInterval;
+    if(worker)
+        worker->setStatisticsEnabled(statsInterval > 0);
+    else
+        pipeline.setStatisticsEnabled(statsInterval > 0);
+    if(statsInterval > 0)
+        statsTimer.start(statsInterval);
+    else
+        statsTimer.stop();
+    emit statsIntervalChanged();
+}
 
-        observationPtr[3] = mx;
-        observationPtr[4] = my;
-        observationPtr[5] = mz;
-        predictedObservationPtr[3] = 2*(q1*q2 + q0*q3);
-        predictedObservationPtr[4] = q0*q0 - q1*q1 + q2*q2 - q3*q3;
-        predictedObservationPtr[5] = 2*(q2*q3 - q0*q1);
+void IMU::setWarmStartFile(QString const& warmStartFile)
+{
+    if(warmStartFile == this->warmStartFile)
+        return;
+
+    this->warmStartFile = warmStartFile;
+    if(warmStartFile != "")
+        warmStartTimer.start();
+    else
+        warmStartTimer.stop();
+    if(isComponentComplete())
+        loadWarmStart();
+    emit warmStartFileChanged();
+}
+
+void IMU::componentComplete()
+{
+    QQuickItem::componentComplete();
+    loadWarmStart();
+}
 
-        R_y = R_y_k_0 + R_y_k_w*w_norm + R_y_k_g*std::fabs(g - a_norm) +
-            R_y_k_n*std::fabs(m_norm - m_norm_mean) + R_y_k_d*std::fabs(m_dip_angle - m_dip_angle_mean);
+void IMU::loadWarmStart()
+{
+    IMUFusion::WarmStart warmStart;
+    if(warmStartFile == "" || !WarmStartCache::load(warmStartFile, warmStart))
+        return;
+
+    bool warmStarted = worker ? worker->warmStart(warmStart, warmStartupTime) : pipeline.warmStart(warmStart, warmStartupTime);
+    if(!warmStarted){
+        qCDebug(imuFusion) << "Samples were already fused, not warm starting from " << warmStartFile;
+        return;
     }
-    else{
-        observationPtr[3] = 0.0f;
-        observationPtr[4] = 0.0f;
-        observationPtr[5] = 0.0f;
-        predictedObservationPtr[3] = 0.0f;
-        predictedObservationPtr[4] = 0.0f;
-        predictedObservationPtr[5] = 0.0f;
 
-        R_y = 1.0f; //This doesn't matter, as long as it doesn't cause nans or infs in S^-1
+    qCDebug(imuFusion) << "Warm started from " << warmStartFile;
+    bool wasStartupComplete = isStartupComplete();
+    state = worker ? worker->getState() : pipeline.getState();
+    if(wasStartupComplete != isStartupComplete())
+        emit startupCompleteChanged();
+}
+
+bool IMU::saveWarmStart()
+{
+    IMUFusion::WarmStart warmStart;
+    if(warmStartFile == "")
+        return false;
+    if(!(worker ? worker->getWarmStart(warmStart) : pipeline.getWarmStart(warmStart)))
+        return false;
+    return WarmStartCache::save(warmStartFile, warmStart);
+}
+
+void IMU::statsTimerTimeout()
+{
+    IMUFusion::Statistics statistics = worker ? worker->takeStatistics() : pipeline.takeStatistics();
+    statistics.gyro.dropped += queueDrops[IMUFusion::Sample::GYROSCOPE];
+    statistics.acc.dropped += queueDrops[IMUFusion::Sample::ACCELEROMETER];
+    statistics.mag.dropped += queueDrops[IMUFusion::Sample::MAGNETOMETER];
+    for(int i = 0; i < 3; i++)
+        queueDrops[i] = 0;
+
+    stats.update(statistics, maxQueueDepth);
+    maxQueueDepth = 0;
+}
+
+void IMU::stateReady()
+{
+    switch(publishMode){
+        case PerSample:
+            publish(true);
+            break;
+        case PerFrame:
+            if(window()){
+                outputPending = true;
+                window()->update();
+            }
+            else
+                publish(true);
+            break;
+        case FixedRate:
+            outputPending = true;
+            break;
+    }
+}
+
+void IMU::publish(bool changed)
+{
+    bool wasStartupComplete = isStartupComplete();
+    state = worker ? worker->getState() : pipeline.getState();
+    if(!wasStartupComplete && isStartupComplete()){
+        qCDebug(imuFusion) << "Startup is over";
+        emit startupCompleteChanged();
     }
 
-    //Calculate observation matrix
-    H0[0] = -2*g*q2;  H0[1] = +2*g*q3;  H0[2] = -2*g*q0;  H0[3] = +2*g*q1;
-    H1[0] = +2*g*q1;  H1[1] = +2*g*q0;  H1[2] = +2*g*q3;  H1[3] = +2*g*q2;
-    H2[0] = +2*g*q0;  H2[1] = -2*g*q1;  H2[2] = -2*g*q2;  H2[3] = +2*g*q3;
-    if(magDataReady){
-        H3[0] = +2*q3;    H3[1] = +2*q2;    H3[2] = +2*q1;    H3[3] = +2*q0;
-        H4[0] = +2*q0;    H4[1] = -2*q1;    H4[2] = +2*q2;    H4[3] = -2*q3;
-        H5[0] = -2*q1;    H5[1] = -2*q0;    H5[2] = +2*q3;    H5[3] = +2*q2;
+    if(checkSensors() && changed)
+        calculateOutput();
+}
+
+void IMU::syncParameters()
+{
+    IMUFusion::Parameters params;
+    params.R_g_startup = R_g_startup;
+    params.R_y_startup = R_y_startup;
+    params.R_g_k_0 = R_g_k_0;
+    params.R_g_k_w = R_g_k_w;
+    params.R_g_k_g = R_g_k_g;
+    params.R_y_k_0 = R_y_k_0;
+    params.R_y_k_w = R_y_k_w;
+    params.R_y_k_g = R_y_k_g;
+    params.R_y_k_n = R_y_k_n;
+    params.R_y_k_d = R_y_k_d;
+    params.m_mean_alpha = m_mean_alpha;
+    params.velocityWDecay = velocityWDecay;
+    params.velocityADecay = velocityADecay;
+    params.Q_b_w = Q_b_w;
+    params.Q_b_a = Q_b_a;
+    params.R_s_w = R_s_w;
+    params.R_s_a = R_s_a;
+    params.stationaryWThreshold = stationaryWThreshold;
+    params.stationaryAThreshold = stationaryAThreshold;
+    params.stationaryTime = stationaryTime;
+    params.gravityGate = gravityGate;
+    params.magneticGate = magneticGate;
+    params.magneticDipGate = magneticDipGate;
+    params.timeAlignment = timeAlignment;
+    params.rollbackWindow = rollbackWindow;
+    params.a_bias = cv::Vec<qreal, 3>(a_bias.x(), a_bias.y(), a_bias.z());
+    params.engine = (IMUFusion::Engine)engine;
+    params.measurementUpdate = (IMUFusion::MeasurementUpdate)measurementUpdate;
+    params.integrator = (IMUFusion::Integrator)integrator;
+    params.deferredCovariance = deferredCovariance;
+
+    if(worker)
+        worker->setParameters(params);
+    else
+        pipeline.setParameters(params);
+}
+
+void IMU::setThreaded(bool threaded)
+{
+    if(threaded == isThreaded())
+        return;
+
+    if(threaded){
+        //Called from the worker thread, coalesced so that at most one request is on its way to the GUI thread
+        //The worker takes over the pipeline along with its sinks
+        worker = new FusionWorker(pipeline, [this](){
+            if(!publishPending.exchange(true))
+                QMetaObject::invokeMethod(this, "fusionStateReady", Qt::QueuedConnection);
+        });
     }
     else{
-        H3[0] = 0.0f; H3[1] = 0.0f; H3[2] = 0.0f; H3[3] = 0.0f;
-        H4[0] = 0.0f; H4[1] = 0.0f; H4[2] = 0.0f; H4[3] = 0.0f;
-        H5[0] = 0.0f; H5[1] = 0.0f; H5[2] = 0.0f; H5[3] = 0.0f;
+        pipeline = worker->stop();
+        delete worker;
+        worker = nullptr;
+        outputPending = false;
+        publish(true);
     }
+    emit threadedChanged();
+}
+
+void IMU::fusionStateReady()
+{
+    publishPending = false;
+    if(worker)
+        stateReady();
+}
 
-    //Calculate observation noise
-    if(startupTime > 0){
-        filter.observationNoiseCov.at<qreal>(0,0) = R_g_startup;
-        filter.observationNoiseCov.at<qreal>(1,1) = R_g_startup;
-        filter.observationNoiseCov.at<qreal>(2,2) = R_g_startup;
-        filter.observationNoiseCov.at<qreal>(3,3) = R_y_startup;
-        filter.observationNoiseCov.at<qreal>(4,4) = R_y_startup;
-        filter.observationNoiseCov.at<qreal>(5,5) = R_y_startup;
+void IMU::changeWindow(QQuickWindow* window)
+{
+    disconnect(frameSwappedConnection);
+    if(window)
+        frameSwappedConnection = connect(window, &QQuickWindow::frameSwapped, this, &IMU::windowFrameSwapped);
+}
+
+void IMU::windowFrameSwapped()
+{
+    if(outputPending && publishMode == PerFrame){
+        outputPending = false;
+        publish(true);
     }
-    else{
-        filter.observationNoiseCov.at<qreal>(0,0) = R_g;
-        filter.observationNoiseCov.at<qreal>(1,1) = R_g;
-        filter.observationNoiseCov.at<qreal>(2,2) = R_g;
-        filter.observationNoiseCov.at<qreal>(3,3) = R_y;
-        filter.observationNoiseCov.at<qreal>(4,4) = R_y;
-        filter.observationNoiseCov.at<qreal>(5,5) = R_y;
+}
+
+void IMU::outputTimerTimeout()
+{
+    if(outputPending){
+        outputPending = false;
+        publish(true);
+    }
+}
+
+void IMU::setPublishMode(PublishMode publishMode)
+{
+    if(publishMode == this->publishMode)
+        return;
+
+    this->publishMode = publishMode;
+    if(publishMode == FixedRate)
+        outputTimer.start();
+    else
+        outputTimer.stop();
+
+    //Do not hold back outputs that were waiting for the previous mode
+    if(outputPending){
+        outputPending = false;
+        publish(true);
     }
+    emit publishModeChanged();
+}
 
-    //Consumed latest magnetometer data
-    magDataReady = false;
+void IMU::setOutputRate(qreal outputRate)
+{
+    if(outputRate <= 0){
+        qCWarning(imuFusion) << "Output rate must be larger than 0, got " << outputRate;
+        return;
+    }
+    if(outputRate == this->outputRate)
+        return;
+
+    this->outputRate = outputRate;
+    outputTimer.setInterval(qMax(1, qRound(1000.0f/outputRate)));
+    emit outputRateChanged();
 }
 
-void IMU::calculateOutput()
+bool IMU::checkSensors()
 {
-    //Check existence and health of sensors
+    //Checked at every output, but reported at most once per interval so that a lasting problem doesn't flood the log
+    if(diagnosticsTimer.isValid() && !diagnosticsTimer.hasExpired(DIAGNOSTICS_INTERVAL))
+        return gyroId != "";
+
+    bool reported = false;
     if(gyroId == ""){
-        qDebug() << "Error: Cannot operate without a gyroscope!";
-        return;
+        qCCritical(imuSensors) << "Cannot operate without a gyroscope!";
+        reported = true;
     }
-    else{
-        gyroSilentCycles++;
-        if(gyroSilentCycles > 1000)
-            qDebug() << "Warning: Gyroscope is open but didn't receive data for " << gyroSilentCycles << " cycles!";
+    else if(state.gyroSilentCycles > 1000){
+        qCWarning(imuSensors) << "Gyroscope is open but didn't receive data for " << state.gyroSilentCycles << " cycles!";
+        reported = true;
     }
-    if(accId == "")
-        qDebug() << "Warning: Operating without an accelerometer, results will drift!";
-    else{
-        accSilentCycles++;
-        if(accSilentCycles > 1000)
-            qDebug() << "Warning: Accelerometer is open but didn't receive data for " << accSilentCycles << " cycles!";
+    if(accId == ""){
+        qCWarning(imuSensors) << "Operating without an accelerometer, results will drift!";
+        reported = true;
     }
-    if(magId == "")
-        qDebug() << "Warning: Operating without a magnetometer, results will drift!";
-    else{
-        magSilentCycles++;
-        if(magSilentCycles > 1000)
-            qDebug() << "Warning: Magnetometer is open but didn't receive data for " << magSilentCycles << " cycles!";
+    else if(state.accSilentCycles > 1000){
+        qCWarning(imuSensors) << "Accelerometer is open but didn't receive data for " << state.accSilentCycles << " cycles!";
+        reported = true;
+    }
+    if(magId == ""){
+        qCWarning(imuSensors) << "Operating without a magnetometer, results will drift!";
+        reported = true;
+    }
+    else if(state.magSilentCycles > 1000){
+        qCWarning(imuSensors) << "Magnetometer is open but didn't receive data for " << state.magSilentCycles << " cycles!";
+        reported = true;
+    }
+    if(unreportedDrops > 0){
+        qCWarning(imuFusion) << "Fusion thread is falling behind, dropped " << unreportedDrops << " samples!";
+        reported = true;
     }
 
+    if(reported){
+        unreportedDrops = 0;
+        diagnosticsTimer.start();
+    }
+    return gyroId != "";
+}
+
+void IMU::calculateOutput()
+{
     //Do not give output in the startup phase
     if(!isStartupComplete())
         return;
 
-    //Calculate output rotation
-    qreal* s = (qreal*)filter.statePost.ptr();
+    //Only take the outputs, their representations are calculated when they are read
+    bool biasChanged = state.gyroBias != outputGyroBias || state.accBias != outputAccBias;
+    bool stationaryFlipped = state.stationary != outputStationary;
+    outputRotation = state.rotation;
+    outputLinearAcceleration = state.linearAcceleration;
+    outputGyroBias = state.gyroBias;
+    outputAccBias = state.accBias;
+    outputStationary = state.stationary;
+    dirtyOutputs = ALL_OUTPUTS;
+
+    emit rotationChanged();
+    emit linearAccelerationChanged();
+    if(biasChanged)
+        emit estimatedBiasChanged();
+    if(stationaryFlipped){
+        updateIdle();
+        emit stationaryChanged();
+    }
+    emit targetFloorVectorChanged();
+    emit stateChanged();
+}
 
-    rotQuat.setScalar(s[0]);
-    rotQuat.setX(s[1]);
-    rotQuat.setY(s[2]);
-    rotQuat.setZ(s[3]);
+void IMU::updateOutputs(int outputs)
+{
+    outputs &= dirtyOutputs;
+    if(!outputs)
+        return;
 
-    rotAngle = sqrt(s[1]*s[1] + s[2]*s[2] + s[3]*s[3]);
-    rotAngle = 2*atan2(rotAngle, s[0]);
-    if(rotAngle < EPSILON){
-        rotAxis.setX(0.0f);
-        rotAxis.setY(0.0f);
-        rotAxis.setZ(0.0f);
-        rotAngle = 0.0f;
+    //Floor vector is calculated from the quaternion
+    if(outputs & TARGET_FLOOR_VECTOR)
+        outputs |= dirtyOutputs & ROT_QUAT;
+    dirtyOutputs &= ~outputs;
+
+    const qreal s[4] = {outputRotation(0), outputRotation(1), outputRotation(2), outputRotation(3)};
+
+    //Calculate output rotation
+    if(outputs & ROT_QUAT){
+        rotQuat.setScalar(s[0]);
+        rotQuat.setX(s[1]);
+        rotQuat.setY(s[2]);
+        rotQuat.setZ(s[3]);
     }
-    else{
-        qreal sTheta2 = sin(rotAngle/2);
-        rotAxis.setX(s[1]*sTheta2);
-        rotAxis.setY(s[2]*sTheta2);
-        rotAxis.setZ(s[3]*sTheta2);
-        rotAxis.normalize();
-        rotAngle = qRadiansToDegrees(rotAngle);
+
+    if(outputs & ROT_AXIS_ANGLE){
+        rotAngle = sqrt(s[1]*s[1] + s[2]*s[2] + s[3]*s[3]);
+        rotAngle = 2*atan2(rotAngle, s[0]);
+        if(rotAngle < EPSILON){
+            rotAxis.setX(0.0f);
+            rotAxis.setY(0.0f);
+            rotAxis.setZ(0.0f);
+            rotAngle = 0.0f;
+        }
+        else{
+            qreal sTheta2 = sin(rotAngle/2);
+            rotAxis.setX(s[1]*sTheta2);
+            rotAxis.setY(s[2]*sTheta2);
+            rotAxis.setZ(s[3]*sTheta2);
+            rotAxis.normalize();
+            rotAngle = qRadiansToDegrees(rotAngle);
+        }
     }
 
     //Calculate output linear acceleration
-    linearAcceleration.setX(s[4]);
-    linearAcceleration.setY(s[5]);
-    linearAcceleration.setZ(s[6]);
+    if(outputs & LINEAR_ACCELERATION){
+        linearAcceleration.setX(outputLinearAcceleration(0));
+        linearAcceleration.setY(outputLinearAcceleration(1));
+        linearAcceleration.setZ(outputLinearAcceleration(2));
+    }
+
+    //Calculate output biases, gyroscope readings are in deg/s
+    if(outputs & ESTIMATED_BIAS){
+        estimatedGyroBias = QVector3D(qRadiansToDegrees(outputGyroBias(0)), qRadiansToDegrees(outputGyroBias(1)), qRadiansToDegrees(outputGyroBias(2)));
+        estimatedAccBias = QVector3D(outputAccBias(0), outputAccBias(1), outputAccBias(2));
+    }
 
     //Calculate floor vector in target frame
-    targetFloorVector = rotQuat.conjugate().rotatedVector(QVector3D(0,0,1));
-    targetFloorVector = targetRotation.conjugate().rotatedVector(targetFloorVector);
+    if(outputs & TARGET_FLOOR_VECTOR){
+        targetFloorVector = rotQuat.conjugate().rotatedVector(QVector3D(0,0,1));
+        targetFloorVector = targetRotation.conjugate().rotatedVector(targetFloorVector);
+    }
+}
 
-    emit stateChanged();
+QVector3D IMU::getRotAxis()
+{
+    updateOutputs(ROT_AXIS_ANGLE);
+    return rotAxis;
 }
 
-void IMU::updateDisplacement()
+qreal IMU::getRotAngle()
 {
-    if(!isStartupComplete())
-        return;
+    updateOutputs(ROT_AXIS_ANGLE);
+    return rotAngle;
+}
 
-    qreal* s = (qreal*)filter.statePost.ptr();
+QQuaternion IMU::getRotQuat()
+{
+    updateOutputs(ROT_QUAT);
+    return rotQuat;
+}
 
-    QVector3D linearAcceleration(s[4], s[5], s[6]);
-    dispTranslation += aDeltaT*velocity + 0.5f*aDeltaT*aDeltaT*linearAcceleration;
-    velocity += aDeltaT*linearAcceleration;
+QVector3D IMU::getLinearAcceleration()
+{
+    updateOutputs(LINEAR_ACCELERATION);
+    return linearAcceleration;
+}
 
-    //Since velocity estimate random walks and is unbounded, we decay it when we assume the device is stationary
-    qreal la_norm = linearAcceleration.length();
-    qreal e_minus_w_norm = std::exp(-velocityWDecay*w_norm);
-    qreal e_minus_la_norm = std::exp(-velocityADecay*la_norm);
-    velocity = (1.0f - e_minus_w_norm)/(1.0f + e_minus_w_norm)*(1.0f - e_minus_la_norm)/(1.0f + e_minus_la_norm)*velocity;
+QVector3D IMU::getEstimatedGyroBias()
+{
+    updateOutputs(ESTIMATED_BIAS);
+    return estimatedGyroBias;
+}
+
+QVector3D IMU::getEstimatedAccBias()
+{
+    updateOutputs(ESTIMATED_BIAS);
+    return estimatedAccBias;
+}
+
+QVector3D IMU::getTargetFloorVector()
+{
+    updateOutputs(TARGET_FLOOR_VECTOR);
+    return targetFloorVector;
+}
+
+void IMU::setTargetRotation(QQuaternion const& targetRotation)
+{
+    if(this->targetRotation == targetRotation)
+        return;
+
+    this->targetRotation = targetRotation;
+    dirtyOutputs |= TARGET_FLOOR_VECTOR;
+    emit targetFloorVectorChanged();
 }
 
 void IMU::setStartupTime(qreal startupTime)
 {
-    if(this->startupTime <= 0 && startupTime > 0){
-        this->startupTime = startupTime;
+    bool restarted = worker ? worker->restartStartup(startupTime) : pipeline.restartStartup(startupTime);
+    if(restarted){
+        state = worker ? worker->getState() : pipeline.getState();
+        updateIdle();
         emit startupCompleteChanged();
     }
 }
 
 qreal IMU::getStartupTime()
 {
-    return startupTime;
+    return state.startupTime;
 }
 
 bool IMU::isStartupComplete()
 {
-    return startupTime <= 0;
+    return state.startupTime <= 0;
 }
 
 void IMU::resetDisplacement()
 {
-    qreal* s = (qreal*)filter.statePost.ptr();
-    prevRotation.setScalar(s[0]);
-    prevRotation.setVector(s[1], s[2], s[3]);
-    dispTranslation.setX(0.0f);
-    dispTranslation.setY(0.0f);
-    dispTranslation.setZ(0.0f);
+    if(worker){
+        worker->resetDisplacement();
+        state = worker->getState();
+    }
+    else{
+        pipeline.resetDisplacement();
+        state = pipeline.getState();
+    }
 }
 
 QVector3D IMU::getLinearDisplacement()
 {
-    qreal* s = (qreal*)filter.statePost.ptr();
-    QQuaternion currentRotation(s[0], s[1], s[2], s[3]);
+    QQuaternion currentRotation(state.rotation(0), state.rotation(1), state.rotation(2), state.rotation(3));
+    QQuaternion prevRotation(state.prevRotation(0), state.prevRotation(1), state.prevRotation(2), state.prevRotation(3));
+    QVector3D dispTranslation(state.dispTranslation(0), state.dispTranslation(1), state.dispTranslation(2));
+    return calculateLinearDisplacement(prevRotation, dispTranslation, currentRotation, targetTranslation, targetRotation);
+}
+
+QQuaternion IMU::getAngularDisplacement()
+{
+    QQuaternion currentRotation(state.rotation(0), state.rotation(1), state.rotation(2), state.rotation(3));
+    QQuaternion prevRotation(state.prevRotation(0), state.prevRotation(1), state.prevRotation(2), state.prevRotation(3));
+    return calculateAngularDisplacement(prevRotation, currentRotation, targetRotation);
+}
+
+int IMU::addTarget(QVector3D const& translation, QQuaternion const& rotation)
+{
+    Target target = {translation, rotation};
+    targets.append(target);
+    emit targetsChanged();
+    return targets.size() - 1;
+}
+
+void IMU::setTarget(int index, QVector3D const& translation, QQuaternion const& rotation)
+{
+    if(index < 0 || index >= targets.size())
+        return;
+
+    targets[index].translation = translation;
+    targets[index].rotation = rotation;
+    emit targetsChanged();
+}
+
+void IMU::clearTargets()
+{
+    targets.clear();
+    emit targetsChanged();
+}
+
+QVariantList IMU::getTargetDisplacements()
+{
+    QQuaternion currentRotation(state.rotation(0), state.rotation(1), state.rotation(2), state.rotation(3));
+    QQuaternion prevRotation(state.prevRotation(0), state.prevRotation(1), state.prevRotation(2), state.prevRotation(3));
+    QVector3D dispTranslation(state.dispTranslation(0), state.dispTranslation(1), state.dispTranslation(2));
+    QVector3D floorVector = currentRotation.conjugate().rotatedVector(QVector3D(0,0,1));
+
+    QVariantList displacements;
+    displacements.reserve(3*targets.size());
+    for(Target const& target : targets){
+        displacements.append(QVariant::fromValue(
+                    calculateLinearDisplacement(prevRotation, dispTranslation, currentRotation, target.translation, target.rotation)));
+        displacements.append(QVariant::fromValue(calculateAngularDisplacement(prevRotation, currentRotation, target.rotation)));
+        displacements.append(QVariant::fromValue(target.rotation.conjugate().rotatedVector(floorVector)));
+    }
+    return displacements;
+}
+
+QVector3D IMU::calculateLinearDisplacement(QQuaternion const& prevRotation, QVector3D const& dispTranslation,
+        QQuaternion const& currentRotation, QVector3D const& targetTranslation, QQuaternion const& targetRotation)
+{
     QVector3D outT =
         prevRotation.conjugate().rotatedVector(dispTranslation + currentRotation.rotatedVector(targetTranslation))
         - targetTranslation;
     return targetRotation.conjugate().rotatedVector(outT);
 }
 
-QQuaternion IMU::getAngularDisplacement()
+QQuaternion IMU::calculateAngularDisplacement(QQuaternion const& prevRotation, QQuaternion const& currentRotation,
+        QQuaternion const& targetRotation)
 {
-    qreal* s = (qreal*)filter.statePost.ptr();
-    QQuaternion currentRotation(s[0], s[1], s[2], s[3]);
     QQuaternion outR = targetRotation.conjugate()*prevRotation.conjugate()*currentRotation*targetRotation;
     outR.normalize();
     return outR;
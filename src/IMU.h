@@ -27,6 +27,9 @@
 #define IMU_H
 
 #include<QQuickItem>
+#include<QQuickWindow>
+#include<QElapsedTimer>
+#include<QTimer>
 #include<QtSensors/QSensor>
 #include<QtSensors/QAccelerometer>
 #include<QtSensors/QAccelerometerReading>
@@ -36,41 +39,130 @@
 #include<QtSensors/QMagnetometerReading>
 #include<QVector3D>
 #include<QQuaternion>
+#include<QVector>
+#include<QVariantList>
 
-#include"ExtendedKalmanFilter.h"
+#include<atomic>
+
+#include"FusionPipeline.h"
+#include"FusionWorker.h"
+#include"IMUStats.h"
+#include"SampleMerger.h"
+#include"SensorLog.h"
+#include"StateRing.h"
+#include"TrajectoryLog.h"
+#include"WarmStartCache.h"
 
 class IMU : public QQuickItem {
 Q_OBJECT
     Q_DISABLE_COPY(IMU)
+    Q_ENUMS(Engine)
+    Q_ENUMS(MeasurementUpdate)
+    Q_ENUMS(Integrator)
+    Q_ENUMS(PublishMode)
     Q_PROPERTY(QString gyroId READ getGyroId WRITE setGyroId NOTIFY gyroIdChanged)
     Q_PROPERTY(QString accId READ getAccId WRITE setAccId NOTIFY accIdChanged)
     Q_PROPERTY(QString magId READ getMagId WRITE setMagId NOTIFY magIdChanged)
-    Q_PROPERTY(QVector3D accBias MEMBER a_bias)
-    Q_PROPERTY(QVector3D rotAxis READ getRotAxis NOTIFY stateChanged)
-    Q_PROPERTY(qreal rotAngle READ getRotAngle NOTIFY stateChanged)
-    Q_PROPERTY(QQuaternion rotQuat READ getRotQuat NOTIFY stateChanged)
-    Q_PROPERTY(QVector3D linearAcceleration READ getLinearAcceleration NOTIFY stateChanged)
+    Q_PROPERTY(QVector3D accBias MEMBER a_bias NOTIFY parametersChanged)
+    Q_PROPERTY(QVector3D rotAxis READ getRotAxis NOTIFY rotationChanged)
+    Q_PROPERTY(qreal rotAngle READ getRotAngle NOTIFY rotationChanged)
+    Q_PROPERTY(QQuaternion rotQuat READ getRotQuat NOTIFY rotationChanged)
+    Q_PROPERTY(QVector3D linearAcceleration READ getLinearAcceleration NOTIFY linearAccelerationChanged)
+    Q_PROPERTY(QVector3D estimatedGyroBias READ getEstimatedGyroBias NOTIFY estimatedBiasChanged)
+    Q_PROPERTY(QVector3D estimatedAccBias READ getEstimatedAccBias NOTIFY estimatedBiasChanged)
+    Q_PROPERTY(bool stationary READ isStationary NOTIFY stationaryChanged)
     Q_PROPERTY(QVector3D targetTranslation MEMBER targetTranslation)
-    Q_PROPERTY(QQuaternion targetRotation MEMBER targetRotation)
-    Q_PROPERTY(QVector3D targetFloorVector READ getTargetFloorVector NOTIFY stateChanged)
+    Q_PROPERTY(QQuaternion targetRotation MEMBER targetRotation WRITE setTargetRotation)
+    Q_PROPERTY(QVector3D targetFloorVector READ getTargetFloorVector NOTIFY targetFloorVectorChanged)
+    Q_PROPERTY(int targetCount READ getTargetCount NOTIFY targetsChanged)
     Q_PROPERTY(qreal startupTime WRITE setStartupTime READ getStartupTime)
     Q_PROPERTY(bool startupComplete READ isStartupComplete NOTIFY startupCompleteChanged)
-    Q_PROPERTY(qreal R_g_startup MEMBER R_g_startup)
-    Q_PROPERTY(qreal R_y_startup MEMBER R_y_startup)
-    Q_PROPERTY(qreal R_g_k_0 MEMBER R_g_k_0)
-    Q_PROPERTY(qreal R_g_k_w MEMBER R_g_k_w)
-    Q_PROPERTY(qreal R_g_k_g MEMBER R_g_k_g)
-    Q_PROPERTY(qreal R_y_k_0 MEMBER R_y_k_0)
-    Q_PROPERTY(qreal R_y_k_w MEMBER R_y_k_w)
-    Q_PROPERTY(qreal R_y_k_g MEMBER R_y_k_g)
-    Q_PROPERTY(qreal R_y_k_n MEMBER R_y_k_n)
-    Q_PROPERTY(qreal R_y_k_d MEMBER R_y_k_d)
-    Q_PROPERTY(qreal m_mean_alpha MEMBER m_mean_alpha)
-    Q_PROPERTY(qreal velocityWDecay MEMBER velocityWDecay)
-    Q_PROPERTY(qreal velocityADecay MEMBER velocityADecay)
+    Q_PROPERTY(qreal R_g_startup MEMBER R_g_startup NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_startup MEMBER R_y_startup NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_g_k_0 MEMBER R_g_k_0 NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_g_k_w MEMBER R_g_k_w NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_g_k_g MEMBER R_g_k_g NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_k_0 MEMBER R_y_k_0 NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_k_w MEMBER R_y_k_w NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_k_g MEMBER R_y_k_g NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_k_n MEMBER R_y_k_n NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_y_k_d MEMBER R_y_k_d NOTIFY parametersChanged)
+    Q_PROPERTY(qreal m_mean_alpha MEMBER m_mean_alpha NOTIFY parametersChanged)
+    Q_PROPERTY(qreal velocityWDecay MEMBER velocityWDecay NOTIFY parametersChanged)
+    Q_PROPERTY(qreal velocityADecay MEMBER velocityADecay NOTIFY parametersChanged)
+    Q_PROPERTY(qreal Q_b_w MEMBER Q_b_w NOTIFY parametersChanged)
+    Q_PROPERTY(qreal Q_b_a MEMBER Q_b_a NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_s_w MEMBER R_s_w NOTIFY parametersChanged)
+    Q_PROPERTY(qreal R_s_a MEMBER R_s_a NOTIFY parametersChanged)
+    Q_PROPERTY(qreal stationaryWThreshold MEMBER stationaryWThreshold NOTIFY parametersChanged)
+    Q_PROPERTY(qreal stationaryAThreshold MEMBER stationaryAThreshold NOTIFY parametersChanged)
+    Q_PROPERTY(qreal stationaryTime MEMBER stationaryTime NOTIFY parametersChanged)
+    Q_PROPERTY(qreal gravityGate MEMBER gravityGate NOTIFY parametersChanged)
+    Q_PROPERTY(qreal magneticGate MEMBER magneticGate NOTIFY parametersChanged)
+    Q_PROPERTY(qreal magneticDipGate MEMBER magneticDipGate NOTIFY parametersChanged)
+    Q_PROPERTY(bool timeAlignment MEMBER timeAlignment NOTIFY parametersChanged)
+    Q_PROPERTY(qreal rollbackWindow MEMBER rollbackWindow NOTIFY parametersChanged)
+    Q_PROPERTY(Engine engine MEMBER engine NOTIFY parametersChanged)
+    Q_PROPERTY(MeasurementUpdate measurementUpdate MEMBER measurementUpdate NOTIFY parametersChanged)
+    Q_PROPERTY(Integrator integrator MEMBER integrator NOTIFY parametersChanged)
+    Q_PROPERTY(bool deferredCovariance MEMBER deferredCovariance NOTIFY parametersChanged)
+    Q_PROPERTY(int gyroDataRate READ getGyroDataRate WRITE setGyroDataRate NOTIFY gyroDataRateChanged)
+    Q_PROPERTY(int accDataRate READ getAccDataRate WRITE setAccDataRate NOTIFY accDataRateChanged)
+    Q_PROPERTY(int magDataRate READ getMagDataRate WRITE setMagDataRate NOTIFY magDataRateChanged)
+    Q_PROPERTY(bool adaptiveDataRate READ isAdaptiveDataRate WRITE setAdaptiveDataRate NOTIFY adaptiveDataRateChanged)
+    Q_PROPERTY(int idleDataRate READ getIdleDataRate WRITE setIdleDataRate NOTIFY idleDataRateChanged)
+    Q_PROPERTY(bool idle READ isIdle NOTIFY idleChanged)
+    Q_PROPERTY(bool threaded READ isThreaded WRITE setThreaded NOTIFY threadedChanged)
+    Q_PROPERTY(PublishMode publishMode READ getPublishMode WRITE setPublishMode NOTIFY publishModeChanged)
+    Q_PROPERTY(qreal outputRate READ getOutputRate WRITE setOutputRate NOTIFY outputRateChanged)
+    Q_PROPERTY(int bufferSize READ getBufferSize WRITE setBufferSize NOTIFY bufferSizeChanged)
+    Q_PROPERTY(QString recordFile READ getRecordFile WRITE setRecordFile NOTIFY recordFileChanged)
+    Q_PROPERTY(QString trajectoryFile READ getTrajectoryFile WRITE setTrajectoryFile NOTIFY trajectoryFileChanged)
+    Q_PROPERTY(bool trajectoryCompressed MEMBER trajectoryCompressed)
+    Q_PROPERTY(IMUStats* stats READ getStats CONSTANT)
+    Q_PROPERTY(int statsInterval READ getStatsInterval WRITE setStatsInterval NOTIFY statsIntervalChanged)
+    Q_PROPERTY(QString warmStartFile READ getWarmStartFile WRITE setWarmStartFile NOTIFY warmStartFileChanged)
+    Q_PROPERTY(qreal warmStartupTime MEMBER warmStartupTime)
 
 public:
 
+    /**
+     * @brief Which filter estimates the rotation and linear acceleration, in the same order as IMUFusion::Engine
+     */
+    enum Engine {
+        QuaternionEngine,       ///< 7 state EKF on the quaternion and linear acceleration
+        ErrorStateEngine,       ///< Multiplicative EKF on a 3 dof rotation error and linear acceleration, 6x6 covariance
+        ErrorStateBiasEngine    ///< ErrorStateEngine that also estimates gyroscope and accelerometer biases, 12x12 covariance
+    };
+
+    /**
+     * @brief How the correction step processes the observation rows, in the same order as IMUFusion::MeasurementUpdate
+     */
+    enum MeasurementUpdate {
+        FullUpdate,         ///< Always correct with all 6 rows, rows of a missing magnetic vector are zero
+        ActiveRowsUpdate,   ///< Correct with the 3 gravity rows only when there is no new magnetic vector
+        SequentialUpdate    ///< Correct with one active row at a time using scalar updates, without matrix inversion
+    };
+
+    /**
+     * @brief How the prediction step integrates the angular velocity, in the same order as IMUFusion::Integrator
+     */
+    enum Integrator {
+        FirstOrderIntegrator,   ///< q + 1/2*dt*q*(0, w), needs the gyroscope at its highest rate
+        ExponentialIntegrator,  ///< Exact rotation for an angular velocity constant between samples
+        ConingIntegrator,       ///< Exact rotation vector, with coning, for an angular velocity linear between samples
+        RK4Integrator           ///< Runge-Kutta 4 sub-steps for an angular velocity linear between samples
+    };
+
+    /**
+     * @brief When the outputs are published to QML, the filter itself always runs at the full sensor rate
+     */
+    enum PublishMode {
+        PerSample,          ///< After every sample that changes the outputs, coalesced per event loop pass when threaded
+        PerFrame,           ///< Once after every frame swap of the window, immediately when there is no window
+        FixedRate           ///< At most outputRate times per second
+    };
+
     /**
      * @brief Creates a new IMU processor with the given QML parent
      *
@@ -136,28 +228,49 @@ public:
      *
      * @return Latest estimated rotation's axis (unit norm) w.r.t ground inertial frame
      */
-    QVector3D getRotAxis(){ return rotAxis; }
+    QVector3D getRotAxis();
 
     /**
      * @brief Returns the latest estimated rotation's angle in angle-axis representation
      *
      * @return Latest estimated rotation's angle in degrees w.r.t ground inertial frame
      */
-    qreal getRotAngle(){ return rotAngle; }
+    qreal getRotAngle();
 
     /**
      * @brief Returns the latest estimated rotation in unit quaternion representation
      *
      * @return Latest estimated rotation
      */
-    QQuaternion getRotQuat(){ return rotQuat; }
+    QQuaternion getRotQuat();
 
     /**
      * @brief Returns the latest estimated linear acceleration in ground inertial frame
      *
      * @return Latest estimated linear acceleration in m/s^2
      */
-    QVector3D getLinearAcceleration(){ return linearAcceleration; }
+    QVector3D getLinearAcceleration();
+
+    /**
+     * @brief Returns the latest estimated gyroscope bias, zero unless the engine is ErrorStateBiasEngine
+     *
+     * @return Latest estimated gyroscope bias in deg/s
+     */
+    QVector3D getEstimatedGyroBias();
+
+    /**
+     * @brief Returns the latest estimated accelerometer bias on top of accBias, zero unless the engine is ErrorStateBiasEngine
+     *
+     * @return Latest estimated accelerometer bias in m/s^2
+     */
+    QVector3D getEstimatedAccBias();
+
+    /**
+     * @brief Returns whether the device is detected stationary, only the ErrorStateBiasEngine corrects with it
+     *
+     * @return Whether the device is detected stationary
+     */
+    bool isStationary(){ return outputStationary; }
 
     /**
      * @brief Sets the startup time where measurements have much greater effect and restarts startup
@@ -180,6 +293,263 @@ public:
      */
     bool isStartupComplete();
 
+    /**
+     * @brief Gets whether the fusion runs on its own thread
+     *
+     * @return Whether the fusion runs on its own thread
+     */
+    bool isThreaded(){ return worker != nullptr; }
+
+    /**
+     * @brief Sets whether the fusion runs on its own thread instead of the GUI thread
+     *
+     * When threaded, samples are handed to a worker thread and the state is published to QML as publishMode says, with
+     * PerSample at most once per event loop pass.
+     *
+     * @param threaded Whether the fusion should run on its own thread
+     */
+    void setThreaded(bool threaded);
+
+    /**
+     * @brief Gets when the outputs are published to QML
+     *
+     * @return Current publish mode
+     */
+    PublishMode getPublishMode(){ return publishMode; }
+
+    /**
+     * @brief Sets when the outputs are published to QML
+     *
+     * @param publishMode New publish mode
+     */
+    void setPublishMode(PublishMode publishMode);
+
+    /**
+     * @brief Gets the output rate used in the FixedRate publish mode
+     *
+     * @return Output rate in Hz
+     */
+    qreal getOutputRate(){ return outputRate; }
+
+    /**
+     * @brief Sets the output rate used in the FixedRate publish mode
+     *
+     * @param outputRate New output rate in Hz, must be larger than 0
+     */
+    void setOutputRate(qreal outputRate);
+
+    /**
+     * @brief Gets the requested number of readings the sensors deliver at once
+     *
+     * @return Requested buffer size, 0 for the efficient buffer size of each sensor
+     */
+    int getBufferSize(){ return bufferSize; }
+
+    /**
+     * @brief Sets the number of readings the sensors deliver at once, where the backend supports it
+     *
+     * Values are clamped to the maximum buffer size of each sensor. With buffer sizes other than 1, the readings
+     * delivered in one event loop pass are processed together in one batch.
+     *
+     * @param bufferSize New buffer size, 0 for the efficient buffer size of each sensor
+     */
+    void setBufferSize(int bufferSize);
+
+    /**
+     * @brief Gets the requested gyroscope data rate
+     *
+     * @return Requested gyroscope data rate in Hz
+     */
+    int getGyroDataRate(){ return gyroDataRate; }
+
+    /**
+     * @brief Requests a gyroscope data rate, the backend picks the nearest one it supports
+     *
+     * Lower rates save power and prediction steps; use an integrator other than FirstOrderIntegrator with them.
+     *
+     * @param gyroDataRate New data rate in Hz, must be larger than 0
+     */
+    void setGyroDataRate(int gyroDataRate);
+
+    /**
+     * @brief Gets the requested accelerometer data rate
+     *
+     * @return Requested accelerometer data rate in Hz
+     */
+    int getAccDataRate(){ return accDataRate; }
+
+    /**
+     * @brief Requests an accelerometer data rate, the backend picks the nearest one it supports
+     *
+     * @param accDataRate New data rate in Hz, must be larger than 0
+     */
+    void setAccDataRate(int accDataRate);
+
+    /**
+     * @brief Gets the requested magnetometer data rate
+     *
+     * @return Requested magnetometer data rate in Hz
+     */
+    int getMagDataRate(){ return magDataRate; }
+
+    /**
+     * @brief Requests a magnetometer data rate, the backend picks the nearest one it supports
+     *
+     * @param magDataRate New data rate in Hz, must be larger than 0
+     */
+    void setMagDataRate(int magDataRate);
+
+    /**
+     * @brief Gets whether the data rates drop to idleDataRate while the device is stationary
+     *
+     * @return Whether the data rates adapt to motion
+     */
+    bool isAdaptiveDataRate(){ return adaptiveDataRate; }
+
+    /**
+     * @brief Sets whether the data rates drop to idleDataRate while the device is stationary
+     *
+     * Once startup is complete, every sensor is asked for at most idleDataRate when the device becomes stationary
+     * and for its own data rate again as soon as it moves, trading accuracy at rest for power.
+     *
+     * @param adaptiveDataRate Whether the data rates adapt to motion
+     */
+    void setAdaptiveDataRate(bool adaptiveDataRate);
+
+    /**
+     * @brief Gets the data rate requested from every sensor while idle
+     *
+     * @return Data rate in Hz while idle
+     */
+    int getIdleDataRate(){ return idleDataRate; }
+
+    /**
+     * @brief Sets the data rate requested from every sensor while idle, sensors with a lower data rate keep it
+     *
+     * @param idleDataRate New data rate in Hz while idle, must be larger than 0
+     */
+    void setIdleDataRate(int idleDataRate);
+
+    /**
+     * @brief Gets whether the sensors run at idleDataRate because the device is stationary
+     *
+     * @return Whether the sensors run at idleDataRate
+     */
+    bool isIdle(){ return idle; }
+
+    /**
+     * @brief Gets the sensor log that raw readings are recorded to, if any
+     *
+     * @return Path of the sensor log if recording, empty string if not
+     */
+    QString getRecordFile(){ return recordFile; }
+
+    /**
+     * @brief Starts recording raw readings to a new sensor log, or stops recording
+     *
+     * Recorded logs can be replayed with tools/imu-replay. Path is set to empty string if the log can't be opened.
+     *
+     * @param recordFile Path of the sensor log to create, empty string to stop recording
+     */
+    void setRecordFile(QString const& recordFile);
+
+    /**
+     * @brief Gets the trajectory log that fused states are streamed to, if any
+     *
+     * @return Path of the trajectory log if streaming, empty string if not
+     */
+    QString getTrajectoryFile(){ return trajectoryFile; }
+
+    /**
+     * @brief Starts streaming the state after every sample since startup to a new trajectory log, or stops streaming
+     *
+     * Encoding and writing happen on a thread of the log, see TrajectoryLogWriter. Path is set to empty string if the
+     * log can't be opened.
+     *
+     * @param trajectoryFile Path of the trajectory log to create, empty string to stop streaming
+     */
+    void setTrajectoryFile(QString const& trajectoryFile);
+
+    /**
+     * @brief Gets the health and cost statistics of the fusion, updated every statsInterval milliseconds
+     *
+     * @return Statistics, owned by this IMU
+     */
+    IMUStats* getStats(){ return &stats; }
+
+    /**
+     * @brief Gets how often the statistics are updated
+     *
+     * @return Update interval in milliseconds, 0 if statistics are disabled
+     */
+    int getStatsInterval(){ return statsInterval; }
+
+    /**
+     * @brief Sets how often the statistics are updated
+     *
+     * @param statsInterval New update interval in milliseconds, 0 disables the statistics and their cost
+     */
+    void setStatsInterval(int statsInterval);
+
+    /**
+     * @brief Gets the warm start cache the fusion starts from and is saved to, if any
+     *
+     * @return Path of the warm start cache, empty string if none
+     */
+    QString getWarmStartFile(){ return warmStartFile; }
+
+    /**
+     * @brief Sets the warm start cache the fusion starts from and is saved to
+     *
+     * The cache is read when the component is complete, and written every WARM_START_INTERVAL, on saveWarmStart()
+     * and on destruction once startup is complete. A missing or incompatible cache means a cold start.
+     *
+     * @param warmStartFile Path of the warm start cache, empty string for none
+     */
+    void setWarmStartFile(QString const& warmStartFile);
+
+    /**
+     * @brief Gets the latest published snapshot of the fusion core, e.g for an IMUView
+     *
+     * @return Latest published snapshot
+     */
+    IMUFusion::State const& getState() const { return state; }
+
+    /**
+     * @brief Gets the states after every sample since startup, at the full sensor rate and regardless of the publish mode
+     *
+     * Written by the fusion thread when threaded, see StateRing for reading it from any thread.
+     *
+     * @return Latest HISTORY_CAPACITY fused states
+     */
+    StateRing const& getHistory() const { return history; }
+
+    /**
+     * @brief Calculates the position change of a target point between two poses of the IMU frame
+     *
+     * @param prevRotation Rotation of the IMU frame at the earlier pose
+     * @param dispTranslation Translation of the IMU frame from the earlier pose to the current one, in the global frame
+     * @param currentRotation Rotation of the IMU frame at the current pose
+     * @param targetTranslation Translation of the target in local rigid body frame
+     * @param targetRotation Rotation of the target in local rigid body frame
+     *
+     * @return Position of the current pose in the earlier pose frame of the target
+     */
+    static QVector3D calculateLinearDisplacement(QQuaternion const& prevRotation, QVector3D const& dispTranslation,
+            QQuaternion const& currentRotation, QVector3D const& targetTranslation, QQuaternion const& targetRotation);
+
+    /**
+     * @brief Calculates the rotation change of a target frame between two poses of the IMU frame
+     *
+     * @param prevRotation Rotation of the IMU frame at the earlier pose
+     * @param currentRotation Rotation of the IMU frame at the current pose
+     * @param targetRotation Rotation of the target in local rigid body frame
+     *
+     * @return Rotation of the current pose in the earlier pose frame of the target
+     */
+    static QQuaternion calculateAngularDisplacement(QQuaternion const& prevRotation, QQuaternion const& currentRotation,
+            QQuaternion const& targetRotation);
+
 public slots:
 
     /**
@@ -187,6 +557,13 @@ public slots:
      */
     void resetDisplacement();
 
+    /**
+     * @brief Writes the converged state of the fusion to warmStartFile
+     *
+     * @return Whether the cache was written, false if there is no cache, startup is not complete or writing failed
+     */
+    bool saveWarmStart();
+
     /**
      * @brief Gets the position change of the target point since the last call to resetDisplacement()
      *
@@ -206,7 +583,52 @@ public slots:
      *
      * @return Latest floor vector in the target frame
      */
-    QVector3D getTargetFloorVector(){ return targetFloorVector; }
+    QVector3D getTargetFloorVector();
+
+    /**
+     * @brief Sets the rotation of the target, the floor vector follows on its next read
+     *
+     * @param targetRotation Rotation of the target in local rigid body frame
+     */
+    void setTargetRotation(QQuaternion const& targetRotation);
+
+    /**
+     * @brief Registers an additional target for getTargetDisplacements()
+     *
+     * @param translation Translation of the target in local rigid body frame
+     * @param rotation Rotation of the target in local rigid body frame
+     *
+     * @return Index of the new target
+     */
+    int addTarget(QVector3D const& translation, QQuaternion const& rotation);
+
+    /**
+     * @brief Changes a registered target
+     *
+     * @param index Index of the target, nothing is done if out of range
+     * @param translation New translation of the target in local rigid body frame
+     * @param rotation New rotation of the target in local rigid body frame
+     */
+    void setTarget(int index, QVector3D const& translation, QQuaternion const& rotation);
+
+    /**
+     * @brief Removes all registered targets
+     */
+    void clearTargets();
+
+    /**
+     * @brief Returns the number of registered targets
+     *
+     * @return Number of registered targets
+     */
+    int getTargetCount(){ return targets.size(); }
+
+    /**
+     * @brief Gets the displacements and floor vectors of all registered targets since the last call to resetDisplacement()
+     *
+     * @return For each target in order, its linear displacement (vector3d), angular displacement (quaternion) and floor vector (vector3d), i.e 3 entries per target
+     */
+    QVariantList getTargetDisplacements();
 
     /**
      * @brief Callback for a parent change event
@@ -232,6 +654,43 @@ private slots:
      */
     void magReadingChanged();
 
+    /**
+     * @brief Passes the latest parameters to the fusion core
+     */
+    void syncParameters();
+
+    /**
+     * @brief Called when the worker thread has a new state to publish
+     */
+    void fusionStateReady();
+
+    /**
+     * @brief Called when the window changes, to follow its frames
+     *
+     * @param window New window, may be nullptr
+     */
+    void changeWindow(QQuickWindow* window);
+
+    /**
+     * @brief Called after a frame is rendered, publishes the pending snapshot in the PerFrame mode
+     */
+    void windowFrameSwapped();
+
+    /**
+     * @brief Called by the output timer, publishes the pending snapshot in the FixedRate mode
+     */
+    void outputTimerTimeout();
+
+    /**
+     * @brief Processes all samples that are released by the merger in timestamp order
+     */
+    void flushSamples();
+
+    /**
+     * @brief Called by the statistics timer, takes the statistics of the fusion core into stats
+     */
+    void statsTimerTimeout();
+
 signals:
 
     /**
@@ -250,21 +709,138 @@ signals:
     void magIdChanged();
 
     /**
-     * @brief Emitted when the estimated rotation and linear acceleration changes
+     * @brief Emitted once per published snapshot, after the signals of the outputs that changed
      */
     void stateChanged();
 
+    /**
+     * @brief Emitted when the estimated rotation changes, i.e rotQuat, rotAxis and rotAngle
+     */
+    void rotationChanged();
+
+    /**
+     * @brief Emitted when the estimated linear acceleration changes
+     */
+    void linearAccelerationChanged();
+
+    /**
+     * @brief Emitted when the estimated gyroscope or accelerometer bias changes
+     */
+    void estimatedBiasChanged();
+
+    /**
+     * @brief Emitted when the device becomes stationary or starts moving
+     */
+    void stationaryChanged();
+
+    /**
+     * @brief Emitted when the floor vector changes, i.e when the rotation or the target rotation changes
+     */
+    void targetFloorVectorChanged();
+
+    /**
+     * @brief Emitted when a target is registered, changed or removed
+     */
+    void targetsChanged();
+
     /**
      * @brief Emitted when the startup time ends
      */
     void startupCompleteChanged();
 
+    /**
+     * @brief Emitted when one of the fusion parameters changes
+     */
+    void parametersChanged();
+
+    /**
+     * @brief Emitted when the fusion moves to or from its own thread
+     */
+    void threadedChanged();
+
+    /**
+     * @brief Emitted when the publish mode changes
+     */
+    void publishModeChanged();
+
+    /**
+     * @brief Emitted when the output rate changes
+     */
+    void outputRateChanged();
+
+    /**
+     * @brief Emitted when the buffer size changes
+     */
+    void bufferSizeChanged();
+
+    /**
+     * @brief Emitted when the requested gyroscope data rate changes
+     */
+    void gyroDataRateChanged();
+
+    /**
+     * @brief Emitted when the requested accelerometer data rate changes
+     */
+    void accDataRateChanged();
+
+    /**
+     * @brief Emitted when the requested magnetometer data rate changes
+     */
+    void magDataRateChanged();
+
+    /**
+     * @brief Emitted when adaptive data rates are enabled or disabled
+     */
+    void adaptiveDataRateChanged();
+
+    /**
+     * @brief Emitted when the data rate while idle changes
+     */
+    void idleDataRateChanged();
+
+    /**
+     * @brief Emitted when the sensors drop to or come back from idleDataRate
+     */
+    void idleChanged();
+
+    /**
+     * @brief Emitted when recording starts or stops
+     */
+    void recordFileChanged();
+
+    /**
+     * @brief Emitted when streaming to a trajectory log starts or stops
+     */
+    void trajectoryFileChanged();
+
+    /**
+     * @brief Emitted when the statistics update interval changes
+     */
+    void statsIntervalChanged();
+
+    /**
+     * @brief Emitted when the warm start cache changes
+     */
+    void warmStartFileChanged();
+
+protected:
+
+    /**
+     * @brief Warm starts the fusion from warmStartFile once all properties are set
+     */
+    void componentComplete();
+
 private:
 
+    /**
+     * @brief Warm starts the fusion from warmStartFile if it is readable and no samples were processed yet
+     */
+    void loadWarmStart();
+
     /**
      * @brief Attemps to open gyroscope with given id
      *
-     * If successful, sets rate to maximum and starts sensor
+     * If successful, releases the previous one; the sensor is shared with its other consumers through SensorHub
      *
      * @param id Identifier of the sensor to be opened
      *
@@ -275,7 +851,7 @@ private:
     /**
      * @brief Attempts to open accelerometer with given id
      *
-     * If successful, sets rate to maximum and starts sensor
+     * If successful, releases the previous one; the sensor is shared with its other consumers through SensorHub
      *
      * @param id Identifier of the sensor to be opened
      *
@@ -286,7 +862,7 @@ private:
     /**
      * @brief Attempts to open magnetometer with given id
      *
-     * If successful, sets rate to maximum and starts sensor
+     * If successful, releases the previous one; the sensor is shared with its other consumers through SensorHub
      *
      * @param id Identifier of the sensor to be opened
      *
@@ -295,83 +871,125 @@ private:
     bool openMag(QByteArray const& id);
 
     /**
-     * @brief Normalizes given quaternion to unit norm
+     * @brief Feeds a new sample to the fusion core in timestamp order, directly or through the worker thread
      *
-     * @param quat Quaternion to normalize
+     * @param sample New sample
      */
-    void normalizeQuat(cv::Mat& quat);
+    void processSample(IMUFusion::Sample const& sample);
 
     /**
-     * @brief Ensures the sign of the quaternion is right so that we prevent quaternion unwinding
-     *
-     * @param prevQuat Previous value of the quaternion
-     * @param quat Current value of the quaternion to be corrected
+     * @brief Called when the fusion core has new outputs, publishes them now or later depending on the publish mode
      */
-    void shortestPathQuat(cv::Mat& prevQuat, cv::Mat& quat);
+    void stateReady();
 
     /**
-     * @brief Calculates and records the process values
+     * @brief Refreshes the snapshot from the fusion core and publishes it to QML
      *
-     * Calculates the following:
-     * Process value f(x'(k-1|k-1), U(k-1))
-     * Transition matrix F(k-1)
-     * Process noise covariance matrix Q(k-1)
+     * @param changed Whether the outputs changed and stateChanged() should be emitted
      */
-    void calculateProcess();
+    void publish(bool changed);
 
     /**
-     * @brief Calculates and records predicted observation values
+     * @brief Checks existence and health of sensors, reports problems at most once per DIAGNOSTICS_INTERVAL
      *
-     * Calculates the following:
-     * Observation value z(k)
-     * Predicted observation value h(x'(k|k+1))
-     * Observation matrix H(k)
+     * @return Whether the outputs can be calculated, i.e whether there is a gyroscope
      */
-    void calculateObservation();
+    bool checkSensors();
 
     /**
-     * @brief Calculates and stores the rotation and the linear acceleration in global ground inertial frame
+     * @brief Takes the outputs from the snapshot and notifies their changes, their representations are calculated on their next read
      */
     void calculateOutput();
 
     /**
-     * @brief Updates the displacement values
+     * @brief Gets the data rate to request from a sensor, lowered while idle
+     *
+     * @param dataRate Data rate in Hz requested for the sensor
      *
-     * Updates the displacement translation and velocity estimate.
-     * Displacement rotation needs no update and can be calculated from the current device rotation.
+     * @return Data rate in Hz to request
      */
-    void updateDisplacement();
+    int effectiveDataRate(int dataRate){ return idle ? qMin(dataRate, idleDataRate) : dataRate; }
 
-    static const int CV_TYPE;       ///< CV_64F or CV_32f
-    static const qreal EPSILON;     ///< FLT_EPSILON or DBL_EPSILON
-
-    QString gyroId;                 ///< Gyroscope identifier, empty string when not open
-    QString accId;                  ///< Accelerometer identifier, empty string when not open
-    QString magId;                  ///< Magnetometer identifier, empty string when not open
+    /**
+     * @brief Requests the effective data rates and the buffer size from all open sensors
+     */
+    void requestSensors();
 
-    QGyroscope* gyro;               ///< Gyroscope sensor, nullptr when not open
-    QAccelerometer* acc;            ///< Accelerometer sensor, nullptr when not open
-    QMagnetometer* mag;             ///< Magnetometers sensor, nullptr when not open
+    /**
+     * @brief Goes idle or back to full data rates as the device stops or starts moving
+     */
+    void updateIdle();
 
-    quint64 lastGyroTimestamp;      ///< Most recent gyroscope measurement timestamp
-    quint64 lastAccTimestamp;       ///< Most recent accelerometer measurement timestamp
-    quint64 lastMagTimestamp;       ///< Most recent magnetometer measurement timestamp
+    /**
+     * @brief Calculates the representations of the outputs in dirtyOutputs that are in the given set
+     *
+     * @param outputs Set of Output flags to bring up to date
+     */
+    void updateOutputs(int outputs);
 
-    unsigned int gyroSilentCycles;  ///< Data publish cycles without gyroscope data
-    unsigned int accSilentCycles;   ///< Data publish cycles without accelerometer data
-    unsigned int magSilentCycles;   ///< Data publish cycles without magnetometer data
+    /**
+     * @brief Representations of the outputs, calculated lazily from the published outputs
+     */
+    enum Output{
+        ROT_QUAT = 1,               ///< rotQuat
+        ROT_AXIS_ANGLE = 2,         ///< rotAxis and rotAngle
+        LINEAR_ACCELERATION = 4,    ///< linearAcceleration
+        ESTIMATED_BIAS = 8,         ///< estimatedGyroBias and estimatedAccBias
+        TARGET_FLOOR_VECTOR = 16,   ///< targetFloorVector
+        ALL_OUTPUTS = 31            ///< All of the above
+    };
 
-    ExtendedKalmanFilter filter;    ///< Filter that estimates current tilt and linear acceleration in ground frame
+    static const qreal EPSILON;     ///< FLT_EPSILON or DBL_EPSILON
+    static const int DIAGNOSTICS_INTERVAL = 5000; ///< Minimum milliseconds between two reports of sensor problems
+    static const int WARM_START_INTERVAL = 10000; ///< Milliseconds between two writes of the warm start cache
+    static const int HISTORY_CAPACITY = 4096; ///< Number of fused states kept in history, about 20 s at a 200 Hz gyroscope
 
-    cv::Mat Q;                      ///< Base for process noise covariance matrix
-    cv::Mat process;                ///< Temporary matrix to hold the calculated process value, i.e rotation and acceleration
-    cv::Mat observation;            ///< Temporary matrix to hold gravity and magnetometer observation
-    cv::Mat predictedObservation;   ///< Temporary matrix to hold gravity and magnetometer expectation based on current rotation
+    QString gyroId;                 ///< Gyroscope identifier, empty string when not open
+    QString accId;                  ///< Accelerometer identifier, empty string when not open
+    QString magId;                  ///< Magnetometer identifier, empty string when not open
 
-    cv::Mat statePreHistory;        ///< Previous value of the a priori state for quaternion sign correction
-    cv::Mat statePostHistory;       ///< Previous value of the a posteriori state for quaternion sign correction
+    QGyroscope* gyro;               ///< Gyroscope sensor shared through SensorHub, nullptr when not open
+    QAccelerometer* acc;            ///< Accelerometer sensor shared through SensorHub, nullptr when not open
+    QMagnetometer* mag;             ///< Magnetometers sensor shared through SensorHub, nullptr when not open
+
+    FusionPipeline pipeline;        ///< Fusion core behind its scheduler, writing to history and trajectory, used directly when not threaded
+    FusionWorker* worker;           ///< Runs the fusion core on its own thread, nullptr when not threaded
+    std::atomic<bool> publishPending; ///< Whether a publish request from the worker thread is on its way
+    PublishMode publishMode;        ///< When the outputs are published to QML
+    qreal outputRate;               ///< Output rate in Hz in the FixedRate publish mode
+    QTimer outputTimer;             ///< Publishes the pending snapshot in the FixedRate publish mode
+    bool outputPending;             ///< Whether new outputs wait for the next frame or timer tick to be published
+
+    int bufferSize;                 ///< Requested number of readings the sensors deliver at once, 0 for efficient size
+    int gyroDataRate;               ///< Requested gyroscope data rate in Hz
+    int accDataRate;                ///< Requested accelerometer data rate in Hz
+    int magDataRate;                ///< Requested magnetometer data rate in Hz
+    bool adaptiveDataRate;          ///< Whether the data rates drop to idleDataRate while stationary
+    int idleDataRate;               ///< Data rate in Hz requested from every sensor while idle
+    bool idle;                      ///< Whether the sensors are asked for idleDataRate at most
+    SampleMerger merger;            ///< Orders the samples of the three sensors by timestamp
+    bool flushPending;              ///< Whether a flushSamples() call is on its way
+
+    QString recordFile;             ///< Path of the sensor log that raw readings are recorded to, empty when not recording
+    SensorLogWriter recorder;       ///< Records raw readings when open
+    QString trajectoryFile;         ///< Path of the trajectory log that fused states are streamed to, empty when not streaming
+    bool trajectoryCompressed;      ///< Whether the chunks of the trajectory log are compressed, taken when it is opened
+    TrajectoryLogWriter trajectory; ///< Streams fused states when open, fed by the fusion thread when threaded
+    QMetaObject::Connection frameSwappedConnection; ///< Connection to the frameSwapped() signal of the current window
+
+    IMUStats stats;                 ///< Latest statistics
+    int statsInterval;              ///< Statistics update interval in milliseconds, 0 when disabled
+    QTimer statsTimer;              ///< Takes the statistics every statsInterval
+    int maxQueueDepth;              ///< Largest fusion thread queue depth since the last statistics update
+    unsigned int queueDrops[3];     ///< Samples of each IMUFusion::Sample::Type dropped by a full fusion queue since the last statistics update
+    unsigned int unreportedDrops;   ///< Samples dropped by a full fusion queue since the last report
+    QElapsedTimer diagnosticsTimer; ///< Time since sensor problems were last reported, invalid if never
+    QString warmStartFile;          ///< Path of the warm start cache, empty if none
+    qreal warmStartupTime;          ///< Startup time in seconds after a warm start
+    QTimer warmStartTimer;          ///< Writes the warm start cache every WARM_START_INTERVAL
+    IMUFusion::State state;         ///< Latest snapshot of the fusion core
+    StateRing history;              ///< States after every sample since startup, written by the fusion thread when threaded
 
-    qreal startupTime;              ///< Time to spend with low R entries for a fast initial stabilization of absolute axes
     qreal R_g_startup;              ///< Diagonal entries of gravity obs noise during startup, must be lower than usual
     qreal R_y_startup;              ///< Diagonal entries of magnetometer obs noise during startup, must be lower than usual
 
@@ -384,22 +1002,25 @@ private:
     qreal R_y_k_n;                  ///< Unit y vector observation norm noise coefficient
     qreal R_y_k_d;                  ///< Unit y vector observation dip angle noise coefficient
 
-    QVector3D w;                    ///< Latest angular velocity in local frame in rad/s
-    qreal wDeltaT;                  ///< Latest time slice for angular velocity
-    QVector3D a;                    ///< Latest acceleration vector in local frame in m/s^2
-    qreal aDeltaT;                  ///< Latest time slice for linear acceleration
-    QVector3D m;                    ///< Latest magnetic vector in local frame in milliTeslas
-    bool magDataReady;              ///< Whether new magnetometer data arrived
-
-    qreal w_norm;                   ///< Magnitude of the latest angular velocity, for noise calculation
-    qreal a_norm;                   ///< Magnitude of the latest acceleration, for noise calculation
-    qreal m_norm;                   ///< Magnitude of the latest magnetic vector, for noise calculation
-    qreal m_norm_mean;              ///< Mean magnitude of the measured magnetic vector
-    qreal m_dip_angle_mean;         ///< Mean dip angle between magnetic vector and floor vector
+    Engine engine;                  ///< Which filter estimates the rotation and linear acceleration
+    MeasurementUpdate measurementUpdate; ///< How the correction step processes the observation rows
+    Integrator integrator;          ///< How the prediction step integrates the angular velocity
+    bool deferredCovariance;        ///< Whether the covariance prediction of gyroscope samples waits for the next correction
+
     qreal m_mean_alpha;             ///< Smoothing factor for magnetic mean and dip angle mean estimate
 
     QVector3D a_bias;               ///< Accelerometer bias
 
+    /// @defgroup imuOutput Published outputs, taken from the snapshot when it is published after startup
+    /// @{
+    IMUFusion::Quaternion outputRotation;           ///< Rotation of the IMU frame w.r.t ground inertial frame
+    IMUFusion::Vector outputLinearAcceleration;     ///< Linear acceleration w.r.t ground inertial frame in m/s^2
+    IMUFusion::Vector outputGyroBias;               ///< Estimated gyroscope bias in rad/s
+    IMUFusion::Vector outputAccBias;                ///< Estimated accelerometer bias on top of a_bias in m/s^2
+    bool outputStationary;                          ///< Whether the device is detected stationary
+    int dirtyOutputs;                               ///< Set of Output flags whose representations are out of date
+    /// @}
+
     /// @defgroup imuState State of the IMU frame w.r.t ground inertial frame
     /// @{
     QVector3D rotAxis;              ///< Rotation axis in axis-angle representation
@@ -408,16 +1029,40 @@ private:
     QVector3D linearAcceleration;   ///< Linear acceleration w.r.t ground inertial frame in m/s^2
     /// @}
 
+    QVector3D estimatedGyroBias;    ///< Estimated gyroscope bias in deg/s
+    QVector3D estimatedAccBias;     ///< Estimated accelerometer bias on top of a_bias in m/s^2
+
     QVector3D targetTranslation;    ///< Translation of target in local rigid body frame for which displacement will be calculated
     QQuaternion targetRotation;     ///< Rotation of target in local rigid body frame for which displacement will be calculated
     QVector3D targetFloorVector;    ///< Unit floor vector in the target frame
-    QVector3D velocity;             ///< Estimated linear velocity
+
+    /**
+     * @brief Rigid body target registered with addTarget()
+     */
+    struct Target{
+        QVector3D translation;      ///< Translation in local rigid body frame
+        QQuaternion rotation;       ///< Rotation in local rigid body frame
+    };
+
+    QVector<Target> targets;        ///< Targets for getTargetDisplacements()
 
     qreal velocityWDecay;           ///< How quickly velocity estimate decays w.r.t angular velocity magnitude
     qreal velocityADecay;           ///< How quickly velocity estimate decays w.r.t linear acceleration magnitude
 
-    QQuaternion prevRotation;       ///< Rotation of IMU frame in the global frame at the last displacement reset
-    QVector3D dispTranslation;      ///< Translation of IMU frame in the global frame since the last displacement reset
+    qreal Q_b_w;                    ///< Gyroscope bias random walk noise in (rad/s)^2 per second
+    qreal Q_b_a;                    ///< Accelerometer bias random walk noise in (m/s^2)^2 per second
+    qreal R_s_w;                    ///< Zero angular velocity observation noise while stationary
+    qreal R_s_a;                    ///< Zero linear acceleration observation noise while stationary
+    qreal stationaryWThreshold;     ///< Largest angular velocity magnitude in rad/s that counts as stationary
+    qreal stationaryAThreshold;     ///< Largest deviation of the acceleration magnitude from gravity in m/s^2 that counts as stationary
+    qreal stationaryTime;           ///< Time in seconds within both thresholds before the device is stationary
+
+    qreal gravityGate;              ///< Largest squared Mahalanobis distance of the gravity innovation before the correction is skipped, 0 to disable
+    qreal magneticGate;             ///< Largest squared Mahalanobis distance of the magnetic innovation before it is rejected, 0 to disable
+    qreal magneticDipGate;          ///< Largest deviation of the magnetic dip angle from its mean in radians before it is rejected, 0 to disable
+
+    bool timeAlignment;             ///< Whether accelerometer and magnetometer samples are fused at their exact timestamp
+    qreal rollbackWindow;           ///< How late in seconds a sample may be and still be fused at its timestamp, 0 to disable
 };
 
 #endif /* IMU_H */
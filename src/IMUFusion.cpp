@@ -0,0 +1,1591 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUFusion.cpp
+ * @brief Implementation of the gyroscope, accelerometer and magnetometer fusion core
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"IMUFusion.h"
+
+#include<algorithm>
+#include<type_traits>
+#include<cfloat>
+#include<chrono>
+#include<cmath>
+
+template<typename Scalar, typename CovScalar>
+const Scalar BasicIMUFusion<Scalar, CovScalar>::EPSILON = std::is_same<Scalar, double>::value ? DBL_EPSILON : FLT_EPSILON;
+template<typename Scalar, typename CovScalar>
+const Scalar BasicIMUFusion<Scalar, CovScalar>::RK4_SUBSTEP_ANGLE = 0.1f;
+template<typename Scalar, typename CovScalar>
+const int BasicIMUFusion<Scalar, CovScalar>::RK4_MAX_SUBSTEPS = 16;
+
+IMUFusionBase::Parameters::Parameters() :
+    R_g_startup(1e-1f),
+    R_y_startup(1e-3f),
+    R_g_k_0(1.0f),  //This depends on the two coefficients below
+    R_g_k_w(7.5f),  //This depends on gyroscope sensor limits, typically 250 deg/s = 7.6 rad/s
+    R_g_k_g(10.0f), //This depends on accelerometer sensor limits, typically 2g
+    R_y_k_0(10.0f),  //This depends on the four coefficients below
+    R_y_k_w(7.5f),   //This depends on gyroscope sensor limits, typically 250 deg/s = 7.6 rad/s
+    R_y_k_g(10.0f),  //This depends on the accelerometer sensor limits, typically 2g
+    R_y_k_n(20.0f),  //This depends on magnetic vector magnitude in milliTeslas
+    R_y_k_d(15.0f),  //This depents on magnetic vector dip against floor vector, in radians
+    m_mean_alpha(0.99f),
+    velocityWDecay(15.0f),
+    velocityADecay(8.0f),
+    Q_b_w(1e-9f),   //About 0.1 deg/s of drift per hour
+    Q_b_a(1e-6f),
+    R_s_w(1e-4f),   //This depends on gyroscope noise at rest, typically 0.5 deg/s = 0.01 rad/s
+    R_s_a(1e-2f),
+    stationaryWThreshold(0.05f),
+    stationaryAThreshold(0.3f),
+    stationaryTime(0.5f),
+    gravityGate(0),
+    magneticGate(0),
+    magneticDipGate(0),
+    rollbackWindow(0),
+    a_bias(0, 0, 0),
+    engine(QUATERNION_ENGINE),
+    measurementUpdate(ACTIVE_ROWS_UPDATE),
+    integrator(FIRST_ORDER_INTEGRATOR),
+    deferredCovariance(false),
+    timeAlignment(false)
+{}
+
+namespace{
+
+//Scalar coefficients that can be accessed by name
+struct NamedParameter{
+    const char* name;
+    qreal IMUFusionBase::Parameters::* member;
+};
+
+const NamedParameter NAMED_PARAMETERS[] = {
+    {"R_g_startup",     &IMUFusionBase::Parameters::R_g_startup},
+    {"R_y_startup",     &IMUFusionBase::Parameters::R_y_startup},
+    {"R_g_k_0",         &IMUFusionBase::Parameters::R_g_k_0},
+    {"R_g_k_w",         &IMUFusionBase::Parameters::R_g_k_w},
+    {"R_g_k_g",         &IMUFusionBase::Parameters::R_g_k_g},
+    {"R_y_k_0",         &IMUFusionBase::Parameters::R_y_k_0},
+    {"R_y_k_w",         &IMUFusionBase::Parameters::R_y_k_w},
+    {"R_y_k_g",         &IMUFusionBase::Parameters::R_y_k_g},
+    {"R_y_k_n",         &IMUFusionBase::Parameters::R_y_k_n},
+    {"R_y_k_d",         &IMUFusionBase::Parameters::R_y_k_d},
+    {"m_mean_alpha",    &IMUFusionBase::Parameters::m_mean_alpha},
+    {"velocityWDecay",  &IMUFusionBase::Parameters::velocityWDecay},
+    {"velocityADecay",  &IMUFusionBase::Parameters::velocityADecay},
+    {"Q_b_w",           &IMUFusionBase::Parameters::Q_b_w},
+    {"Q_b_a",           &IMUFusionBase::Parameters::Q_b_a},
+    {"R_s_w",           &IMUFusionBase::Parameters::R_s_w},
+    {"R_s_a",           &IMUFusionBase::Parameters::R_s_a},
+    {"stationaryWThreshold", &IMUFusionBase::Parameters::stationaryWThreshold},
+    {"stationaryAThreshold", &IMUFusionBase::Parameters::stationaryAThreshold},
+    {"stationaryTime",  &IMUFusionBase::Parameters::stationaryTime},
+    {"gravityGate",     &IMUFusionBase::Parameters::gravityGate},
+    {"magneticGate",    &IMUFusionBase::Parameters::magneticGate},
+    {"magneticDipGate", &IMUFusionBase::Parameters::magneticDipGate},
+    {"rollbackWindow",  &IMUFusionBase::Parameters::rollbackWindow}
+};
+
+const int NUM_NAMED_PARAMETERS = sizeof(NAMED_PARAMETERS)/sizeof(NAMED_PARAMETERS[0]);
+
+}
+
+QStringList IMUFusionBase::Parameters::names()
+{
+    QStringList names;
+    for(int i = 0; i < NUM_NAMED_PARAMETERS; i++)
+        names << NAMED_PARAMETERS[i].name;
+    return names;
+}
+
+bool IMUFusionBase::Parameters::set(QString const& name, qreal value)
+{
+    for(int i = 0; i < NUM_NAMED_PARAMETERS; i++)
+        if(name == NAMED_PARAMETERS[i].name){
+            this->*NAMED_PARAMETERS[i].member = value;
+            return true;
+        }
+    return false;
+}
+
+bool IMUFusionBase::Parameters::get(QString const& name, qreal& value) const
+{
+    for(int i = 0; i < NUM_NAMED_PARAMETERS; i++)
+        if(name == NAMED_PARAMETERS[i].name){
+            value = this->*NAMED_PARAMETERS[i].member;
+            return true;
+        }
+    return false;
+}
+
+template<typename Scalar, typename CovScalar>
+BasicIMUFusion<Scalar, CovScalar>::State::State() :
+    timestamp(0),
+    rotation(1.0f, 0.0f, 0.0f, 0.0f),
+    linearAcceleration(0.0f, 0.0f, 0.0f),
+    velocity(0.0f, 0.0f, 0.0f),
+    gyroBias(0.0f, 0.0f, 0.0f),
+    accBias(0.0f, 0.0f, 0.0f),
+    stationary(false),
+    prevRotation(1.0f, 0.0f, 0.0f, 0.0f),
+    dispTranslation(0.0f, 0.0f, 0.0f),
+    translation(0.0f, 0.0f, 0.0f),
+    startupTime(1.0f),
+    gyroSilentCycles(0),
+    accSilentCycles(0),
+    magSilentCycles(0)
+{}
+
+IMUFusionBase::Statistics::Statistics() :
+    predictions(0),
+    predictTimeSum(0),
+    predictTimeMax(0),
+    corrections(0),
+    correctTimeSum(0),
+    correctTimeMax(0),
+    innovationSum(0),
+    innovationMax(0),
+    gravityRejected(0),
+    magRejected(0),
+    rollbacks(0)
+{
+    Sensor empty = {0, 0, 0, 0, 0};
+    gyro = empty;
+    acc = empty;
+    mag = empty;
+}
+
+template<typename Scalar, typename CovScalar>
+BasicIMUFusion<Scalar, CovScalar>::WarmStart::WarmStart() :
+    rotation(1.0f, 0.0f, 0.0f, 0.0f),
+    gyroBias(0.0f, 0.0f, 0.0f),
+    accBias(0.0f, 0.0f, 0.0f),
+    biasCov(cv::Matx<CovScalar, 6, 6>::zeros()),
+    m_norm_mean(-1),
+    m_dip_angle_mean(-1)
+{}
+
+template<typename Scalar, typename CovScalar>
+BasicIMUFusion<Scalar, CovScalar>::BasicIMUFusion(qreal startupTime) :
+    lastGyroTimestamp(0),
+    lastAccTimestamp(0),
+    lastMagTimestamp(0),
+    predictedTimestamp(0),
+    nominalQuat(1.0f, 0.0f, 0.0f, 0.0f),
+    stationaryElapsed(0),
+    stationaryWMean(-1),
+    stationaryAMean(-1),
+    pendingPredictions(0),
+    pendingDeltaQuat(1.0f, 0.0f, 0.0f, 0.0f),
+    pendingQuatNoise(cv::Matx<CovScalar, 4, 4>::zeros()),
+    w(0, 0, 0),
+    wRaw(0, 0, 0),
+    wPrev(0, 0, 0),
+    wDeltaT(0),
+    aDeltaT(0),
+    magDataReady(false),
+    numAlignedSamples(0),
+    alignTiltPending(false),
+    alignHeadingPending(false),
+    w_norm(0),
+    a_norm(0),
+    m_norm(0),
+    m_norm_mean(-1),
+    m_dip_angle_mean(-1),
+    statisticsEnabled(false),
+    gyroMeanDeltaT(0),
+    accMeanDeltaT(0),
+    magMeanDeltaT(0)
+{
+    state.startupTime = startupTime;
+    std::fill(replayedTimestamps, replayedTimestamps + 3, 0);
+
+    //Just do assumptions for initial values
+    process =           typename Filter::StateVector(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    filter.statePre =   typename Filter::StateVector(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    statePreHistory =   cv::Matx<Scalar, 4, 1>(1.0f, 0.0f, 0.0f, 0.0f);
+    filter.statePost =  typename Filter::StateVector(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f ,0.0f);
+    statePostHistory =  cv::Matx<Scalar, 4, 1>(1.0f, 0.0f, 0.0f, 0.0f);
+
+    const Scalar g = 9.81f;
+    observation =           typename Filter::ObservationVector(0.0f, 0.0f, g, 0.0f, 1.0f, 0.0f);
+    predictedObservation =  typename Filter::ObservationVector(0.0f, 0.0f, g, 0.0f, 1.0f, 0.0f);
+
+    const CovScalar F[7*7] = {
+            1.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   1.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   1.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   1.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f};
+    filter.transitionMatrix = typename Filter::StateMatrix(F);
+
+    //Process noise covariance matrix is deltaT*Q at each step
+    const CovScalar Q0[7*7] = {
+            1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   1e-4f,  0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   1e-2f};
+    Q = typename Filter::StateMatrix(Q0);
+    filter.errorCovPre = Q;
+
+    //Error state engine, a rotation error angle is about twice the quaternion vector error
+    //The linear acceleration does not depend on any state, calculateErrorProcess() only fills the rotation columns
+    errorProcess = ErrorFilter::StateVector::zeros();
+    errorFilter.transitionMatrix = ErrorFilter::StateMatrix::zeros();
+    const CovScalar errorQ0[6*6] = {
+            4e-4f,  0.0f,   0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   4e-4f,  0.0f,   0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   4e-4f,  0.0f,   0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,   0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   1e-2f,  0.0f,
+            0.0f,   0.0f,   0.0f,   0.0f,   0.0f,   1e-2f};
+    errorQ = typename ErrorFilter::StateMatrix(errorQ0);
+    errorFilter.errorCovPre = errorQ;
+
+    //Bias engine, the biases carry over and the linear acceleration does not depend on any state
+    biasProcess = BiasFilter::StateVector::zeros();
+    biasFilter.transitionMatrix = BiasFilter::StateMatrix::zeros();
+    for(int i = 3; i < 9; i++)
+        biasFilter.transitionMatrix(i,i) = 1.0f;
+    biasFilter.processNoiseCov = BiasFilter::StateMatrix::zeros();
+    resetBiasFilter(Quaternion(1.0f, 0.0f, 0.0f, 0.0f), Vector(0.0f, 0.0f, 0.0f));
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::resetBiasFilter(Quaternion const& rotation, Vector const& linearAcceleration)
+{
+    nominalQuat = rotation;
+    biasFilter.statePost = BiasFilter::StateVector::zeros();
+    biasFilter.statePost(9) = linearAcceleration(0);
+    biasFilter.statePost(10) = linearAcceleration(1);
+    biasFilter.statePost(11) = linearAcceleration(2);
+    biasFilter.statePre = biasFilter.statePost;
+
+    biasFilter.errorCovPost = BiasFilter::StateMatrix::zeros();
+    biasFilter.errorCovPre = biasFilter.errorCovPost;
+
+    //Biases start unknown within about 0.5 deg/s and 0.1 m/s^2
+    biasStartCov = cv::Matx<CovScalar, 6, 6>::zeros();
+    for(int i = 0; i < 3; i++){
+        biasStartCov(i,i) = 1e-4f;
+        biasStartCov(i + 3,i + 3) = 1e-2f;
+    }
+    if(isStartupComplete())
+        startBiasEstimation();
+    stationaryElapsed = 0;
+    stationaryWMean = -1;
+    stationaryAMean = -1;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::startBiasEstimation()
+{
+    for(int i = 0; i < 6; i++)
+        for(int j = 0; j < 6; j++){
+            biasFilter.errorCovPost(i + 3,j + 3) = biasStartCov(i,j);
+            biasFilter.errorCovPre(i + 3,j + 3) = biasStartCov(i,j);
+        }
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::setParameters(Parameters const& params)
+{
+    //Held samples are fused with the latest angular velocity rather than waiting for a gyroscope sample that will not split them
+    if(this->params.timeAlignment && !params.timeAlignment)
+        flushAlignedSamples();
+
+    if(params.engine != this->params.engine){
+        if(pendingPredictions > 0)
+            flushPendingPredictions();
+
+        //Continue from the rotation and linear acceleration of the previous engine, with a fresh covariance
+        //These are the outputs recorded after the latest step of the previous engine
+        Quaternion const& q = state.rotation;
+        Vector const& la = state.linearAcceleration;
+        if(params.engine == ERROR_STATE_ENGINE){
+            nominalQuat = q;
+            errorFilter.statePost = typename ErrorFilter::StateVector(0.0f, 0.0f, 0.0f, la(0), la(1), la(2));
+            errorFilter.statePre = errorFilter.statePost;
+            errorFilter.errorCovPre = errorQ;
+            errorFilter.errorCovPost = ErrorFilter::StateMatrix::zeros();
+        }
+        else if(params.engine == ERROR_STATE_BIAS_ENGINE)
+            resetBiasFilter(q, la);
+        else{
+            filter.statePost = typename Filter::StateVector(q(0), q(1), q(2), q(3), la(0), la(1), la(2));
+            filter.statePre = filter.statePost;
+            statePreHistory = cv::Matx<Scalar, 4, 1>(q(0), q(1), q(2), q(3));
+            statePostHistory = statePreHistory;
+            filter.errorCovPre = Q;
+            filter.errorCovPost = Filter::StateMatrix::zeros();
+        }
+        state.gyroBias = Vector(0.0f, 0.0f, 0.0f);
+        state.accBias = Vector(0.0f, 0.0f, 0.0f);
+        state.stationary = false;
+    }
+    this->params = params;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::processSample(Sample const& sample)
+{
+    //Hold samples newer than the prediction until the gyroscope sample that ends their time slice
+    if(params.timeAlignment && sample.type != Sample::GYROSCOPE && lastGyroTimestamp > 0 && sample.timestamp > predictedTimestamp){
+        alignedSamples[numAlignedSamples++] = sample;
+        if(numAlignedSamples == ALIGNMENT_CAPACITY)
+            return flushAlignedSamples();
+        return false;
+    }
+
+    switch(sample.type){
+        case Sample::GYROSCOPE:
+            return gyroReading(sample.timestamp, sample.x, sample.y, sample.z);
+        case Sample::ACCELEROMETER:
+            return accReading(sample.timestamp, sample.x, sample.y, sample.z);
+        case Sample::MAGNETOMETER:
+            magReading(sample.timestamp, sample.x, sample.y, sample.z);
+            return false;
+    }
+    return false;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::gyroReading(quint64 timestamp, qreal x, qreal y, qreal z)
+{
+    bool changed = false;
+    const Scalar degToRad = (Scalar)M_PI/180.0f;
+
+    if(lastGyroTimestamp > 0){
+        if(statisticsEnabled && timestamp > replayedTimestamps[Sample::GYROSCOPE])
+            countSample(statistics.gyro, gyroMeanDeltaT, timestamp, lastGyroTimestamp);
+
+        wDeltaT = ((Scalar)(qint64)(timestamp - lastGyroTimestamp))/1000000.0f;
+        if(wDeltaT > 0){
+            state.gyroSilentCycles = 0;
+            Vector wRead(x*degToRad, y*degToRad, z*degToRad);
+
+            if(params.timeAlignment){
+
+                //Predict to each held sample of this time slice, angular velocity being linear over the slice
+                const quint64 start = predictedTimestamp;
+                const Vector wStart = wRaw;
+                int consumed = 0;
+                for(; consumed < numAlignedSamples && alignedSamples[consumed].timestamp <= timestamp; consumed++){
+                    Sample const& sample = alignedSamples[consumed];
+                    if(sample.type == Sample::ACCELEROMETER){
+                        if(sample.timestamp > predictedTimestamp){
+                            Scalar f = ((Scalar)(sample.timestamp - start))/((Scalar)(timestamp - start));
+                            changed |= predict(sample.timestamp, wStart + f*(wRead - wStart));
+                        }
+                        changed |= accReading(sample.timestamp, sample.x, sample.y, sample.z);
+                    }
+                    else
+                        magReading(sample.timestamp, sample.x, sample.y, sample.z);
+                }
+                std::copy(alignedSamples + consumed, alignedSamples + numAlignedSamples, alignedSamples);
+                numAlignedSamples -= consumed;
+
+                if(timestamp > predictedTimestamp)
+                    changed |= predict(timestamp, wRead);
+            }
+            else if(timestamp > predictedTimestamp)
+                changed = predict(timestamp, wRead);
+        }
+    }
+    else{
+        //First sample only gives the angular velocity at the start of the first time slice
+        w = Vector(x*degToRad, y*degToRad, z*degToRad);
+        wRaw = w;
+        predictedTimestamp = timestamp;
+    }
+    lastGyroTimestamp = timestamp;
+    return changed;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::predict(quint64 timestamp, Vector const& wRead)
+{
+    wDeltaT = ((Scalar)(qint64)(timestamp - predictedTimestamp))/1000000.0f;
+    predictedTimestamp = timestamp;
+
+    //Take care of startup time
+    if(state.startupTime > 0){
+        state.startupTime -= wDeltaT;
+        if(state.startupTime < 0){
+            state.startupTime = 0;
+            resetDisplacement();
+            state.velocity = Vector(0, 0, 0);
+
+            //Biases would absorb the large startup corrections, they are held at zero until here
+            if(params.engine == ERROR_STATE_BIAS_ENGINE)
+                startBiasEstimation();
+
+            //A magnetometer that shows up later is converged to as usual
+            alignHeadingPending = false;
+        }
+    }
+
+    wPrev = w;
+    w = wRead; //Angular velocity in rad/s
+    wRaw = wRead;
+    if(params.engine == ERROR_STATE_BIAS_ENGINE){
+        const Scalar* s = biasFilter.statePost.val;
+        w -= Vector(s[3], s[4], s[5]);
+    }
+    w_norm = cv::norm(w);
+
+    std::chrono::steady_clock::time_point start;
+    if(statisticsEnabled)
+        start = std::chrono::steady_clock::now();
+
+    if(params.engine == ERROR_STATE_ENGINE){
+
+        //Advance the nominal rotation, the rotation error stays zero and the covariance follows it
+        calculateErrorProcess();
+        errorFilter.template predictLeadingBlock<3>(errorProcess);
+        errorFilter.statePost = errorFilter.statePre;
+    }
+    else if(params.engine == ERROR_STATE_BIAS_ENGINE){
+
+        //Same as above, the transition of the linear acceleration block is zero
+        calculateBiasProcess();
+        biasFilter.template predictLeadingBlock<9>(biasProcess);
+        biasFilter.statePost = biasFilter.statePre;
+    }
+    else{
+        //Calculate process value, transition matrix and process noise covariance matrix
+        if(pendingPredictions > 0){
+            if(params.deferredCovariance)
+                foldPendingPrediction();
+            else
+                flushPendingPredictions();
+        }
+        calculateProcess();
+
+        //Do prediction step, transition only depends on the quaternion part of the previous state
+        if(params.deferredCovariance){
+            filter.statePre = process;
+            pendingPredictions++;
+        }
+        else
+            filter.template predictLeadingBlock<4>(process);
+
+        //Ensure output quaternion is unit norm
+        normalizeQuat(filter.statePre.val);
+
+        //Ensure output quaternion doesn't unwind
+        shortestPathQuat(statePreHistory.val, filter.statePre.val);
+
+        //Ensure a posteriori state reflects prediction in case measurement doesn't occur
+        filter.statePost = filter.statePre;
+    }
+
+    if(statisticsEnabled){
+        qreal elapsed = std::chrono::duration<qreal>(std::chrono::steady_clock::now() - start).count();
+        statistics.predictions++;
+        statistics.predictTimeSum += elapsed;
+        statistics.predictTimeMax = std::max(statistics.predictTimeMax, elapsed);
+    }
+
+    //Export rotation and linear acceleration
+    state.timestamp = timestamp;
+    return calculateOutput();
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::flushAlignedSamples()
+{
+    //No gyroscope sample ends their time slice, hold the latest angular velocity
+    bool changed = false;
+    for(int i = 0; i < numAlignedSamples; i++){
+        Sample const& sample = alignedSamples[i];
+        if(sample.type == Sample::ACCELEROMETER){
+            if(sample.timestamp > predictedTimestamp)
+                changed |= predict(sample.timestamp, wRaw);
+            changed |= accReading(sample.timestamp, sample.x, sample.y, sample.z);
+        }
+        else
+            magReading(sample.timestamp, sample.x, sample.y, sample.z);
+    }
+    numAlignedSamples = 0;
+    return changed;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::accReading(quint64 timestamp, qreal x, qreal y, qreal z)
+{
+    bool changed = false;
+
+    if(lastAccTimestamp > 0){
+        if(statisticsEnabled && timestamp > replayedTimestamps[Sample::ACCELEROMETER])
+            countSample(statistics.acc, accMeanDeltaT, timestamp, lastAccTimestamp);
+
+        aDeltaT = ((Scalar)(qint64)(timestamp - lastAccTimestamp))/1000000.0f;
+        if(aDeltaT > 0){
+            state.accSilentCycles = 0;
+            a(0) = x - params.a_bias(0); //Linear acceleration along x axis in m/s^2
+            a(1) = y - params.a_bias(1); //Linear acceleration along y axis in m/s^2
+            a(2) = z - params.a_bias(2); //Linear acceleration along z axis in m/s^2
+            if(params.engine == ERROR_STATE_BIAS_ENGINE){
+                const Scalar* s = biasFilter.statePost.val;
+                a_norm = cv::norm(a - Vector(s[6], s[7], s[8]));
+            }
+            else
+                a_norm = cv::norm(a);
+
+            std::chrono::steady_clock::time_point start;
+            if(statisticsEnabled)
+                start = std::chrono::steady_clock::now();
+
+            //Bring the covariance up to date with the state, counted in the correction time
+            if(pendingPredictions > 0)
+                flushPendingPredictions();
+
+            //With timeAlignment, bring the magnetic vector to this time, dm/dt = -w x m in local frame
+            if(params.timeAlignment && magDataReady)
+                m -= w.cross(m)*(((Scalar)(qint64)(timestamp - lastMagTimestamp))/1000000.0f);
+
+            //After a warm start, snap to the first observations instead of slowly converging to them
+            if(alignTiltPending || (alignHeadingPending && magDataReady))
+                alignRotation();
+
+            //Calculate observation value, predicted observation value and observation matrix
+            //We assume here that the magnetometer reading is less frequent compared to accelerometer
+            bool magObserved = calculateObservation();
+
+            //Leave out what the predicted covariance deems an outlier, no correction at all without gravity
+            bool gravityObserved = params.engine == ERROR_STATE_ENGINE ? gateObservation(errorFilter, magObserved) :
+                params.engine == ERROR_STATE_BIAS_ENGINE ? gateObservation(biasFilter, magObserved) : gateObservation(filter, magObserved);
+
+            //Do correction step, without the zero magnetometer rows if there is no new magnetic vector
+            if(params.engine == ERROR_STATE_ENGINE){
+                if(!gravityObserved)
+                    errorFilter.correctSequential(observation, predictedObservation, 0);
+                else if(params.measurementUpdate == SEQUENTIAL_UPDATE)
+                    errorFilter.correctSequential(observation, predictedObservation, magObserved ? 6 : 3);
+                else if(params.measurementUpdate == ACTIVE_ROWS_UPDATE && !magObserved)
+                    errorFilter.template correctLeadingRows<3>(observation, predictedObservation);
+                else
+                    errorFilter.correct(observation, predictedObservation);
+
+                //Nominal rotation only ever turns by small rotations, it needs no unwinding correction
+                applyErrorCorrection(errorFilter.statePost.val);
+            }
+            else if(params.engine == ERROR_STATE_BIAS_ENGINE){
+                if(!gravityObserved)
+                    biasFilter.correctSequential(observation, predictedObservation, 0);
+                else if(params.measurementUpdate == SEQUENTIAL_UPDATE)
+                    biasFilter.correctSequential(observation, predictedObservation, magObserved ? 6 : 3);
+                else if(params.measurementUpdate == ACTIVE_ROWS_UPDATE && !magObserved)
+                    biasFilter.template correctLeadingRows<3>(observation, predictedObservation);
+                else
+                    biasFilter.correct(observation, predictedObservation);
+                applyErrorCorrection(biasFilter.statePost.val);
+
+                //Zero angular velocity and linear acceleration updates, counted in the correction time
+                detectStationary();
+                correctStationary();
+            }
+            else{
+                if(!gravityObserved)
+                    filter.correctSequential(observation, predictedObservation, 0);
+                else if(params.measurementUpdate == SEQUENTIAL_UPDATE)
+                    filter.correctSequential(observation, predictedObservation, magObserved ? 6 : 3);
+                else if(params.measurementUpdate == ACTIVE_ROWS_UPDATE && !magObserved)
+                    filter.template correctLeadingRows<3>(observation, predictedObservation);
+                else
+                    filter.correct(observation, predictedObservation);
+
+                //Ensure ouput quaternion is unit norm
+                normalizeQuat(filter.statePost.val);
+
+                //Ensure output quaternion doesn't unwind
+                shortestPathQuat(statePostHistory.val, filter.statePost.val);
+            }
+
+            //Others only report it, e.g for adaptive data rates
+            if(params.engine != ERROR_STATE_BIAS_ENGINE)
+                detectStationary();
+
+            if(statisticsEnabled){
+                qreal elapsed = std::chrono::duration<qreal>(std::chrono::steady_clock::now() - start).count();
+                statistics.corrections++;
+                statistics.correctTimeSum += elapsed;
+                statistics.correctTimeMax = std::max(statistics.correctTimeMax, elapsed);
+
+                //Rows of a missing or rejected magnetic vector are zero in both
+                qreal innovation = 0;
+                for(int i = 0; i < 6; i++)
+                    innovation += (observation(i) - predictedObservation(i))*(observation(i) - predictedObservation(i));
+                innovation = std::sqrt(innovation);
+                statistics.innovationSum += innovation;
+                statistics.innovationMax = std::max(statistics.innovationMax, innovation);
+            }
+
+            //Export rotation
+            state.timestamp = timestamp;
+            changed = calculateOutput();
+
+            //Update displacement values
+            updateDisplacement();
+        }
+    }
+    lastAccTimestamp = timestamp;
+    return changed;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::magReading(quint64 timestamp, qreal x, qreal y, qreal z)
+{
+    if(statisticsEnabled && lastMagTimestamp > 0 && timestamp > replayedTimestamps[Sample::MAGNETOMETER])
+        countSample(statistics.mag, magMeanDeltaT, timestamp, lastMagTimestamp);
+
+    if(lastMagTimestamp > 0)
+        if(((Scalar)(qint64)(timestamp - lastMagTimestamp))/1000000.0f > 0){
+            state.magSilentCycles = 0;
+            m(0) = x*1000000.0f; //Magnetic flux along x axis in milliTeslas
+            m(1) = y*1000000.0f; //Magnetic flux along y axis in milliTeslas
+            m(2) = z*1000000.0f; //Magnetic flux along z axis in milliTeslas
+            m_norm = cv::norm(m);
+            magDataReady = true;
+        }
+    lastMagTimestamp = timestamp;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::restore(BasicIMUFusion const& checkpoint)
+{
+    const bool enabled = statisticsEnabled;
+    const Statistics kept = statistics;
+    const qreal gyroMean = gyroMeanDeltaT, accMean = accMeanDeltaT, magMean = magMeanDeltaT;
+
+    //Samples up to the latest ones are fused again, their timing is already counted
+    quint64 replayed[3];
+    replayed[Sample::GYROSCOPE] = std::max(replayedTimestamps[Sample::GYROSCOPE], lastGyroTimestamp);
+    replayed[Sample::ACCELEROMETER] = std::max(replayedTimestamps[Sample::ACCELEROMETER], lastAccTimestamp);
+    replayed[Sample::MAGNETOMETER] = std::max(replayedTimestamps[Sample::MAGNETOMETER], lastMagTimestamp);
+
+    *this = checkpoint;
+
+    std::copy(replayed, replayed + 3, replayedTimestamps);
+    statisticsEnabled = enabled;
+    statistics = kept;
+    statistics.rollbacks++;
+    gyroMeanDeltaT = gyroMean;
+    accMeanDeltaT = accMean;
+    magMeanDeltaT = magMean;
+}
+
+template<typename Scalar, typename CovScalar>
+IMUFusionBase::Statistics BasicIMUFusion<Scalar, CovScalar>::takeStatistics()
+{
+    Statistics taken = statistics;
+    statistics = Statistics();
+    return taken;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::countSample(Statistics::Sensor& sensor, qreal& meanDeltaT, quint64 timestamp, quint64 lastTimestamp)
+{
+    if(timestamp <= lastTimestamp){
+        sensor.outOfOrder++;
+        return;
+    }
+
+    qreal deltaT = ((qreal)(timestamp - lastTimestamp))/1000000.0f;
+    sensor.samples++;
+    sensor.deltaTSum += deltaT;
+    sensor.deltaTSquaredSum += deltaT*deltaT;
+
+    //A gap of more than 1.5 usual time slices means samples went missing, gaps do not move the usual time slice
+    if(meanDeltaT > 0 && deltaT > 1.5f*meanDeltaT)
+        sensor.dropped += (quint64)(deltaT/meanDeltaT + 0.5f) - 1;
+    else
+        meanDeltaT = meanDeltaT > 0 ? 0.95f*meanDeltaT + 0.05f*deltaT : deltaT;
+}
+
+template<typename Scalar, typename CovScalar>
+inline void BasicIMUFusion<Scalar, CovScalar>::normalizeQuat(Scalar* q)
+{
+    Scalar norm = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+    if(norm > EPSILON){
+        q[0] /= norm;
+        q[1] /= norm;
+        q[2] /= norm;
+        q[3] /= norm;
+    }
+    else{
+        q[0] = 1.0f;
+        q[1] = 1.0f;
+        q[2] = 1.0f;
+        q[3] = 1.0f;
+    }
+}
+
+template<typename Scalar, typename CovScalar>
+inline void BasicIMUFusion<Scalar, CovScalar>::shortestPathQuat(Scalar* p, Scalar* q)
+{
+    //If -q would be closer to q_prev than +q, replace new q with -q
+    //The following comes from the derivation of |q - q_prev|^2 - |-q - q_prev|^2
+    if(q[0]*p[0] + q[1]*p[1] + q[2]*p[2] + q[3]*p[3] < 0){
+        q[0] = -q[0];
+        q[1] = -q[1];
+        q[2] = -q[2];
+        q[3] = -q[3];
+    }
+    p[0] = q[0];
+    p[1] = q[1];
+    p[2] = q[2];
+    p[3] = q[3];
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::calculateProcess()
+{
+    //cv::Matx data pointers
+    Scalar* processPtr = process.val;
+    CovScalar* F0 = filter.transitionMatrix.val + 0*7;
+    CovScalar* F1 = filter.transitionMatrix.val + 1*7;
+    CovScalar* F2 = filter.transitionMatrix.val + 2*7;
+    CovScalar* F3 = filter.transitionMatrix.val + 3*7;
+    CovScalar* F4 = filter.transitionMatrix.val + 4*7;
+    CovScalar* F5 = filter.transitionMatrix.val + 5*7;
+    CovScalar* F6 = filter.transitionMatrix.val + 6*7;
+
+    //Calculate process value
+    const Scalar q0 = filter.statePost(0);
+    const Scalar q1 = filter.statePost(1);
+    const Scalar q2 = filter.statePost(2);
+    const Scalar q3 = filter.statePost(3);
+    const Scalar wx = w(0);
+    const Scalar wy = w(1);
+    const Scalar wz = w(2);
+    const Scalar ax = a(0);
+    const Scalar ay = a(1);
+    const Scalar az = a(2);
+    const Scalar g = 9.81f;
+
+    //Absolute rotation and its transition matrix block
+    if(params.integrator == FIRST_ORDER_INTEGRATOR){
+        processPtr[0] = q0 + 0.5f*wDeltaT*(-q1*wx - q2*wy - q3*wz);
+        processPtr[1] = q1 + 0.5f*wDeltaT*(+q0*wx - q3*wy + q2*wz);
+        processPtr[2] = q2 + 0.5f*wDeltaT*(+q3*wx + q0*wy - q1*wz);
+        processPtr[3] = q3 + 0.5f*wDeltaT*(-q2*wx + q1*wy + q0*wz);
+
+        F0[0] = 1.0f;               F0[1] = -0.5f*wDeltaT*wx;   F0[2] = -0.5f*wDeltaT*wy;   F0[3] = -0.5f*wDeltaT*wz;
+        F1[0] = +0.5f*wDeltaT*wx;   F1[1] = 1.0f;               F1[2] = +0.5f*wDeltaT*wz;   F1[3] = -0.5f*wDeltaT*wy;
+        F2[0] = +0.5f*wDeltaT*wy;   F2[1] = -0.5f*wDeltaT*wz;   F2[2] = 1.0f;               F2[3] = +0.5f*wDeltaT*wx;
+        F3[0] = +0.5f*wDeltaT*wz;   F3[1] = +0.5f*wDeltaT*wy;   F3[2] = -0.5f*wDeltaT*wx;   F3[3] = 1.0f;
+    }
+    else{
+        //q*dq, linear in q
+        Scalar dq[4];
+        calculateDeltaQuat(dq);
+        processPtr[0] = q0*dq[0] - q1*dq[1] - q2*dq[2] - q3*dq[3];
+        processPtr[1] = q0*dq[1] + q1*dq[0] + q2*dq[3] - q3*dq[2];
+        processPtr[2] = q0*dq[2] - q1*dq[3] + q2*dq[0] + q3*dq[1];
+        processPtr[3] = q0*dq[3] + q1*dq[2] - q2*dq[1] + q3*dq[0];
+
+        F0[0] = dq[0];  F0[1] = -dq[1]; F0[2] = -dq[2]; F0[3] = -dq[3];
+        F1[0] = dq[1];  F1[1] = dq[0];  F1[2] = dq[3];  F1[3] = -dq[2];
+        F2[0] = dq[2];  F2[1] = -dq[3]; F2[2] = dq[0];  F2[3] = dq[1];
+        F3[0] = dq[3];  F3[1] = dq[2];  F3[2] = -dq[1]; F3[3] = dq[0];
+    }
+
+    //Absolute linear acceleration
+    processPtr[4] = (q0*q0 + q1*q1 - q2*q2 - q3*q3)*ax + 2*(q1*q2 - q0*q3)*ay + 2*(q1*q3 + q0*q2)*az;
+    processPtr[5] = 2*(q1*q2 + q0*q3)*ax + (q0*q0 - q1*q1 + q2*q2 - q3*q3)*ay + 2*(q2*q3 - q0*q1)*az;
+    processPtr[6] = 2*(q1*q3 - q0*q2)*ax + 2*(q2*q3 + q0*q1)*ay + (q0*q0 - q1*q1 - q2*q2 + q3*q3)*az - g;
+
+    normalizeQuat(process.val);
+
+    //Calculate transition matrix of the linear acceleration
+    F4[0] = 2*(+q0*ax - q3*ay + q2*az); F4[1] = 2*(+q1*ax + q2*ay + q3*az); F4[2] = 2*(-q2*ax + q1*ay + q0*az); F4[3] = 2*(-q3*ax - q0*ay + q1*az);
+    F5[0] = 2*(+q3*ax + q0*ay - q1*az); F5[1] = 2*(+q2*ax - q1*ay - q0*az); F5[2] = 2*(+q1*ax + q2*ay + q3*az); F5[3] = 2*(+q0*ax - q3*ay + q2*az);
+    F6[0] = 2*(-q2*ax + q1*ay + q0*az); F6[1] = 2*(+q3*ax + q0*ay - q1*az); F6[2] = 2*(-q0*ax + q3*ay - q2*az); F6[3] = 2*(+q1*ax + q2*ay + q3*az);
+
+    //Calculate process covariance matrix
+    filter.processNoiseCov = Q*wDeltaT; //TODO: We should not multiply the acceleration part with deltaT
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::calculateDeltaQuat(Scalar* deltaQuat)
+{
+    Scalar* dq = deltaQuat;
+
+    if(params.integrator == RK4_INTEGRATOR){
+
+        //dq' = 1/2*dq*(0, w(t)) from dq = 1 with w(t) linear from wPrev to w, in sub-steps small enough for RK4
+        Scalar maxAngle = std::max((Scalar)cv::norm(wPrev), w_norm)*wDeltaT;
+        int substeps = std::min(RK4_MAX_SUBSTEPS, std::max(1, (int)std::ceil(maxAngle/RK4_SUBSTEP_ANGLE)));
+        Scalar h = wDeltaT/substeps;
+
+        //Derivative of p at the fraction t of the time slice
+        auto derivative = [&](Scalar const* p, Scalar t, Scalar* dp){
+            Vector wt = wPrev + (w - wPrev)*t;
+            dp[0] = 0.5f*(-p[1]*wt(0) - p[2]*wt(1) - p[3]*wt(2));
+            dp[1] = 0.5f*(+p[0]*wt(0) - p[3]*wt(1) + p[2]*wt(2));
+            dp[2] = 0.5f*(+p[3]*wt(0) + p[0]*wt(1) - p[1]*wt(2));
+            dp[3] = 0.5f*(-p[2]*wt(0) + p[1]*wt(1) + p[0]*wt(2));
+        };
+
+        dq[0] = 1.0f; dq[1] = 0.0f; dq[2] = 0.0f; dq[3] = 0.0f;
+        Scalar k1[4], k2[4], k3[4], k4[4], p[4];
+        for(int s = 0; s < substeps; s++){
+            Scalar t = (Scalar)s/substeps;
+            Scalar step = (Scalar)1.0f/substeps;
+            derivative(dq, t, k1);
+            for(int i = 0; i < 4; i++)
+                p[i] = dq[i] + 0.5f*h*k1[i];
+            derivative(p, t + 0.5f*step, k2);
+            for(int i = 0; i < 4; i++)
+                p[i] = dq[i] + 0.5f*h*k2[i];
+            derivative(p, t + 0.5f*step, k3);
+            for(int i = 0; i < 4; i++)
+                p[i] = dq[i] + h*k3[i];
+            derivative(p, t + step, k4);
+            for(int i = 0; i < 4; i++)
+                dq[i] += h/6.0f*(k1[i] + 2.0f*k2[i] + 2.0f*k3[i] + k4[i]);
+        }
+        return;
+    }
+
+    //Rotation vector over the time slice
+    Vector phi;
+    if(params.integrator == CONING_INTEGRATOR)
+        phi = (wPrev + w)*(0.5f*wDeltaT) + wPrev.cross(w)*(wDeltaT*wDeltaT/12.0f);
+    else
+        phi = w*wDeltaT;
+
+    //dq = exp(1/2*(0, phi))
+    Scalar angle = cv::norm(phi);
+    Scalar scale = angle > EPSILON ? std::sin(0.5f*angle)/angle : 0.5f;
+    dq[0] = std::cos(0.5f*angle);
+    dq[1] = scale*phi(0);
+    dq[2] = scale*phi(1);
+    dq[3] = scale*phi(2);
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::calculateErrorProcess()
+{
+    //cv::Matx data pointers
+    Scalar* processPtr = errorProcess.val;
+    CovScalar* F0 = errorFilter.transitionMatrix.val + 0*6;
+    CovScalar* F1 = errorFilter.transitionMatrix.val + 1*6;
+    CovScalar* F2 = errorFilter.transitionMatrix.val + 2*6;
+    CovScalar* F3 = errorFilter.transitionMatrix.val + 3*6;
+    CovScalar* F4 = errorFilter.transitionMatrix.val + 4*6;
+    CovScalar* F5 = errorFilter.transitionMatrix.val + 5*6;
+
+    const Scalar q0 = nominalQuat(0);
+    const Scalar q1 = nominalQuat(1);
+    const Scalar q2 = nominalQuat(2);
+    const Scalar q3 = nominalQuat(3);
+    const Scalar ax = a(0);
+    const Scalar ay = a(1);
+    const Scalar az = a(2);
+    const Scalar g = 9.81f;
+
+    //Rotation over the time slice, a unit quaternion for every integrator
+    Scalar dq[4];
+    calculateDeltaQuat(dq);
+    const Scalar d0 = dq[0];
+    const Scalar d1 = dq[1];
+    const Scalar d2 = dq[2];
+    const Scalar d3 = dq[3];
+
+    //Rotation error is reset to zero after every correction, absolute linear acceleration as in calculateProcess()
+    const Scalar R00 = q0*q0 + q1*q1 - q2*q2 - q3*q3;    const Scalar R01 = 2*(q1*q2 - q0*q3);    const Scalar R02 = 2*(q1*q3 + q0*q2);
+    const Scalar R10 = 2*(q1*q2 + q0*q3);    const Scalar R11 = q0*q0 - q1*q1 + q2*q2 - q3*q3;    const Scalar R12 = 2*(q2*q3 - q0*q1);
+    const Scalar R20 = 2*(q1*q3 - q0*q2);    const Scalar R21 = 2*(q2*q3 + q0*q1);    const Scalar R22 = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+    processPtr[0] = 0.0f;
+    processPtr[1] = 0.0f;
+    processPtr[2] = 0.0f;
+    processPtr[3] = R00*ax + R01*ay + R02*az;
+    processPtr[4] = R10*ax + R11*ay + R12*az;
+    processPtr[5] = R20*ax + R21*ay + R22*az - g;
+
+    //Rotation error is carried into the new nominal frame, i.e multiplied by rot(dq)t
+    F0[0] = d0*d0 + d1*d1 - d2*d2 - d3*d3;  F0[1] = 2*(d1*d2 + d0*d3);              F0[2] = 2*(d1*d3 - d0*d2);
+    F1[0] = 2*(d1*d2 - d0*d3);              F1[1] = d0*d0 - d1*d1 + d2*d2 - d3*d3;  F1[2] = 2*(d2*d3 + d0*d1);
+    F2[0] = 2*(d1*d3 + d0*d2);              F2[1] = 2*(d2*d3 - d0*d1);              F2[2] = d0*d0 - d1*d1 - d2*d2 + d3*d3;
+
+    //Linear acceleration w.r.t the rotation error, -rot(q)*[a_m]x
+    F3[0] = R02*ay - R01*az;    F3[1] = R00*az - R02*ax;    F3[2] = R01*ax - R00*ay;
+    F4[0] = R12*ay - R11*az;    F4[1] = R10*az - R12*ax;    F4[2] = R11*ax - R10*ay;
+    F5[0] = R22*ay - R21*az;    F5[1] = R20*az - R22*ax;    F5[2] = R21*ax - R20*ay;
+
+    //Calculate process covariance matrix
+    errorFilter.processNoiseCov = errorQ*wDeltaT;
+
+    //Advance the nominal rotation, q*dq
+    nominalQuat(0) = q0*d0 - q1*d1 - q2*d2 - q3*d3;
+    nominalQuat(1) = q0*d1 + q1*d0 + q2*d3 - q3*d2;
+    nominalQuat(2) = q0*d2 - q1*d3 + q2*d0 + q3*d1;
+    nominalQuat(3) = q0*d3 + q1*d2 - q2*d1 + q3*d0;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::calculateBiasProcess()
+{
+    //cv::Matx data pointers
+    Scalar* processPtr = biasProcess.val;
+    CovScalar* F0 = biasFilter.transitionMatrix.val + 0*12;
+    CovScalar* F1 = biasFilter.transitionMatrix.val + 1*12;
+    CovScalar* F2 = biasFilter.transitionMatrix.val + 2*12;
+    CovScalar* F9 = biasFilter.transitionMatrix.val + 9*12;
+    CovScalar* F10 = biasFilter.transitionMatrix.val + 10*12;
+    CovScalar* F11 = biasFilter.transitionMatrix.val + 11*12;
+    const Scalar* s = biasFilter.statePost.val;
+
+    const Scalar q0 = nominalQuat(0);
+    const Scalar q1 = nominalQuat(1);
+    const Scalar q2 = nominalQuat(2);
+    const Scalar q3 = nominalQuat(3);
+    const Scalar ax = a(0) - s[6];
+    const Scalar ay = a(1) - s[7];
+    const Scalar az = a(2) - s[8];
+    const Scalar g = 9.81f;
+
+    //Rotation over the time slice of the angular velocity without the gyroscope bias, see gyroReading()
+    Scalar dq[4];
+    calculateDeltaQuat(dq);
+    const Scalar d0 = dq[0];
+    const Scalar d1 = dq[1];
+    const Scalar d2 = dq[2];
+    const Scalar d3 = dq[3];
+
+    //Rotation error is reset to zero after every correction, biases carry over, absolute linear acceleration of the unbiased acceleration
+    const Scalar R00 = q0*q0 + q1*q1 - q2*q2 - q3*q3;    const Scalar R01 = 2*(q1*q2 - q0*q3);    const Scalar R02 = 2*(q1*q3 + q0*q2);
+    const Scalar R10 = 2*(q1*q2 + q0*q3);    const Scalar R11 = q0*q0 - q1*q1 + q2*q2 - q3*q3;    const Scalar R12 = 2*(q2*q3 - q0*q1);
+    const Scalar R20 = 2*(q1*q3 - q0*q2);    const Scalar R21 = 2*(q2*q3 + q0*q1);    const Scalar R22 = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+    processPtr[0] = 0.0f;
+    processPtr[1] = 0.0f;
+    processPtr[2] = 0.0f;
+    for(int i = 3; i < 9; i++)
+        processPtr[i] = s[i];
+    processPtr[9] = R00*ax + R01*ay + R02*az;
+    processPtr[10] = R10*ax + R11*ay + R12*az;
+    processPtr[11] = R20*ax + R21*ay + R22*az - g;
+
+    //Rotation error is carried into the new nominal frame, a gyroscope bias error adds -dt times itself
+    F0[0] = d0*d0 + d1*d1 - d2*d2 - d3*d3;  F0[1] = 2*(d1*d2 + d0*d3);              F0[2] = 2*(d1*d3 - d0*d2);
+    F1[0] = 2*(d1*d2 - d0*d3);              F1[1] = d0*d0 - d1*d1 + d2*d2 - d3*d3;  F1[2] = 2*(d2*d3 + d0*d1);
+    F2[0] = 2*(d1*d3 + d0*d2);              F2[1] = 2*(d2*d3 - d0*d1);              F2[2] = d0*d0 - d1*d1 - d2*d2 + d3*d3;
+    F0[3] = -wDeltaT;
+    F1[4] = -wDeltaT;
+    F2[5] = -wDeltaT;
+
+    //Linear acceleration w.r.t the rotation error, -rot(q)*[a_m - b_a]x, and w.r.t the accelerometer bias, -rot(q)
+    F9[0] = R02*ay - R01*az;    F9[1] = R00*az - R02*ax;    F9[2] = R01*ax - R00*ay;
+    F10[0] = R12*ay - R11*az;   F10[1] = R10*az - R12*ax;   F10[2] = R11*ax - R10*ay;
+    F11[0] = R22*ay - R21*az;   F11[1] = R20*az - R22*ax;   F11[2] = R21*ax - R20*ay;
+    F9[6] = -R00;   F9[7] = -R01;   F9[8] = -R02;
+    F10[6] = -R10;  F10[7] = -R11;  F10[8] = -R12;
+    F11[6] = -R20;  F11[7] = -R21;  F11[8] = -R22;
+
+    //Calculate process covariance matrix, diagonal, biases stay fixed during startup
+    CovScalar* Qb = biasFilter.processNoiseCov.val;
+    const Scalar biasDeltaT = isStartupComplete() ? wDeltaT : 0.0f;
+    for(int i = 0; i < 3; i++){
+        Qb[i*13] = errorQ(i,i)*wDeltaT;
+        Qb[(i + 3)*13] = params.Q_b_w*biasDeltaT;
+        Qb[(i + 6)*13] = params.Q_b_a*biasDeltaT;
+        Qb[(i + 9)*13] = errorQ(i + 3,i + 3)*wDeltaT;
+    }
+
+    //Advance the nominal rotation, q*dq
+    nominalQuat(0) = q0*d0 - q1*d1 - q2*d2 - q3*d3;
+    nominalQuat(1) = q0*d1 + q1*d0 + q2*d3 - q3*d2;
+    nominalQuat(2) = q0*d2 - q1*d3 + q2*d0 + q3*d1;
+    nominalQuat(3) = q0*d3 + q1*d2 - q2*d1 + q3*d0;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::applyErrorCorrection(Scalar* error)
+{
+    //nominalQuat*exp(e/2)
+    Scalar* e = error;
+    Scalar angle = std::sqrt(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+    Scalar scale = angle > EPSILON ? std::sin(0.5f*angle)/angle : 0.5f;
+    const Scalar d0 = std::cos(0.5f*angle);
+    const Scalar d1 = scale*e[0];
+    const Scalar d2 = scale*e[1];
+    const Scalar d3 = scale*e[2];
+
+    const Scalar q0 = nominalQuat(0);
+    const Scalar q1 = nominalQuat(1);
+    const Scalar q2 = nominalQuat(2);
+    const Scalar q3 = nominalQuat(3);
+    nominalQuat(0) = q0*d0 - q1*d1 - q2*d2 - q3*d3;
+    nominalQuat(1) = q0*d1 + q1*d0 + q2*d3 - q3*d2;
+    nominalQuat(2) = q0*d2 - q1*d3 + q2*d0 + q3*d1;
+    nominalQuat(3) = q0*d3 + q1*d2 - q2*d1 + q3*d0;
+
+    //Products of unit quaternions only drift from unit norm by rounding, which is removed here
+    normalizeQuat(nominalQuat.val);
+
+    //Error is now part of the nominal rotation, the reset Jacobian is identity to first order
+    e[0] = 0.0f;
+    e[1] = 0.0f;
+    e[2] = 0.0f;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::detectStationary()
+{
+    //Magnitudes are low pass filtered over a tenth of the stationary time so that single noisy readings do not count
+    const Scalar g = 9.81f;
+    Scalar alpha = std::min((Scalar)1.0f, 10.0f*aDeltaT/std::max((Scalar)params.stationaryTime, EPSILON));
+    if(stationaryWMean < 0){
+        stationaryWMean = w_norm;
+        stationaryAMean = std::fabs(g - a_norm);
+    }
+    else{
+        stationaryWMean += alpha*(w_norm - stationaryWMean);
+        stationaryAMean += alpha*(std::fabs(g - a_norm) - stationaryAMean);
+    }
+
+    //Stationary once both stayed within the thresholds long enough
+    if(stationaryWMean < params.stationaryWThreshold && stationaryAMean < params.stationaryAThreshold)
+        stationaryElapsed += aDeltaT;
+    else
+        stationaryElapsed = 0;
+    state.stationary = stationaryElapsed >= params.stationaryTime;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::correctStationary()
+{
+    if(!state.stationary)
+        return;
+
+    //Raw angular velocity is the gyroscope bias, linear acceleration is zero
+    const Scalar* s = biasFilter.statePost.val;
+    stationaryObservation = typename BiasFilter::ObservationVector(wRaw(0), wRaw(1), wRaw(2), 0.0f, 0.0f, 0.0f);
+    stationaryPrediction = typename BiasFilter::ObservationVector(s[3], s[4], s[5], s[9], s[10], s[11]);
+
+    //Both are states, calculateObservation() clears these entries again
+    biasFilter.observationMatrix = BiasFilter::ObservationMatrix::zeros();
+    typename BiasFilter::ObservationCovMatrix& R = biasFilter.observationNoiseCov;
+    for(int i = 0; i < 3; i++){
+        biasFilter.observationMatrix(i,i + 3) = 1.0f;
+        biasFilter.observationMatrix(i + 3,i + 9) = 1.0f;
+        R(i,i) = params.R_s_w;
+        R(i + 3,i + 3) = params.R_s_a;
+    }
+
+    //Second correction on top of the first
+    biasFilter.statePre = biasFilter.statePost;
+    biasFilter.errorCovPre = biasFilter.errorCovPost;
+    if(params.measurementUpdate == SEQUENTIAL_UPDATE)
+        biasFilter.correctSequential(stationaryObservation, stationaryPrediction);
+    else
+        biasFilter.correct(stationaryObservation, stationaryPrediction);
+    applyErrorCorrection(biasFilter.statePost.val);
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::foldPendingPrediction()
+{
+    //Rotation of the latest prediction is the first column of its quaternion block
+    CovScalar const* F = filter.transitionMatrix.val;
+    const CovScalar d0 = F[0*7];
+    const CovScalar d1 = F[1*7];
+    const CovScalar d2 = F[2*7];
+    const CovScalar d3 = F[3*7];
+
+    //pendingDeltaQuat*(d0, d1, d2, d3)
+    CovScalar* p = pendingDeltaQuat.val;
+    const CovScalar p0 = p[0];
+    const CovScalar p1 = p[1];
+    const CovScalar p2 = p[2];
+    const CovScalar p3 = p[3];
+    p[0] = p0*d0 - p1*d1 - p2*d2 - p3*d3;
+    p[1] = p0*d1 + p1*d0 + p2*d3 - p3*d2;
+    p[2] = p0*d2 - p1*d3 + p2*d0 + p3*d1;
+    p[3] = p0*d3 + p1*d2 - p2*d1 + p3*d0;
+
+    for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+            pendingQuatNoise(i,j) += filter.processNoiseCov(i,j);
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::flushPendingPredictions()
+{
+    if(pendingPredictions > 1){
+
+        //Right multiplication by pendingDeltaQuat
+        const CovScalar p0 = pendingDeltaQuat(0);
+        const CovScalar p1 = pendingDeltaQuat(1);
+        const CovScalar p2 = pendingDeltaQuat(2);
+        const CovScalar p3 = pendingDeltaQuat(3);
+        const CovScalar R[4*4] = {
+                p0,     -p1,    -p2,    -p3,
+                p1,     p0,     p3,     -p2,
+                p2,     -p3,    p0,     p1,
+                p3,     p2,     -p1,    p0};
+
+        //P_qq = R*P_qq*Rt + pending noise, upper triangle then mirrored; the rest of P is overwritten below
+        CovScalar* P = filter.errorCovPost.val;
+        CovScalar T[4*4];
+        for(int i = 0; i < 4; i++)
+            for(int j = 0; j < 4; j++){
+                CovScalar sum = 0;
+                for(int k = 0; k < 4; k++)
+                    sum += R[i*4 + k]*P[k*7 + j];
+                T[i*4 + j] = sum;
+            }
+        for(int i = 0; i < 4; i++)
+            for(int j = i; j < 4; j++){
+                CovScalar sum = pendingQuatNoise(i,j);
+                for(int k = 0; k < 4; k++)
+                    sum += T[i*4 + k]*R[j*4 + k];
+                P[i*7 + j] = sum;
+                P[j*7 + i] = sum;
+            }
+    }
+
+    //Latest prediction as usual
+    filter.template predictLeadingBlock<4>(filter.statePre);
+
+    pendingPredictions = 0;
+    pendingDeltaQuat = cv::Vec<CovScalar, 4>(1.0f, 0.0f, 0.0f, 0.0f);
+    pendingQuatNoise = cv::Matx<CovScalar, 4, 4>::zeros();
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::calculateObservation()
+{
+    //cv::Matx data pointers
+    Scalar* statePrePtr = params.engine == QUATERNION_ENGINE ? filter.statePre.val : nominalQuat.val;
+    Scalar* observationPtr = observation.val;
+    Scalar* predictedObservationPtr = predictedObservation.val;
+    CovScalar* H0 = filter.observationMatrix.val + 0*7;
+    CovScalar* H1 = filter.observationMatrix.val + 1*7;
+    CovScalar* H2 = filter.observationMatrix.val + 2*7;
+    CovScalar* H3 = filter.observationMatrix.val + 3*7;
+    CovScalar* H4 = filter.observationMatrix.val + 4*7;
+    CovScalar* H5 = filter.observationMatrix.val + 5*7;
+
+    //Variables dependent on current state
+    const Scalar q0 = statePrePtr[0];
+    const Scalar q1 = statePrePtr[1];
+    const Scalar q2 = statePrePtr[2];
+    const Scalar q3 = statePrePtr[3];
+    const Scalar g = 9.81f;
+    const Scalar R_DCM_z0 = 2*(q1*q3 - q0*q2);
+    const Scalar R_DCM_z1 = 2*(q2*q3 + q0*q1);
+    const Scalar R_DCM_z2 = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+
+    //Accelerometer observation and noise
+    observationPtr[0] = a(0);
+    observationPtr[1] = a(1);
+    observationPtr[2] = a(2);
+    predictedObservationPtr[0] = R_DCM_z0*g;
+    predictedObservationPtr[1] = R_DCM_z1*g;
+    predictedObservationPtr[2] = R_DCM_z2*g;
+    Scalar R_g = params.R_g_k_0 + params.R_g_k_w*w_norm + params.R_g_k_g*std::fabs(g - a_norm);
+
+    //Magnetometer reading variables, the means follow every magnetic vector so that a lasting change is accepted in the end
+    Scalar R_y;
+    Scalar dot_m_z = 0.0f;
+    Scalar m_dip_angle = 0.0f;
+    if(magDataReady){
+        dot_m_z = m(0)*R_DCM_z0 + m(1)*R_DCM_z1 + m(2)*R_DCM_z2;
+
+        m_dip_angle = acos(dot_m_z/m_norm);
+        if(std::isnan(m_dip_angle))
+            m_dip_angle = 0.0f;
+
+        if(m_norm_mean < 0) //For fast startup
+            m_norm_mean = m_norm;
+        else
+            m_norm_mean = params.m_mean_alpha*m_norm_mean + (1.0f - params.m_mean_alpha)*m_norm;
+
+        if(m_dip_angle_mean < 0) //For fast startup
+            m_dip_angle_mean = m_dip_angle;
+        else
+            m_dip_angle_mean = params.m_mean_alpha*m_dip_angle_mean + (1.0f - params.m_mean_alpha)*m_dip_angle;
+
+        //Dip far from usual, e.g near steel or motors: gravity only, as if there was no magnetic vector
+        if(state.startupTime <= 0 && params.magneticDipGate > 0 &&
+                std::fabs(m_dip_angle - m_dip_angle_mean) > params.magneticDipGate){
+            magDataReady = false;
+            if(statisticsEnabled)
+                statistics.magRejected++;
+        }
+    }
+
+    //Magnetometer observation
+    if(magDataReady){
+        Scalar mx = m(0);
+        Scalar my = m(1);
+        Scalar mz = m(2);
+
+        mx = mx - dot_m_z*R_DCM_z0; //Reject magnetic component on Z axis
+        my = my - dot_m_z*R_DCM_z1; //Reject magnetic component on Z axis
+        mz = mz - dot_m_z*R_DCM_z2; //Reject magnetic component on Z axis
+        Scalar uy_norm = sqrt(mx*mx + my*my + mz*mz);
+        if(uy_norm > EPSILON){
+            mx /= uy_norm;
+            my /= uy_norm;
+            mz /= uy_norm;
+        }
+
+        observationPtr[3] = mx;
+        observationPtr[4] = my;
+        observationPtr[5] = mz;
+        predictedObservationPtr[3] = 2*(q1*q2 + q0*q3);
+        predictedObservationPtr[4] = q0*q0 - q1*q1 + q2*q2 - q3*q3;
+        predictedObservationPtr[5] = 2*(q2*q3 - q0*q1);
+
+        R_y = params.R_y_k_0 + params.R_y_k_w*w_norm + params.R_y_k_g*std::fabs(g - a_norm) +
+            params.R_y_k_n*std::fabs(m_norm - m_norm_mean) + params.R_y_k_d*std::fabs(m_dip_angle - m_dip_angle_mean);
+    }
+    else{
+        observationPtr[3] = 0.0f;
+        observationPtr[4] = 0.0f;
+        observationPtr[5] = 0.0f;
+        predictedObservationPtr[3] = 0.0f;
+        predictedObservationPtr[4] = 0.0f;
+        predictedObservationPtr[5] = 0.0f;
+
+        R_y = 1.0f; //This doesn't matter, as long as it doesn't cause nans or infs in S^-1
+    }
+
+    //Calculate observation matrix, w.r.t the rotation error in the error state engines: h(exp(e)) = h + [h]x*e
+    if(params.engine != QUATERNION_ENGINE){
+        const bool bias = params.engine == ERROR_STATE_BIAS_ENGINE;
+        const int stride = bias ? 12 : 6;
+        CovScalar* E = bias ? biasFilter.observationMatrix.val : errorFilter.observationMatrix.val;
+        CovScalar* E0 = E + 0*stride;
+        CovScalar* E1 = E + 1*stride;
+        CovScalar* E2 = E + 2*stride;
+        CovScalar* E3 = E + 3*stride;
+        CovScalar* E4 = E + 4*stride;
+        CovScalar* E5 = E + 5*stride;
+        Scalar* h = predictedObservationPtr;
+        if(bias)
+            biasFilter.observationMatrix = BiasFilter::ObservationMatrix::zeros();
+
+        E0[0] = 0.0f;   E0[1] = -h[2];  E0[2] = +h[1];
+        E1[0] = +h[2];  E1[1] = 0.0f;   E1[2] = -h[0];
+        E2[0] = -h[1];  E2[1] = +h[0];  E2[2] = 0.0f;
+
+        //Rows stay zero when there is no new magnetic vector since h is zero there
+        E3[0] = 0.0f;   E3[1] = -h[5];  E3[2] = +h[4];
+        E4[0] = +h[5];  E4[1] = 0.0f;   E4[2] = -h[3];
+        E5[0] = -h[4];  E5[1] = +h[3];  E5[2] = 0.0f;
+
+        //Accelerometer measures the accelerometer bias on top of gravity
+        if(bias){
+            const Scalar* s = biasFilter.statePost.val;
+            E0[6] = 1.0f;
+            E1[7] = 1.0f;
+            E2[8] = 1.0f;
+            h[0] += s[6];
+            h[1] += s[7];
+            h[2] += s[8];
+        }
+    }
+    else{
+    H0[0] = -2*g*q2;  H0[1] = +2*g*q3;  H0[2] = -2*g*q0;  H0[3] = +2*g*q1;
+    H1[0] = +2*g*q1;  H1[1] = +2*g*q0;  H1[2] = +2*g*q3;  H1[3] = +2*g*q2;
+    H2[0] = +2*g*q0;  H2[1] = -2*g*q1;  H2[2] = -2*g*q2;  H2[3] = +2*g*q3;
+    if(magDataReady){
+        H3[0] = +2*q3;    H3[1] = +2*q2;    H3[2] = +2*q1;    H3[3] = +2*q0;
+        H4[0] = +2*q0;    H4[1] = -2*q1;    H4[2] = +2*q2;    H4[3] = -2*q3;
+        H5[0] = -2*q1;    H5[1] = -2*q0;    H5[2] = +2*q3;    H5[3] = +2*q2;
+    }
+    else{
+        H3[0] = 0.0f; H3[1] = 0.0f; H3[2] = 0.0f; H3[3] = 0.0f;
+        H4[0] = 0.0f; H4[1] = 0.0f; H4[2] = 0.0f; H4[3] = 0.0f;
+        H5[0] = 0.0f; H5[1] = 0.0f; H5[2] = 0.0f; H5[3] = 0.0f;
+    }
+    }
+
+    //Calculate observation noise
+    typename Filter::ObservationCovMatrix& R = params.engine == ERROR_STATE_ENGINE ? errorFilter.observationNoiseCov :
+        params.engine == ERROR_STATE_BIAS_ENGINE ? biasFilter.observationNoiseCov : filter.observationNoiseCov;
+    if(state.startupTime > 0){
+        R(0,0) = params.R_g_startup;
+        R(1,1) = params.R_g_startup;
+        R(2,2) = params.R_g_startup;
+        R(3,3) = params.R_y_startup;
+        R(4,4) = params.R_y_startup;
+        R(5,5) = params.R_y_startup;
+    }
+    else{
+        R(0,0) = R_g;
+        R(1,1) = R_g;
+        R(2,2) = R_g;
+        R(3,3) = R_y;
+        R(4,4) = R_y;
+        R(5,5) = R_y;
+    }
+
+    //Consumed latest magnetometer data
+    bool magObserved = magDataReady;
+    magDataReady = false;
+    return magObserved;
+}
+
+template<typename Scalar, typename CovScalar>
+template<typename EKF>
+bool BasicIMUFusion<Scalar, CovScalar>::gateObservation(EKF& ekf, bool& magObserved)
+{
+    //Startup corrects from far away on purpose
+    if(state.startupTime > 0)
+        return true;
+
+    if(params.gravityGate > 0 && ekf.template mahalanobis<0, 3>(observation, predictedObservation) > params.gravityGate){
+        if(statisticsEnabled)
+            statistics.gravityRejected++;
+        return false;
+    }
+
+    //Same rows as without a magnetic vector, see calculateObservation()
+    if(magObserved && params.magneticGate > 0 && ekf.template mahalanobis<3, 3>(observation, predictedObservation) > params.magneticGate){
+        for(int i = 3; i < 6; i++){
+            observation(i) = 0.0f;
+            predictedObservation(i) = 0.0f;
+            for(int j = 0; j < EKF::ObservationMatrix::cols; j++)
+                ekf.observationMatrix(i,j) = 0.0f;
+        }
+        magObserved = false;
+        if(statisticsEnabled)
+            statistics.magRejected++;
+    }
+    return true;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::calculateOutput()
+{
+    state.gyroSilentCycles++;
+    state.accSilentCycles++;
+    state.magSilentCycles++;
+
+    if(params.engine == ERROR_STATE_ENGINE){
+        Scalar* s = errorFilter.statePost.val;
+        state.rotation = nominalQuat;
+        state.linearAcceleration = Vector(s[3], s[4], s[5]);
+    }
+    else if(params.engine == ERROR_STATE_BIAS_ENGINE){
+        Scalar* s = biasFilter.statePost.val;
+        state.rotation = nominalQuat;
+        state.gyroBias = Vector(s[3], s[4], s[5]);
+        state.accBias = Vector(s[6], s[7], s[8]);
+        state.linearAcceleration = Vector(s[9], s[10], s[11]);
+    }
+    else{
+        Scalar* s = filter.statePost.val;
+        state.rotation = Quaternion(s[0], s[1], s[2], s[3]);
+        state.linearAcceleration = Vector(s[4], s[5], s[6]);
+    }
+
+    //Do not give output in the startup phase
+    return isStartupComplete();
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::updateDisplacement()
+{
+    if(!isStartupComplete())
+        return;
+
+    //Recorded by calculateOutput() just before
+    Vector const& linearAcceleration = state.linearAcceleration;
+    Vector step = aDeltaT*state.velocity + 0.5f*aDeltaT*aDeltaT*linearAcceleration;
+    state.dispTranslation += step;
+    state.translation += step;
+    state.velocity += aDeltaT*linearAcceleration;
+
+    //Since velocity estimate random walks and is unbounded, we decay it when we assume the device is stationary
+    Scalar la_norm = cv::norm(linearAcceleration);
+    Scalar e_minus_w_norm = std::exp(-params.velocityWDecay*w_norm);
+    Scalar e_minus_la_norm = std::exp(-params.velocityADecay*la_norm);
+    state.velocity = (1.0f - e_minus_w_norm)/(1.0f + e_minus_w_norm)*(1.0f - e_minus_la_norm)/(1.0f + e_minus_la_norm)*state.velocity;
+
+    //Zero velocity update, only the bias engine trusts the stationary detection with its estimate
+    if(state.stationary && params.engine == ERROR_STATE_BIAS_ENGINE)
+        state.velocity = Vector(0.0f, 0.0f, 0.0f);
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::restartStartup(qreal startupTime)
+{
+    if(state.startupTime <= 0 && startupTime > 0){
+        state.startupTime = startupTime;
+        return true;
+    }
+    return false;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::getWarmStart(WarmStart& warmStart) const
+{
+    if(!isStartupComplete())
+        return false;
+
+    warmStart.rotation = state.rotation;
+    warmStart.gyroBias = state.gyroBias;
+    warmStart.accBias = state.accBias;
+    warmStart.biasCov = cv::Matx<CovScalar, 6, 6>::zeros();
+    if(params.engine == ERROR_STATE_BIAS_ENGINE)
+        for(int i = 0; i < 6; i++)
+            for(int j = 0; j < 6; j++)
+                warmStart.biasCov(i,j) = biasFilter.errorCovPost(i + 3,j + 3);
+    warmStart.m_norm_mean = m_norm_mean;
+    warmStart.m_dip_angle_mean = m_dip_angle_mean;
+    return true;
+}
+
+template<typename Scalar, typename CovScalar>
+bool BasicIMUFusion<Scalar, CovScalar>::warmStart(WarmStart const& warmStart, qreal startupTime)
+{
+    //Restored values only make sense before the first sample
+    if(lastGyroTimestamp > 0 || lastAccTimestamp > 0 || lastMagTimestamp > 0)
+        return false;
+
+    state.startupTime = startupTime;
+
+    //Biases continue with their own covariance, they are held until startup is complete
+    resetBiasFilter(warmStart.rotation, Vector(0.0f, 0.0f, 0.0f));
+    for(int i = 0; i < 3; i++){
+        biasFilter.statePost(i + 3) = warmStart.gyroBias(i);
+        biasFilter.statePost(i + 6) = warmStart.accBias(i);
+    }
+    biasFilter.statePre = biasFilter.statePost;
+    if(cv::trace(warmStart.biasCov) > 0)
+        biasStartCov = warmStart.biasCov;
+    if(isStartupComplete())
+        startBiasEstimation();
+    if(params.engine == ERROR_STATE_BIAS_ENGINE){
+        state.gyroBias = warmStart.gyroBias;
+        state.accBias = warmStart.accBias;
+    }
+
+    m_norm_mean = warmStart.m_norm_mean;
+    m_dip_angle_mean = warmStart.m_dip_angle_mean;
+
+    //Rotation is only a guess until the first observations since the device may have moved in between
+    setRotation(warmStart.rotation);
+    state.prevRotation = warmStart.rotation;
+    alignTiltPending = true;
+    alignHeadingPending = true;
+    return true;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::setRotation(Quaternion const& rotation)
+{
+    Quaternion const& q = rotation;
+    for(int i = 0; i < 4; i++){
+        filter.statePost(i) = q(i);
+        filter.statePre(i) = q(i);
+    }
+    statePreHistory = cv::Matx<Scalar, 4, 1>(q(0), q(1), q(2), q(3));
+    statePostHistory = statePreHistory;
+    nominalQuat = q;
+    for(int i = 0; i < 3; i++){
+        errorFilter.statePost(i) = 0.0f;
+        errorFilter.statePre(i) = 0.0f;
+        biasFilter.statePost(i) = 0.0f;
+        biasFilter.statePre(i) = 0.0f;
+    }
+    state.rotation = q;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::alignRotation()
+{
+    const Scalar* q = params.engine == QUATERNION_ENGINE ? filter.statePost.val : nominalQuat.val;
+
+    //Ground z axis in local frame is along the acceleration
+    Vector z = a;
+    if(params.engine == ERROR_STATE_BIAS_ENGINE){
+        const Scalar* s = biasFilter.statePost.val;
+        z -= Vector(s[6], s[7], s[8]);
+    }
+    Scalar z_norm = cv::norm(z);
+    if(z_norm < EPSILON)
+        return;
+    z = (1.0f/z_norm)*z;
+
+    //Ground y axis in local frame is along the magnetic vector without its z component, or kept without magnetometer data
+    bool heading = alignHeadingPending && magDataReady;
+    Vector y = heading ? m : Vector(2*(q[1]*q[2] + q[0]*q[3]), q[0]*q[0] - q[1]*q[1] + q[2]*q[2] - q[3]*q[3], 2*(q[2]*q[3] - q[0]*q[1]));
+    y -= y.dot(z)*z;
+    Scalar y_norm = cv::norm(y);
+    if(y_norm < EPSILON)
+        return;
+    y = (1.0f/y_norm)*y;
+    Vector x = y.cross(z);
+
+    //Rotation whose matrix has these axes as rows
+    const Scalar trace = x(0) + y(1) + z(2);
+    Quaternion rotation;
+    if(trace > 0){
+        Scalar r = 2*std::sqrt(1.0f + trace);
+        rotation = Quaternion(0.25f*r, (z(1) - y(2))/r, (x(2) - z(0))/r, (y(0) - x(1))/r);
+    }
+    else if(x(0) > y(1) && x(0) > z(2)){
+        Scalar r = 2*std::sqrt(1.0f + x(0) - y(1) - z(2));
+        rotation = Quaternion((z(1) - y(2))/r, 0.25f*r, (x(1) + y(0))/r, (x(2) + z(0))/r);
+    }
+    else if(y(1) > z(2)){
+        Scalar r = 2*std::sqrt(1.0f + y(1) - x(0) - z(2));
+        rotation = Quaternion((x(2) - z(0))/r, (x(1) + y(0))/r, 0.25f*r, (y(2) + z(1))/r);
+    }
+    else{
+        Scalar r = 2*std::sqrt(1.0f + z(2) - x(0) - y(1));
+        rotation = Quaternion((y(0) - x(1))/r, (x(2) + z(0))/r, (y(2) + z(1))/r, 0.25f*r);
+    }
+    normalizeQuat(rotation.val);
+    setRotation(rotation);
+
+    alignTiltPending = false;
+    if(heading)
+        alignHeadingPending = false;
+}
+
+template<typename Scalar, typename CovScalar>
+void BasicIMUFusion<Scalar, CovScalar>::resetDisplacement()
+{
+    Scalar* s = filter.statePost.val;
+    state.prevRotation = params.engine == QUATERNION_ENGINE ? Quaternion(s[0], s[1], s[2], s[3]) : nominalQuat;
+    state.dispTranslation = Vector(0.0f, 0.0f, 0.0f);
+}
+
+template class BasicIMUFusion<float>;
+template class BasicIMUFusion<double>;
+template class BasicIMUFusion<float, double>;
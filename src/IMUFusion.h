@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUFusion.h
+ * @brief Gyroscope, accelerometer and magnetometer fusion core, independent of QML and Qt Sensors
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMUFUSION_H
+#define IMUFUSION_H
+
+#include<QtGlobal>
+#include<QString>
+#include<QStringList>
+
+#include"FixedExtendedKalmanFilter.h"
+
+/**
+ * @brief Part of the fusion core that does not depend on its precision: configuration, raw samples and statistics
+ *
+ * These are in qreal like the rest of Qt, so that they are shared by all precisions of BasicIMUFusion.
+ */
+class IMUFusionBase{
+
+public:
+
+    /**
+     * @brief How the correction step processes the observation rows
+     */
+    enum MeasurementUpdate {
+        FULL_UPDATE,        ///< Always correct with all 6 rows, rows of a missing magnetic vector are zero
+        ACTIVE_ROWS_UPDATE, ///< Correct with the 3 gravity rows only when there is no new magnetic vector
+        SEQUENTIAL_UPDATE   ///< Correct with one active row at a time using scalar updates, without matrix inversion
+    };
+
+    /**
+     * @brief How the prediction step integrates the angular velocity over one gyroscope time slice
+     */
+    enum Integrator {
+        FIRST_ORDER_INTEGRATOR, ///< q + 1/2*dt*q*(0, w), accurate only for small rotations per time slice
+        EXPONENTIAL_INTEGRATOR, ///< Exact rotation by w*dt, i.e q*exp(1/2*(0, w*dt)), for an angular velocity constant over the slice
+        CONING_INTEGRATOR,      ///< Exponential map of the rotation vector of an angular velocity linear between the last two samples, with the coning term
+        RK4_INTEGRATOR          ///< Runge-Kutta 4 sub-steps over an angular velocity linear between the last two samples
+    };
+
+    /**
+     * @brief Which filter estimates the rotation and linear acceleration
+     */
+    enum Engine {
+        QUATERNION_ENGINE,      ///< 7 state EKF on the quaternion and linear acceleration, renormalized after every step
+        ERROR_STATE_ENGINE,     ///< Multiplicative EKF on a 3 dof rotation error and linear acceleration around a unit nominal quaternion
+        ERROR_STATE_BIAS_ENGINE ///< ERROR_STATE_ENGINE augmented with gyroscope and accelerometer biases, corrected further while stationary
+    };
+
+    /**
+     * @brief Tunable coefficients of the fusion, see the corresponding IMU properties
+     */
+    struct Parameters{
+        Parameters();
+
+        /**
+         * @brief Gets the names of the scalar coefficients, same as the corresponding IMU properties
+         *
+         * @return Names of the scalar coefficients, i.e all but a_bias, engine, measurementUpdate, integrator and deferredCovariance
+         */
+        static QStringList names();
+
+        /**
+         * @brief Sets a scalar coefficient by name
+         *
+         * @param name Name of the coefficient, see names()
+         * @param value New value
+         *
+         * @return Whether there is a coefficient with the given name
+         */
+        bool set(QString const& name, qreal value);
+
+        /**
+         * @brief Gets a scalar coefficient by name
+         *
+         * @param name Name of the coefficient, see names()
+         * @param value Assigned the current value
+         *
+         * @return Whether there is a coefficient with the given name
+         */
+        bool get(QString const& name, qreal& value) const;
+
+        qreal R_g_startup;              ///< Diagonal entries of gravity obs noise during startup, must be lower than usual
+        qreal R_y_startup;              ///< Diagonal entries of magnetometer obs noise during startup, must be lower than usual
+
+        qreal R_g_k_0;                  ///< Gravity observation constant noise coefficient
+        qreal R_g_k_w;                  ///< Gravity observation angular velocity dependent noise coefficient
+        qreal R_g_k_g;                  ///< Gravity observation gravity norm dependent noise coefficient
+        qreal R_y_k_0;                  ///< Unit y vector observation constant noise coefficient
+        qreal R_y_k_w;                  ///< Unit y vector observation angular velocity dependent noise coefficient
+        qreal R_y_k_g;                  ///< Unit y vector observation gravity norm dependent noise coefficient
+        qreal R_y_k_n;                  ///< Unit y vector observation norm noise coefficient
+        qreal R_y_k_d;                  ///< Unit y vector observation dip angle noise coefficient
+
+        qreal m_mean_alpha;             ///< Smoothing factor for magnetic mean and dip angle mean estimate
+
+        qreal velocityWDecay;           ///< How quickly velocity estimate decays w.r.t angular velocity magnitude
+        qreal velocityADecay;           ///< How quickly velocity estimate decays w.r.t linear acceleration magnitude
+
+        qreal Q_b_w;                    ///< Gyroscope bias random walk noise in (rad/s)^2 per second, ERROR_STATE_BIAS_ENGINE only
+        qreal Q_b_a;                    ///< Accelerometer bias random walk noise in (m/s^2)^2 per second, ERROR_STATE_BIAS_ENGINE only
+        qreal R_s_w;                    ///< Zero angular velocity observation noise while stationary, ERROR_STATE_BIAS_ENGINE only
+        qreal R_s_a;                    ///< Zero linear acceleration observation noise while stationary, ERROR_STATE_BIAS_ENGINE only
+        qreal stationaryWThreshold;     ///< Largest angular velocity magnitude in rad/s that counts as stationary
+        qreal stationaryAThreshold;     ///< Largest deviation of the acceleration magnitude from gravity in m/s^2 that counts as stationary
+        qreal stationaryTime;           ///< Time in seconds within both thresholds before the device is stationary
+
+        qreal gravityGate;              ///< Largest squared Mahalanobis distance of the gravity innovation before it is rejected, chi-square with 3 dof, 0 to disable
+        qreal magneticGate;             ///< Largest squared Mahalanobis distance of the magnetic innovation before it is rejected, chi-square with 3 dof, 0 to disable
+        qreal magneticDipGate;          ///< Largest deviation of the magnetic dip angle from its mean in radians before the magnetic vector is rejected, 0 to disable
+
+        qreal rollbackWindow;           ///< How late in seconds a sample may be and still be fused at its timestamp by a FusionScheduler, 0 to disable
+
+        cv::Vec<qreal, 3> a_bias;       ///< Accelerometer bias in m/s^2
+
+        Engine engine;                  ///< Which filter estimates the rotation and linear acceleration
+        MeasurementUpdate measurementUpdate; ///< How the correction step processes the observation rows
+        Integrator integrator;          ///< How the prediction step integrates the angular velocity
+        bool deferredCovariance;        ///< Whether the covariance prediction of gyroscope samples waits for the next correction, quaternion engine only
+        bool timeAlignment;             ///< Whether accelerometer and magnetometer samples wait for the next gyroscope sample, to predict exactly to their timestamp
+    };
+
+    /**
+     * @brief Raw sensor sample
+     */
+    struct Sample{
+        enum Type{ GYROSCOPE, ACCELEROMETER, MAGNETOMETER };
+
+        Type type;                      ///< Which sensor the sample comes from
+        quint64 timestamp;              ///< Sensor timestamp in microseconds
+        qreal x;                        ///< Reading along x axis, in deg/s, m/s^2 or Teslas depending on type
+        qreal y;                        ///< Reading along y axis, in deg/s, m/s^2 or Teslas depending on type
+        qreal z;                        ///< Reading along z axis, in deg/s, m/s^2 or Teslas depending on type
+    };
+
+    /**
+     * @brief Health and cost measurements accumulated since they were last taken, see takeStatistics()
+     */
+    struct Statistics{
+        Statistics();
+
+        /**
+         * @brief Timing of the samples of one sensor
+         */
+        struct Sensor{
+            quint64 samples;            ///< Samples with a valid time slice
+            quint64 outOfOrder;         ///< Samples not newer than the previous one of the same sensor
+            quint64 dropped;            ///< Samples estimated missing from gaps between timestamps
+            qreal deltaTSum;            ///< Sum of the time slices in seconds
+            qreal deltaTSquaredSum;     ///< Sum of the squared time slices in seconds^2
+        };
+
+        Sensor gyro;                    ///< Gyroscope timing
+        Sensor acc;                     ///< Accelerometer timing
+        Sensor mag;                     ///< Magnetometer timing
+
+        quint64 predictions;            ///< Prediction steps
+        qreal predictTimeSum;           ///< Time spent in prediction steps in seconds
+        qreal predictTimeMax;           ///< Longest prediction step in seconds
+        quint64 corrections;            ///< Correction steps
+        qreal correctTimeSum;           ///< Time spent in correction steps in seconds
+        qreal correctTimeMax;           ///< Longest correction step in seconds
+        qreal innovationSum;            ///< Sum of the innovation magnitudes |z - h(x)| over the active rows
+        qreal innovationMax;            ///< Largest innovation magnitude
+        quint64 gravityRejected;        ///< Corrections skipped because gravity was rejected by Parameters::gravityGate
+        quint64 magRejected;            ///< Magnetic vectors rejected by Parameters::magneticGate or Parameters::magneticDipGate
+        quint64 rollbacks;              ///< Late samples fused by restoring an earlier state, see BasicIMUFusion::restore()
+    };
+};
+
+/**
+ * @brief Sensor fusion core behind the IMU QML item
+ *
+ * Consumes raw sensor samples in Qt Sensors units and maintains the filter state, see README.md for the model.
+ * This is a plain value type: it can be copied, and it can be driven from any thread as long as one thread at a
+ * time uses it. Instantiated for float, double and float with double covariances, see IMUFusion for the one in use.
+ *
+ * @tparam Scalar float or double, of the state, the inputs and the outputs
+ * @tparam CovScalar float or double, of the covariances, Jacobians and gains of the filters, Scalar by default
+ */
+template<typename Scalar, typename CovScalar = Scalar>
+class BasicIMUFusion : public IMUFusionBase{
+
+public:
+
+    typedef cv::Vec<Scalar, 3> Vector;      ///< x, y, z
+    typedef cv::Vec<Scalar, 4> Quaternion;  ///< w, x, y, z
+
+    /**
+     * @brief Snapshot of everything the outputs and the displacement are calculated from
+     */
+    struct State{
+        State();
+
+        quint64 timestamp;              ///< Timestamp of the latest gyroscope or accelerometer sample
+        Quaternion rotation;            ///< Latest a posteriori rotation of the IMU frame w.r.t ground inertial frame, also during startup
+        Vector linearAcceleration;      ///< Latest a posteriori linear acceleration w.r.t ground inertial frame in m/s^2
+        Vector velocity;                ///< Estimated linear velocity
+        Vector gyroBias;                ///< Estimated gyroscope bias in rad/s, zero unless ERROR_STATE_BIAS_ENGINE
+        Vector accBias;                 ///< Estimated accelerometer bias in m/s^2 on top of Parameters::a_bias, zero unless ERROR_STATE_BIAS_ENGINE
+        bool stationary;                ///< Whether the device is detected stationary, only ERROR_STATE_BIAS_ENGINE corrects with it
+        Quaternion prevRotation;        ///< Rotation of IMU frame in the global frame at the last displacement reset
+        Vector dispTranslation;         ///< Translation of IMU frame in the global frame since the last displacement reset
+        Vector translation;             ///< Translation of IMU frame in the global frame since startup, not reset, for displacements with their own reset
+        Scalar startupTime;             ///< Remaining startup time in seconds
+        unsigned int gyroSilentCycles;  ///< Output cycles without gyroscope data
+        unsigned int accSilentCycles;   ///< Output cycles without accelerometer data
+        unsigned int magSilentCycles;   ///< Output cycles without magnetometer data
+    };
+
+    /**
+     * @brief What a new core can start from instead of identity, taken from a converged one, see warmStart()
+     */
+    struct WarmStart{
+        WarmStart();
+
+        Quaternion rotation;            ///< Rotation of the IMU frame w.r.t ground inertial frame
+        Vector gyroBias;                ///< Estimated gyroscope bias in rad/s, zero unless taken from ERROR_STATE_BIAS_ENGINE
+        Vector accBias;                 ///< Estimated accelerometer bias in m/s^2 on top of Parameters::a_bias, zero unless taken from ERROR_STATE_BIAS_ENGINE
+        cv::Matx<CovScalar, 6, 6> biasCov; ///< Covariance of the gyroscope and accelerometer biases in that order, zero unless taken from ERROR_STATE_BIAS_ENGINE
+        Scalar m_norm_mean;             ///< Mean magnitude of the measured magnetic vector, -1 if unknown
+        Scalar m_dip_angle_mean;        ///< Mean dip angle between magnetic vector and floor vector, -1 if unknown
+    };
+
+    /**
+     * @brief Creates a new fusion core at identity rotation, with default parameters
+     *
+     * @param startupTime Startup time in seconds where measurements have much greater effect
+     */
+    explicit BasicIMUFusion(qreal startupTime = 1.0f);
+
+    /**
+     * @brief Gets the current parameters
+     *
+     * @return Current parameters
+     */
+    Parameters const& getParameters() const { return params; }
+
+    /**
+     * @brief Sets new parameters, effective from the next sample on
+     *
+     * A new engine continues from the rotation and linear acceleration of the previous one, with a fresh covariance.
+     *
+     * @param params New parameters
+     */
+    void setParameters(Parameters const& params);
+
+    /**
+     * @brief Processes a sample of any type
+     *
+     * With Parameters::timeAlignment, accelerometer and magnetometer samples newer than the latest prediction are
+     * held until the gyroscope sample that ends their time slice, which is then split at their timestamps with a
+     * linearly interpolated angular velocity. Samples are expected in timestamp order, e.g from a SampleMerger.
+     *
+     * @param sample New sample
+     *
+     * @return Whether the output state changed
+     */
+    bool processSample(Sample const& sample);
+
+    /**
+     * @brief Processes a new gyroscope reading, i.e does the prediction step
+     *
+     * @param timestamp Sensor timestamp in microseconds
+     * @param x Angular velocity around x axis in deg/s
+     * @param y Angular velocity around y axis in deg/s
+     * @param z Angular velocity around z axis in deg/s
+     *
+     * @return Whether the output state changed
+     */
+    bool gyroReading(quint64 timestamp, qreal x, qreal y, qreal z);
+
+    /**
+     * @brief Processes a new accelerometer reading, i.e does the correction step
+     *
+     * @param timestamp Sensor timestamp in microseconds
+     * @param x Acceleration along x axis in m/s^2, including bias
+     * @param y Acceleration along y axis in m/s^2, including bias
+     * @param z Acceleration along z axis in m/s^2, including bias
+     *
+     * @return Whether the output state changed
+     */
+    bool accReading(quint64 timestamp, qreal x, qreal y, qreal z);
+
+    /**
+     * @brief Records a new magnetometer reading, to be used in the next correction step
+     *
+     * @param timestamp Sensor timestamp in microseconds
+     * @param x Magnetic flux along x axis in Teslas
+     * @param y Magnetic flux along y axis in Teslas
+     * @param z Magnetic flux along z axis in Teslas
+     */
+    void magReading(quint64 timestamp, qreal x, qreal y, qreal z);
+
+    /**
+     * @brief Sets the startup time where measurements have much greater effect and restarts startup
+     *
+     * @param startupTime Startup time in seconds, must be larger than 0 to have an effect
+     *
+     * @return Whether startup was restarted
+     */
+    bool restartStartup(qreal startupTime);
+
+    /**
+     * @brief Gets whether the startup time is complete
+     *
+     * @return Whether the startup time is complete and the data is stable
+     */
+    bool isStartupComplete() const { return state.startupTime <= 0; }
+
+    /**
+     * @brief Gets what a new core can be warm started from
+     *
+     * @param warmStart Assigned the rotation, biases and magnetic means of this core
+     *
+     * @return Whether startup is complete, i.e whether the values are converged and worth keeping
+     */
+    bool getWarmStart(WarmStart& warmStart) const;
+
+    /**
+     * @brief Starts from the values of an earlier, converged core instead of identity, before any sample
+     *
+     * The biases and magnetic means continue. Since the device may have moved in between, the rotation snaps to the
+     * tilt of the first accelerometer reading and to the heading of the first magnetometer reading instead of
+     * converging to them, and the given startup time, much shorter than a cold one, refines it. The heading of the
+     * restored rotation is kept until a magnetometer reading arrives, and for good if none arrives during startup.
+     * The biases are held during this startup like in a cold one, and continue with their own covariance afterwards.
+     *
+     * @param warmStart Values taken from the earlier core with getWarmStart()
+     * @param startupTime Startup time in seconds, may be 0 to trust the rotation right away
+     *
+     * @return Whether the values were taken, false if samples were already processed
+     */
+    bool warmStart(WarmStart const& warmStart, qreal startupTime);
+
+    /**
+     * @brief Sets the last pose as the current pose for the displacement calculation
+     */
+    void resetDisplacement();
+
+    /**
+     * @brief Gets the latest snapshot
+     *
+     * @return Latest snapshot of the state
+     */
+    State const& getState() const { return state; }
+
+    /**
+     * @brief Sets whether statistics are accumulated, they cost two clock reads per step
+     *
+     * @param enabled Whether statistics are accumulated, disabled by default
+     */
+    void setStatisticsEnabled(bool enabled){ statisticsEnabled = enabled; }
+
+    /**
+     * @brief Goes back to an earlier copy of this core, keeping the statistics accumulated since and counting a rollback
+     *
+     * The timing of the samples fused again is not counted again, the work of fusing them is.
+     *
+     * @param checkpoint Earlier copy of this core
+     */
+    void restore(BasicIMUFusion const& checkpoint);
+
+    /**
+     * @brief Gets the statistics accumulated since the last call and starts accumulating anew
+     *
+     * @return Statistics since the last call
+     */
+    Statistics takeStatistics();
+
+private:
+
+    template<typename, typename> friend class FusionBenchmark; ///< Times the steps below in isolation, see benchmarks/fusion-benchmark
+
+    /**
+     * @brief Normalizes given quaternion to unit norm
+     *
+     * @param quat Quaternion to normalize, in w, x, y, z order
+     */
+    void normalizeQuat(Scalar* quat);
+
+    /**
+     * @brief Ensures the sign of the quaternion is right so that we prevent quaternion unwinding
+     *
+     * @param prevQuat Previous value of the quaternion, in w, x, y, z order
+     * @param quat Current value of the quaternion to be corrected, in w, x, y, z order
+     */
+    void shortestPathQuat(Scalar* prevQuat, Scalar* quat);
+
+    /**
+     * @brief Accounts a sample of one sensor in the statistics
+     *
+     * @param sensor Statistics of the sensor
+     * @param meanDeltaT Running mean time slice of the sensor, updated
+     * @param timestamp Timestamp of the new sample
+     * @param lastTimestamp Timestamp of the previous sample of the same sensor, larger than 0
+     */
+    void countSample(Statistics::Sensor& sensor, qreal& meanDeltaT, quint64 timestamp, quint64 lastTimestamp);
+
+    /**
+     * @brief Calculates and records the process values
+     *
+     * Calculates the following:
+     * Process value f(x'(k-1|k-1), U(k-1))
+     * Transition matrix F(k-1)
+     * Process noise covariance matrix Q(k-1)
+     */
+    void calculateProcess();
+
+    /**
+     * @brief Calculates the rotation over the latest gyroscope time slice with the chosen integrator
+     *
+     * The a priori rotation is the a posteriori rotation times this quaternion, which is therefore also the
+     * quaternion block of the transition matrix as a right multiplication. FIRST_ORDER_INTEGRATOR gives the
+     * exponential map here, it is only used this way by the error state engine.
+     *
+     * @param deltaQuat Assigned the rotation over the time slice, in w, x, y, z order
+     */
+    void calculateDeltaQuat(Scalar* deltaQuat);
+
+    /**
+     * @brief Folds the quaternion block of the latest deferred prediction into the pending rotation and noise
+     *
+     * The quaternion block of every transition matrix is the right multiplication by a rotation, so the transitions
+     * compose into the right multiplication by the product of these rotations, stored in pendingDeltaQuat.
+     */
+    void foldPendingPrediction();
+
+    /**
+     * @brief Propagates the covariance over all deferred predictions, none are pending afterwards
+     *
+     * The covariance is propagated exactly through the pending rotation and then through the latest transition, only
+     * the process noise of the earlier predictions is added without being rotated.
+     */
+    void flushPendingPredictions();
+
+    /**
+     * @brief Calculates and records the process values of the error state engine and advances the nominal rotation
+     *
+     * Calculates the following:
+     * Process value f(x'(k-1|k-1), U(k-1)), the rotation error part being zero
+     * Transition matrix F(k-1) of the rotation error and linear acceleration
+     * Process noise covariance matrix Q(k-1)
+     */
+    void calculateErrorProcess();
+
+    /**
+     * @brief Calculates and records the process values of the bias engine and advances the nominal rotation
+     *
+     * Same as calculateErrorProcess() with the biases removed from the readings; the biases are random walks, a
+     * gyroscope bias error turns the rotation error by -dt times itself.
+     */
+    void calculateBiasProcess();
+
+    /**
+     * @brief Starts the bias engine over from the given rotation and linear acceleration, with zero biases
+     *
+     * @param rotation Nominal rotation to start from
+     * @param linearAcceleration Linear acceleration to start from
+     */
+    void resetBiasFilter(Quaternion const& rotation, Vector const& linearAcceleration);
+
+    /**
+     * @brief Gives the biases of the bias engine their initial uncertainty, they do not move before
+     */
+    void startBiasEstimation();
+
+    /**
+     * @brief Moves the corrected rotation error of an error state engine into the nominal rotation
+     *
+     * @param error Rotation error, the first 3 entries of the a posteriori state, reset to zero
+     */
+    void applyErrorCorrection(Scalar* error);
+
+    /**
+     * @brief Sets the rotation of all engines, without touching their covariance
+     *
+     * @param rotation New rotation of the IMU frame w.r.t ground inertial frame
+     */
+    void setRotation(Quaternion const& rotation);
+
+    /**
+     * @brief Sets the rotation from the latest acceleration and, if new and still pending, the latest magnetic vector
+     *
+     * The tilt comes from the acceleration and the heading from the magnetic vector, or from the current rotation.
+     */
+    void alignRotation();
+
+    /**
+     * @brief Updates the stationary detection from the angular velocity and acceleration magnitudes, in every engine
+     */
+    void detectStationary();
+
+    /**
+     * @brief Corrects the bias engine with zero angular velocity and zero linear acceleration while stationary
+     *
+     * The angular velocity of a stationary device is its gyroscope bias, so the raw reading observes the bias directly.
+     */
+    void correctStationary();
+
+    /**
+     * @brief Calculates and records predicted observation values
+     *
+     * Calculates the following:
+     * Observation value z(k)
+     * Predicted observation value h(x'(k|k+1))
+     * Observation matrix H(k), of the filter of the current engine; the bias engine expects the gravity rows plus the accelerometer bias
+     *
+     * @return Whether a new magnetic vector was observed, i.e whether the last 3 observation rows are active
+     */
+    bool calculateObservation();
+
+    /**
+     * @brief Rejects the gravity and magnetic observations whose innovation is too unlikely, see Parameters::gravityGate
+     *
+     * A rejected magnetic vector is taken out of the observation, H(k) included, as if there was none.
+     *
+     * @param ekf Filter of the current engine, after calculateObservation()
+     * @param magObserved Whether a new magnetic vector is observed, cleared if it is rejected
+     *
+     * @return Whether the gravity observation is accepted, the correction is skipped otherwise
+     */
+    template<typename EKF> bool gateObservation(EKF& ekf, bool& magObserved);
+
+    /**
+     * @brief Records the a posteriori rotation and linear acceleration in the snapshot
+     *
+     * @return Whether there is output, i.e whether startup is complete and the outputs should be published
+     */
+    bool calculateOutput();
+
+    /**
+     * @brief Updates the displacement values
+     *
+     * Updates the displacement translation and velocity estimate.
+     * Displacement rotation needs no update and can be calculated from the current device rotation.
+     */
+    void updateDisplacement();
+
+    /**
+     * @brief Does the prediction step from the latest prediction up to the given time
+     *
+     * @param timestamp Time to predict to in microseconds, after the latest prediction
+     * @param wRead Angular velocity at that time in local frame in rad/s, including the gyroscope bias
+     *
+     * @return Whether the output state changed
+     */
+    bool predict(quint64 timestamp, Vector const& wRead);
+
+    /**
+     * @brief Fuses all held samples with the latest angular velocity, see Parameters::timeAlignment
+     *
+     * @return Whether the output state changed
+     */
+    bool flushAlignedSamples();
+
+    static const Scalar EPSILON;    ///< FLT_EPSILON or DBL_EPSILON
+    static const Scalar RK4_SUBSTEP_ANGLE;  ///< Largest rotation in radians of one RK4_INTEGRATOR sub-step
+    static const int RK4_MAX_SUBSTEPS;      ///< Most RK4_INTEGRATOR sub-steps in one time slice
+    static const int ALIGNMENT_CAPACITY = 16;   ///< Most samples held for one gyroscope time slice before fusing them regardless
+
+    typedef FixedExtendedKalmanFilter<7, 6, Scalar, CovScalar> Filter;
+    typedef FixedExtendedKalmanFilter<6, 6, Scalar, CovScalar> ErrorFilter;
+    typedef FixedExtendedKalmanFilter<12, 6, Scalar, CovScalar> BiasFilter;
+
+    Parameters params;                          ///< Tunable coefficients
+    State state;                                ///< Latest snapshot
+
+    quint64 lastGyroTimestamp;                  ///< Most recent gyroscope measurement timestamp
+    quint64 lastAccTimestamp;                   ///< Most recent accelerometer measurement timestamp
+    quint64 lastMagTimestamp;                   ///< Most recent magnetometer measurement timestamp
+    quint64 predictedTimestamp;                 ///< Time the filter is predicted to, lastGyroTimestamp unless Parameters::timeAlignment
+
+    Filter filter;                              ///< Filter that estimates current tilt and linear acceleration in ground frame
+
+    typename Filter::StateMatrix Q;             ///< Base for process noise covariance matrix
+    typename Filter::StateVector process;       ///< Temporary matrix to hold the calculated process value, i.e rotation and acceleration
+
+    ErrorFilter errorFilter;                    ///< Filter that estimates the rotation error and linear acceleration in the error state engine
+    typename ErrorFilter::StateMatrix errorQ;   ///< Base for process noise covariance matrix of the error state engine
+    typename ErrorFilter::StateVector errorProcess; ///< Temporary matrix to hold the calculated process value of the error state engine
+    Quaternion nominalQuat;                     ///< Nominal rotation of the error state engines, the true rotation being nominalQuat*exp(error/2)
+
+    BiasFilter biasFilter;                      ///< Filter of the bias engine, on the rotation error, gyroscope bias, accelerometer bias and linear acceleration in that order
+    typename BiasFilter::StateVector biasProcess; ///< Temporary matrix to hold the calculated process value of the bias engine
+    typename BiasFilter::ObservationVector stationaryObservation; ///< Temporary matrix to hold the raw angular velocity and zero linear acceleration while stationary
+    typename BiasFilter::ObservationVector stationaryPrediction;  ///< Temporary matrix to hold the gyroscope bias and linear acceleration they are expected to be
+    Scalar stationaryElapsed;                   ///< Time the readings have been within the stationary thresholds
+    Scalar stationaryWMean;                     ///< Low pass filtered angular velocity magnitude, -1 before the first reading
+    Scalar stationaryAMean;                     ///< Low pass filtered deviation of the acceleration magnitude from gravity, -1 before the first reading
+    cv::Matx<CovScalar, 6, 6> biasStartCov;     ///< Covariance the biases of the bias engine start from when startup is complete
+
+    typename Filter::ObservationVector observation;             ///< Temporary matrix to hold gravity and magnetometer observation
+    typename Filter::ObservationVector predictedObservation;    ///< Temporary matrix to hold gravity and magnetometer expectation based on current rotation
+
+    cv::Matx<Scalar, 4, 1> statePreHistory;     ///< Previous value of the a priori state for quaternion sign correction
+    cv::Matx<Scalar, 4, 1> statePostHistory;    ///< Previous value of the a posteriori state for quaternion sign correction
+
+    int pendingPredictions;                     ///< Predictions whose covariance propagation is deferred, the latest being in filter
+    cv::Vec<CovScalar, 4> pendingDeltaQuat;     ///< Product of the rotations of the pending predictions before the latest
+    cv::Matx<CovScalar, 4, 4> pendingQuatNoise; ///< Sum of the quaternion process noise of the pending predictions before the latest
+
+    Vector w;                       ///< Latest angular velocity in local frame in rad/s, without the estimated gyroscope bias
+    Vector wRaw;                    ///< Latest angular velocity in local frame in rad/s as read, or interpolated at the latest prediction
+    Vector wPrev;                   ///< Angular velocity of the gyroscope sample before the latest, equal to w at the first one
+    Scalar wDeltaT;                 ///< Latest time slice for angular velocity
+    Vector a;                       ///< Latest acceleration vector in local frame in m/s^2
+    Scalar aDeltaT;                 ///< Latest time slice for linear acceleration
+    Vector m;                       ///< Latest magnetic vector in local frame in milliTeslas
+    bool magDataReady;              ///< Whether new magnetometer data arrived
+
+    Sample alignedSamples[ALIGNMENT_CAPACITY];  ///< Accelerometer and magnetometer samples held for the next gyroscope sample, in order
+    int numAlignedSamples;          ///< Number of held samples
+
+    bool alignTiltPending;          ///< Whether the rotation snaps to the next accelerometer reading, after a warm start
+    bool alignHeadingPending;       ///< Whether the rotation snaps to the next magnetometer reading, after a warm start until startup is complete
+
+    Scalar w_norm;                  ///< Magnitude of the latest angular velocity, for noise calculation
+    Scalar a_norm;                  ///< Magnitude of the latest acceleration without the estimated bias, for noise calculation
+    Scalar m_norm;                  ///< Magnitude of the latest magnetic vector, for noise calculation
+    Scalar m_norm_mean;             ///< Mean magnitude of the measured magnetic vector
+    Scalar m_dip_angle_mean;        ///< Mean dip angle between magnetic vector and floor vector
+
+    bool statisticsEnabled;         ///< Whether statistics are accumulated
+    Statistics statistics;          ///< Statistics since they were last taken
+    qreal gyroMeanDeltaT;           ///< Running mean gyroscope time slice, to detect dropped samples
+    qreal accMeanDeltaT;            ///< Running mean accelerometer time slice, to detect dropped samples
+    qreal magMeanDeltaT;            ///< Running mean magnetometer time slice, to detect dropped samples
+    quint64 replayedTimestamps[3];  ///< Latest timestamp of each sample type before the latest restore(), not counted again
+};
+
+/**
+ * @brief Precision of the fusion core used by the IMU item and the tools, chosen at build time, see src/imu-core.pri
+ *
+ * qreal by default; IMU_FUSION_FLOAT selects float with double covariances, and IMU_FUSION_FLOAT_COVARIANCE with it
+ * float covariances as well.
+ */
+#if defined(IMU_FUSION_FLOAT) && defined(IMU_FUSION_FLOAT_COVARIANCE)
+typedef BasicIMUFusion<float, float> IMUFusion;
+#elif defined(IMU_FUSION_FLOAT)
+typedef BasicIMUFusion<float, double> IMUFusion;
+#else
+typedef BasicIMUFusion<qreal> IMUFusion;
+#endif
+
+#endif /* IMUFUSION_H */
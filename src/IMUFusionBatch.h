@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUFusionBatch.h
+ * @brief N independent fusion cores advanced in lockstep, in struct-of-arrays layout
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMUFUSIONBATCH_H
+#define IMUFUSIONBATCH_H
+
+#include<cfloat>
+#include<cmath>
+#include<type_traits>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief Runs N independent fusion cores together, each lane being one filter with its own stream and parameters
+ *
+ * Every quantity is stored as an array over the lanes and every kernel loops over the lanes innermost, without
+ * branches on lane data, so that the compiler vectorizes the lanes: SSE2 on x86, AVX2 with CONFIG+=imu_avx2 (see
+ * src/imu-core.pri), NEON only in the Android build of the plugin, whose flags in qml-imu.pro the core library, tools
+ * and benchmarks do not get. Lanes that do not take part in a step compute the same math and discard the result.
+ * Each lane keeps a single a posteriori covariance that the corrections update in place.
+ *
+ * Each lane agrees up to rounding with a BasicIMUFusion of the same precisions with the QUATERNION_ENGINE, the SEQUENTIAL_UPDATE measurement update,
+ * which needs no matrix inversion, and the FIRST_ORDER_INTEGRATOR without deferred covariance or time alignment; the
+ * engine, measurementUpdate, integrator, deferredCovariance, timeAlignment, rollbackWindow and innovation gate
+ * parameters are ignored.
+ *
+ * A float batch fits twice the lanes of a double one in the same vector registers; with double covariances only
+ * the covariance arrays and the kernels on them stay at the double width.
+ *
+ * @tparam N Number of lanes, 32 at most; 4 double or 8 float lanes fill two SSE2 or one AVX2 register
+ * @tparam Scalar float or double, of the state, the inputs and the outputs
+ * @tparam CovScalar float or double, of the covariance, Jacobians and gains, Scalar by default
+ */
+template<int N, typename Scalar = qreal, typename CovScalar = Scalar> class IMUFusionBatch{
+
+    static_assert(N > 0 && N <= 32, "Lanes must fit in the changed lanes mask");
+
+public:
+
+    typedef BasicIMUFusion<Scalar, CovScalar> Fusion;   ///< Fusion core that each lane is equivalent to
+
+    /**
+     * @brief Creates N new filters at identity rotation, with default parameters
+     *
+     * @param startupTime Startup time in seconds of every lane
+     */
+    explicit IMUFusionBatch(qreal startupTime = 1.0f)
+    {
+        IMUFusionBase::Parameters params;
+        for(int l = 0; l < N; l++){
+            setParameters(l, params);
+
+            for(int i = 0; i < 7; i++){
+                xPre[i][l] = i == 0 ? 1.0f : 0.0f;
+                xPost[i][l] = xPre[i][l];
+            }
+            for(int i = 0; i < DP; i++)
+                for(int j = i; j < DP; j++){
+                    PPre[at(i, j)][l] = i == j ? Qdiag(i) : 0.0f;
+                    P[at(i, j)][l] = 0.0f;
+                }
+            predicted[l] = false;
+            for(int i = 0; i < 4; i++){
+                preHistory[i][l] = i == 0 ? 1.0f : 0.0f;
+                postHistory[i][l] = preHistory[i][l];
+            }
+            for(int i = 0; i < 3; i++){
+                w[i][l] = 0; a[i][l] = 0; m[i][l] = 0;
+                velocity[i][l] = 0;
+                dispTranslation[i][l] = 0;
+            }
+            for(int i = 0; i < 4; i++)
+                prevRotation[i][l] = i == 0 ? 1.0f : 0.0f;
+
+            wDeltaT[l] = 0; aDeltaT[l] = 0;
+            w_norm[l] = 0; a_norm[l] = 0; m_norm[l] = 0;
+            m_norm_mean[l] = -1; m_dip_angle_mean[l] = -1;
+            magDataReady[l] = false;
+            startupTime_[l] = startupTime;
+            timestamp[l] = 0;
+            lastGyroTimestamp[l] = 0; lastAccTimestamp[l] = 0; lastMagTimestamp[l] = 0;
+            gyroSilentCycles[l] = 0; accSilentCycles[l] = 0; magSilentCycles[l] = 0;
+        }
+    }
+
+    /**
+     * @brief Sets new parameters of one lane, effective from its next sample on
+     *
+     * @param lane Lane to set, less than N
+     * @param params New parameters
+     */
+    void setParameters(int lane, IMUFusionBase::Parameters const& params)
+    {
+        R_g_startup[lane] = params.R_g_startup;
+        R_y_startup[lane] = params.R_y_startup;
+        R_g_k_0[lane] = params.R_g_k_0;
+        R_g_k_w[lane] = params.R_g_k_w;
+        R_g_k_g[lane] = params.R_g_k_g;
+        R_y_k_0[lane] = params.R_y_k_0;
+        R_y_k_w[lane] = params.R_y_k_w;
+        R_y_k_g[lane] = params.R_y_k_g;
+        R_y_k_n[lane] = params.R_y_k_n;
+        R_y_k_d[lane] = params.R_y_k_d;
+        m_mean_alpha[lane] = params.m_mean_alpha;
+        velocityWDecay[lane] = params.velocityWDecay;
+        velocityADecay[lane] = params.velocityADecay;
+        for(int i = 0; i < 3; i++)
+            a_bias[i][lane] = params.a_bias(i);
+    }
+
+    /**
+     * @brief Processes one sample per lane, lanes may get samples of different types
+     *
+     * @param samples N samples, one per lane
+     * @param present N flags telling which lanes have a sample, nullptr if all lanes have one
+     *
+     * @return Mask of the lanes whose output state changed, bit l for lane l
+     */
+    unsigned int processSamples(IMUFusionBase::Sample const* samples, bool const* present = nullptr)
+    {
+        bool gyroLane[N], accLane[N];
+        bool anyGyro = false, anyAcc = false;
+
+        //Per lane bookkeeping of timestamps and startup, same as IMUFusion::gyroReading() etc.
+        for(int l = 0; l < N; l++){
+            gyroLane[l] = false;
+            accLane[l] = false;
+            if(present != nullptr && !present[l])
+                continue;
+
+            IMUFusionBase::Sample const& s = samples[l];
+            switch(s.type){
+                case IMUFusionBase::Sample::GYROSCOPE:
+                    if(lastGyroTimestamp[l] > 0){
+                        Scalar dt = ((Scalar)(qint64)(s.timestamp - lastGyroTimestamp[l]))/1000000.0f;
+                        if(dt > 0){
+                            gyroLane[l] = anyGyro = true;
+                            wDeltaT[l] = dt;
+                            gyroSilentCycles[l] = 0;
+                            if(startupTime_[l] > 0){
+                                startupTime_[l] -= dt;
+                                if(startupTime_[l] < 0){
+                                    startupTime_[l] = 0;
+                                    resetDisplacement(l);
+                                    for(int i = 0; i < 3; i++)
+                                        velocity[i][l] = 0;
+                                }
+                            }
+                            const Scalar degToRad = (Scalar)M_PI/180.0f;
+                            w[0][l] = s.x*degToRad;
+                            w[1][l] = s.y*degToRad;
+                            w[2][l] = s.z*degToRad;
+                            w_norm[l] = std::sqrt(w[0][l]*w[0][l] + w[1][l]*w[1][l] + w[2][l]*w[2][l]);
+                            timestamp[l] = s.timestamp;
+                        }
+                    }
+                    lastGyroTimestamp[l] = s.timestamp;
+                    break;
+
+                case IMUFusionBase::Sample::ACCELEROMETER:
+                    if(lastAccTimestamp[l] > 0){
+                        Scalar dt = ((Scalar)(qint64)(s.timestamp - lastAccTimestamp[l]))/1000000.0f;
+                        if(dt > 0){
+                            accLane[l] = anyAcc = true;
+                            aDeltaT[l] = dt;
+                            accSilentCycles[l] = 0;
+                            a[0][l] = s.x - a_bias[0][l];
+                            a[1][l] = s.y - a_bias[1][l];
+                            a[2][l] = s.z - a_bias[2][l];
+                            a_norm[l] = std::sqrt(a[0][l]*a[0][l] + a[1][l]*a[1][l] + a[2][l]*a[2][l]);
+                            timestamp[l] = s.timestamp;
+                        }
+                    }
+                    lastAccTimestamp[l] = s.timestamp;
+                    break;
+
+                case IMUFusionBase::Sample::MAGNETOMETER:
+                    if(lastMagTimestamp[l] > 0 && ((Scalar)(qint64)(s.timestamp - lastMagTimestamp[l]))/1000000.0f > 0){
+                        magSilentCycles[l] = 0;
+                        m[0][l] = s.x*1000000.0f;
+                        m[1][l] = s.y*1000000.0f;
+                        m[2][l] = s.z*1000000.0f;
+                        m_norm[l] = std::sqrt(m[0][l]*m[0][l] + m[1][l]*m[1][l] + m[2][l]*m[2][l]);
+                        magDataReady[l] = true;
+                    }
+                    lastMagTimestamp[l] = s.timestamp;
+                    break;
+            }
+        }
+
+        if(anyGyro)
+            predict(gyroLane);
+        if(anyAcc)
+            correct(accLane);
+
+        unsigned int changed = 0;
+        for(int l = 0; l < N; l++)
+            if(gyroLane[l] || accLane[l]){
+                gyroSilentCycles[l]++;
+                accSilentCycles[l]++;
+                magSilentCycles[l]++;
+                if(startupTime_[l] <= 0)
+                    changed |= 1u << l;
+            }
+        return changed;
+    }
+
+    /**
+     * @brief Gets the snapshot of one lane, same as BasicIMUFusion::getState()
+     *
+     * @param lane Lane to get, less than N
+     *
+     * @return Snapshot of the lane
+     */
+    typename Fusion::State getState(int lane) const
+    {
+        typename Fusion::State state;
+        state.timestamp = timestamp[lane];
+        state.rotation = typename Fusion::Quaternion(xPost[0][lane], xPost[1][lane], xPost[2][lane], xPost[3][lane]);
+        state.linearAcceleration = typename Fusion::Vector(xPost[4][lane], xPost[5][lane], xPost[6][lane]);
+        state.velocity = typename Fusion::Vector(velocity[0][lane], velocity[1][lane], velocity[2][lane]);
+        state.prevRotation = typename Fusion::Quaternion(prevRotation[0][lane], prevRotation[1][lane], prevRotation[2][lane], prevRotation[3][lane]);
+        state.dispTranslation = typename Fusion::Vector(dispTranslation[0][lane], dispTranslation[1][lane], dispTranslation[2][lane]);
+        state.startupTime = startupTime_[lane];
+        state.gyroSilentCycles = gyroSilentCycles[lane];
+        state.accSilentCycles = accSilentCycles[lane];
+        state.magSilentCycles = magSilentCycles[lane];
+        return state;
+    }
+
+    /**
+     * @brief Sets the last pose of one lane as its current pose for the displacement calculation
+     *
+     * @param lane Lane to reset, less than N
+     */
+    void resetDisplacement(int lane)
+    {
+        for(int i = 0; i < 4; i++)
+            prevRotation[i][lane] = xPost[i][lane];
+        for(int i = 0; i < 3; i++)
+            dispTranslation[i][lane] = 0.0f;
+    }
+
+private:
+
+    static const int DP = 7;                    ///< State dimension
+    static const int MP = 6;                    ///< Observation dimension
+    static const int PP = DP*(DP + 1)/2;        ///< Packed covariance size, upper triangle
+
+    /**
+     * @brief Gets the index of a covariance entry in the packed upper triangle, row major
+     *
+     * @param i Row
+     * @param j Column, not less than i
+     *
+     * @return Index in P
+     */
+    static constexpr int at(int i, int j){ return i*DP - i*(i - 1)/2 + j - i; }
+
+    /**
+     * @brief Diagonal of the base process noise covariance, same as IMUFusion
+     *
+     * @param i Diagonal index
+     *
+     * @return Q(i,i)
+     */
+    static CovScalar Qdiag(int i){ return i < 4 ? 1e-4f : 1e-2f; }
+
+    /**
+     * @brief Gets FLT_EPSILON or DBL_EPSILON
+     *
+     * @return Machine epsilon of Scalar
+     */
+    static Scalar epsilon(){ return std::is_same<Scalar, double>::value ? DBL_EPSILON : FLT_EPSILON; }
+
+    /**
+     * @brief Converts lane flags to 1 or 0 in the type of the values they select
+     *
+     * The kernels select with compares of masks as wide as the selected values and with every operand loaded up front,
+     * which the vectorizer turns into vector compares and blends; a bool mask or a load in only one branch keeps the
+     * whole lane loop scalar.
+     *
+     * @param flags N flags
+     * @param mask N masks to fill
+     */
+    template<typename T> static void toMask(bool const* flags, T* mask)
+    {
+        for(int l = 0; l < N; l++)
+            mask[l] = flags[l] ? 1.0f : 0.0f;
+    }
+
+    /**
+     * @brief Normalizes the quaternions in the first 4 rows of x in place, flips those closer to the negative of history and updates history, in the given lanes
+     *
+     * Same as IMUFusion::normalizeQuat() followed by IMUFusion::shortestPathQuat().
+     *
+     * @param history Previous quaternions
+     * @param x Lane arrays, at least 4 rows
+     * @param lane Mask of the lanes that take part, see toMask(); the others are left untouched
+     */
+    static void normalizeQuat(Scalar (*history)[N], Scalar (*x)[N], Scalar const* lane)
+    {
+        const Scalar eps = epsilon();
+        for(int l = 0; l < N; l++){
+            Scalar q[4], h[4];
+            for(int i = 0; i < 4; i++){
+                q[i] = x[i][l];
+                h[i] = history[i][l];
+            }
+            Scalar norm = std::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+            Scalar divisor = norm > eps ? norm : 1.0f;
+            Scalar n[4];
+            for(int i = 0; i < 4; i++){
+                Scalar normalized = q[i]/divisor;
+                n[i] = norm > eps ? normalized : 1.0f;
+            }
+            Scalar dot = n[0]*h[0] + n[1]*h[1] + n[2]*h[2] + n[3]*h[3];
+            Scalar sign = dot < 0 ? -1.0f : 1.0f;
+            for(int i = 0; i < 4; i++){
+                n[i] *= sign;
+                x[i][l] = lane[l] > 0 ? n[i] : q[i];
+                history[i][l] = lane[l] > 0 ? n[i] : h[i];
+            }
+        }
+    }
+
+    /**
+     * @brief Prediction step of the given lanes, same as IMUFusion::calculateProcess() and predictLeadingBlock<4>()
+     *
+     * Only the a priori covariance is written, it stands for the a posteriori one until the lane is corrected.
+     *
+     * @param lanes Lanes that got a new gyroscope sample
+     */
+    void predict(bool const* lanes)
+    {
+        const Scalar g = 9.81f;
+        Scalar lane[N];             //Lanes as masks, see toMask()
+        CovScalar covLane[N];
+        CovScalar covPredicted[N];
+        Scalar p[DP][N];            //Process value
+        CovScalar F[DP][4][N];      //Leading 4 columns of the transition matrix, the rest is zero
+        CovScalar Paa[4][4][N];     //Leading 4x4 block of the a posteriori covariance
+        CovScalar T[DP][4][N];      //F_a*P_aa
+        toMask(lanes, lane);
+        toMask(lanes, covLane);
+        toMask(predicted, covPredicted);
+
+        for(int l = 0; l < N; l++){
+            const Scalar q0 = xPost[0][l], q1 = xPost[1][l], q2 = xPost[2][l], q3 = xPost[3][l];
+            const Scalar wx = w[0][l], wy = w[1][l], wz = w[2][l];
+            const Scalar ax = a[0][l], ay = a[1][l], az = a[2][l];
+            const Scalar hdt = 0.5f*wDeltaT[l];
+
+            //Absolute rotation
+            p[0][l] = q0 + hdt*(-q1*wx - q2*wy - q3*wz);
+            p[1][l] = q1 + hdt*(+q0*wx - q3*wy + q2*wz);
+            p[2][l] = q2 + hdt*(+q3*wx + q0*wy - q1*wz);
+            p[3][l] = q3 + hdt*(-q2*wx + q1*wy + q0*wz);
+
+            //Absolute linear acceleration
+            p[4][l] = (q0*q0 + q1*q1 - q2*q2 - q3*q3)*ax + 2*(q1*q2 - q0*q3)*ay + 2*(q1*q3 + q0*q2)*az;
+            p[5][l] = 2*(q1*q2 + q0*q3)*ax + (q0*q0 - q1*q1 + q2*q2 - q3*q3)*ay + 2*(q2*q3 - q0*q1)*az;
+            p[6][l] = 2*(q1*q3 - q0*q2)*ax + 2*(q2*q3 + q0*q1)*ay + (q0*q0 - q1*q1 - q2*q2 + q3*q3)*az - g;
+
+            //Transition matrix
+            F[0][0][l] = 1.0f;      F[0][1][l] = -hdt*wx;   F[0][2][l] = -hdt*wy;   F[0][3][l] = -hdt*wz;
+            F[1][0][l] = +hdt*wx;   F[1][1][l] = 1.0f;      F[1][2][l] = +hdt*wz;   F[1][3][l] = -hdt*wy;
+            F[2][0][l] = +hdt*wy;   F[2][1][l] = -hdt*wz;   F[2][2][l] = 1.0f;      F[2][3][l] = +hdt*wx;
+            F[3][0][l] = +hdt*wz;   F[3][1][l] = +hdt*wy;   F[3][2][l] = -hdt*wx;   F[3][3][l] = 1.0f;
+
+            F[4][0][l] = 2*(+q0*ax - q3*ay + q2*az); F[4][1][l] = 2*(+q1*ax + q2*ay + q3*az); F[4][2][l] = 2*(-q2*ax + q1*ay + q0*az); F[4][3][l] = 2*(-q3*ax - q0*ay + q1*az);
+            F[5][0][l] = 2*(+q3*ax + q0*ay - q1*az); F[5][1][l] = 2*(+q2*ax - q1*ay - q0*az); F[5][2][l] = 2*(+q1*ax + q2*ay + q3*az); F[5][3][l] = 2*(+q0*ax - q3*ay + q2*az);
+            F[6][0][l] = 2*(-q2*ax + q1*ay + q0*az); F[6][1][l] = 2*(+q3*ax + q0*ay - q1*az); F[6][2][l] = 2*(-q0*ax + q3*ay - q2*az); F[6][3][l] = 2*(+q1*ax + q2*ay + q3*az);
+        }
+
+        //P_aa, from the a priori covariance where the lane was not corrected since its last prediction
+        for(int i = 0; i < 4; i++)
+            for(int j = i; j < 4; j++)
+                for(int l = 0; l < N; l++){
+                    const CovScalar prior = PPre[at(i, j)][l], post = P[at(i, j)][l];
+                    Paa[i][j][l] = covPredicted[l] > 0 ? prior : post;
+                    Paa[j][i][l] = Paa[i][j][l];
+                }
+
+        //T = F_a*P_aa
+        for(int i = 0; i < DP; i++)
+            for(int j = 0; j < 4; j++)
+                for(int l = 0; l < N; l++){
+                    CovScalar sum = 0;
+                    for(int k = 0; k < 4; k++)
+                        sum += F[i][k][l]*Paa[k][j][l];
+                    T[i][j][l] = sum;
+                }
+
+        //P(k|k-1) = T*F_at + Q*deltaT, upper triangle only
+        for(int i = 0; i < DP; i++)
+            for(int j = i; j < DP; j++){
+                const CovScalar q = i == j ? Qdiag(i) : 0.0f;
+                for(int l = 0; l < N; l++){
+                    CovScalar sum = q*wDeltaT[l];
+                    for(int k = 0; k < 4; k++)
+                        sum += T[i][k][l]*F[j][k][l];
+                    const CovScalar prior = PPre[at(i, j)][l];
+                    PPre[at(i, j)][l] = covLane[l] > 0 ? sum : prior;
+                }
+            }
+
+        //Unit norm, no unwinding, a posteriori state reflects prediction in case measurement doesn't occur
+        normalizeQuat(preHistory, p, lane);
+        for(int i = 0; i < DP; i++)
+            for(int l = 0; l < N; l++){
+                const Scalar prior = xPre[i][l], post = xPost[i][l];
+                xPre[i][l] = lane[l] > 0 ? p[i][l] : prior;
+                xPost[i][l] = lane[l] > 0 ? p[i][l] : post;
+            }
+        for(int l = 0; l < N; l++)
+            predicted[l] = lanes[l] || predicted[l];
+    }
+
+    /**
+     * @brief Correction step of the given lanes, same as IMUFusion::calculateObservation(), correctSequential() and updateDisplacement()
+     *
+     * The a posteriori state and covariance are corrected in place, starting from the a priori ones.
+     *
+     * @param lanes Lanes that got a new accelerometer sample
+     */
+    void correct(bool const* lanes)
+    {
+        const Scalar g = 9.81f;
+        const Scalar eps = epsilon();
+        Scalar lane[N];             //Lanes as masks, see toMask()
+        CovScalar covLane[N];
+        Scalar z[MP][N];            //Observation minus predicted observation
+        CovScalar H[MP][4][N];      //Leading 4 columns of the observation matrix, the rest is zero
+        CovScalar R[MP][N];         //Diagonal of the observation noise covariance
+        bool magLane[N];            //Whether the magnetometer rows are active
+        bool anyMag = false;
+        toMask(lanes, lane);
+        toMask(lanes, covLane);
+
+        for(int l = 0; l < N; l++){
+            const Scalar q0 = xPre[0][l], q1 = xPre[1][l], q2 = xPre[2][l], q3 = xPre[3][l];
+
+            //Accelerometer observation and noise
+            z[0][l] = a[0][l] - 2*(q1*q3 - q0*q2)*g;
+            z[1][l] = a[1][l] - 2*(q2*q3 + q0*q1)*g;
+            z[2][l] = a[2][l] - (q0*q0 - q1*q1 - q2*q2 + q3*q3)*g;
+            const Scalar R_g = R_g_k_0[l] + R_g_k_w[l]*w_norm[l] + R_g_k_g[l]*std::fabs(g - a_norm[l]);
+
+            //Observation matrix
+            H[0][0][l] = -2*g*q2;  H[0][1][l] = +2*g*q3;  H[0][2][l] = -2*g*q0;  H[0][3][l] = +2*g*q1;
+            H[1][0][l] = +2*g*q1;  H[1][1][l] = +2*g*q0;  H[1][2][l] = +2*g*q3;  H[1][3][l] = +2*g*q2;
+            H[2][0][l] = +2*g*q0;  H[2][1][l] = -2*g*q1;  H[2][2][l] = -2*g*q2;  H[2][3][l] = +2*g*q3;
+            H[3][0][l] = +2*q3;    H[3][1][l] = +2*q2;    H[3][2][l] = +2*q1;    H[3][3][l] = +2*q0;
+            H[4][0][l] = +2*q0;    H[4][1][l] = -2*q1;    H[4][2][l] = +2*q2;    H[4][3][l] = -2*q3;
+            H[5][0][l] = -2*q1;    H[5][1][l] = -2*q0;    H[5][2][l] = +2*q3;    H[5][3][l] = +2*q2;
+
+            //Observation noise, magnetometer part is filled below where observed
+            const Scalar startup = startupTime_[l], R_g_s = R_g_startup[l], R_y_s = R_y_startup[l];
+            for(int r = 0; r < 3; r++){
+                R[r][l] = startup > 0 ? R_g_s : R_g;
+                R[r + 3][l] = startup > 0 ? R_y_s : 1.0f;
+                z[r + 3][l] = 0.0f;
+            }
+        }
+
+        //Consumed latest magnetometer data
+        for(int l = 0; l < N; l++){
+            magLane[l] = magDataReady[l] && lanes[l];
+            anyMag = anyMag || magLane[l];
+            magDataReady[l] = magDataReady[l] && !lanes[l];
+        }
+
+        //Magnetometer observation and noise, per lane since it is rare and needs acos()
+        for(int l = 0; anyMag && l < N; l++){
+            if(!magLane[l])
+                continue;
+
+            const Scalar q0 = xPre[0][l], q1 = xPre[1][l], q2 = xPre[2][l], q3 = xPre[3][l];
+            const Scalar R_DCM_z0 = 2*(q1*q3 - q0*q2);
+            const Scalar R_DCM_z1 = 2*(q2*q3 + q0*q1);
+            const Scalar R_DCM_z2 = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+            Scalar mx = m[0][l], my = m[1][l], mz = m[2][l];
+            const Scalar dot_m_z = mx*R_DCM_z0 + my*R_DCM_z1 + mz*R_DCM_z2;
+
+            Scalar m_dip_angle = std::acos(dot_m_z/m_norm[l]);
+            if(std::isnan(m_dip_angle))
+                m_dip_angle = 0.0f;
+            const Scalar alpha = m_mean_alpha[l];
+            m_norm_mean[l] = m_norm_mean[l] < 0 ? m_norm[l] : alpha*m_norm_mean[l] + (1.0f - alpha)*m_norm[l];
+            m_dip_angle_mean[l] = m_dip_angle_mean[l] < 0 ? m_dip_angle : alpha*m_dip_angle_mean[l] + (1.0f - alpha)*m_dip_angle;
+
+            mx = mx - dot_m_z*R_DCM_z0; //Reject magnetic component on Z axis
+            my = my - dot_m_z*R_DCM_z1;
+            mz = mz - dot_m_z*R_DCM_z2;
+            Scalar uy_norm = std::sqrt(mx*mx + my*my + mz*mz);
+            if(uy_norm > eps){
+                mx /= uy_norm;
+                my /= uy_norm;
+                mz /= uy_norm;
+            }
+            z[3][l] = mx - 2*(q1*q2 + q0*q3);
+            z[4][l] = my - (q0*q0 - q1*q1 + q2*q2 - q3*q3);
+            z[5][l] = mz - 2*(q2*q3 - q0*q1);
+
+            if(startupTime_[l] <= 0){
+                Scalar R_y = R_y_k_0[l] + R_y_k_w[l]*w_norm[l] + R_y_k_g[l]*std::fabs(g - a_norm[l]) +
+                    R_y_k_n[l]*std::fabs(m_norm[l] - m_norm_mean[l]) + R_y_k_d[l]*std::fabs(m_dip_angle - m_dip_angle_mean[l]);
+                for(int r = 3; r < MP; r++)
+                    R[r][l] = R_y;
+            }
+        }
+
+        //Sequential scalar updates in place, starting from the prediction
+        for(int i = 0; i < DP; i++)
+            for(int l = 0; l < N; l++){
+                const Scalar prior = xPre[i][l], post = xPost[i][l];
+                xPost[i][l] = lane[l] > 0 ? prior : post;
+            }
+        for(int i = 0; i < PP; i++)
+            for(int l = 0; l < N; l++){
+                const CovScalar prior = PPre[i][l], post = P[i][l];
+                P[i][l] = covLane[l] > 0 ? prior : post;
+            }
+
+        for(int r = 0; r < (anyMag ? MP : 3); r++){
+            CovScalar rowLane[N];
+            CovScalar PHt[DP][N];
+            CovScalar s[N], innovation[N];
+            CovScalar covActive[N];
+            Scalar active[N];
+            for(int l = 0; l < N; l++)
+                rowLane[l] = lanes[l] && (r < 3 || magLane[l]) ? 1.0f : 0.0f;
+
+            //PHt = P*Hr^t, s = Hr*P*Hr^t + R_rr
+            for(int i = 0; i < DP; i++)
+                for(int l = 0; l < N; l++){
+                    CovScalar sum = 0;
+                    for(int j = 0; j < 4; j++){
+                        const int e = j < i ? at(j, i) : at(i, j);
+                        sum += P[e][l]*H[r][j][l];
+                    }
+                    PHt[i][l] = sum;
+                }
+            for(int l = 0; l < N; l++){
+                CovScalar sum = R[r][l];
+                for(int i = 0; i < 4; i++)
+                    sum += H[r][i][l]*PHt[i][l];
+                s[l] = sum;
+                covActive[l] = rowLane[l] > 0 && sum > 0 ? 1.0f : 0.0f;
+
+                //Innovation around the state corrected by the previous rows
+                CovScalar innov = z[r][l];
+                for(int j = 0; j < 4; j++)
+                    innov -= H[r][j][l]*(xPost[j][l] - xPre[j][l]);
+                innovation[l] = innov;
+            }
+            for(int l = 0; l < N; l++)
+                active[l] = covActive[l];
+
+            //x = x + k*innovation, P = P - k*PHt^t with k = PHt/s, upper triangle only
+            for(int i = 0; i < DP; i++){
+                CovScalar k[N];
+                for(int l = 0; l < N; l++){
+                    k[l] = PHt[i][l]/s[l];
+                    const Scalar x = xPost[i][l], corrected = x + k[l]*innovation[l];
+                    xPost[i][l] = active[l] > 0 ? corrected : x;
+                }
+                for(int j = i; j < DP; j++)
+                    for(int l = 0; l < N; l++){
+                        const CovScalar p = P[at(i, j)][l], corrected = p - k[l]*PHt[j][l];
+                        P[at(i, j)][l] = covActive[l] > 0 ? corrected : p;
+                    }
+            }
+        }
+
+        //Unit norm, no unwinding
+        normalizeQuat(postHistory, xPost, lane);
+        for(int l = 0; l < N; l++)
+            predicted[l] = predicted[l] && !lanes[l];
+
+        //Displacement, only after startup; the decay needs exp() per lane
+        Scalar decay[N], update[N];
+        for(int l = 0; l < N; l++){
+            const Scalar lax = xPost[4][l], lay = xPost[5][l], laz = xPost[6][l];
+            Scalar la_norm = std::sqrt(lax*lax + lay*lay + laz*laz);
+            Scalar e_minus_w_norm = std::exp(-velocityWDecay[l]*w_norm[l]);
+            Scalar e_minus_la_norm = std::exp(-velocityADecay[l]*la_norm);
+            decay[l] = (1.0f - e_minus_w_norm)/(1.0f + e_minus_w_norm)*(1.0f - e_minus_la_norm)/(1.0f + e_minus_la_norm);
+            update[l] = lanes[l] && startupTime_[l] <= 0 ? 1.0f : 0.0f;
+        }
+        for(int i = 0; i < 3; i++)
+            for(int l = 0; l < N; l++){
+                const Scalar dt = aDeltaT[l], la = xPost[4 + i][l], v = velocity[i][l], d = dispTranslation[i][l];
+                const Scalar translated = d + (dt*v + 0.5f*dt*dt*la), decayed = decay[l]*(v + dt*la);
+                dispTranslation[i][l] = update[l] > 0 ? translated : d;
+                velocity[i][l] = update[l] > 0 ? decayed : v;
+            }
+    }
+
+    /// @defgroup batchParameters Parameters of each lane, see IMUFusionBase::Parameters
+    /// @{
+    Scalar R_g_startup[N], R_y_startup[N];
+    Scalar R_g_k_0[N], R_g_k_w[N], R_g_k_g[N];
+    Scalar R_y_k_0[N], R_y_k_w[N], R_y_k_g[N], R_y_k_n[N], R_y_k_d[N];
+    Scalar m_mean_alpha[N];
+    Scalar velocityWDecay[N], velocityADecay[N];
+    Scalar a_bias[3][N];
+    /// @}
+
+    /// @defgroup batchFilter Filter of each lane, see FixedExtendedKalmanFilter
+    /// @{
+    alignas(32) Scalar xPre[DP][N];         ///< A priori state
+    alignas(32) Scalar xPost[DP][N];        ///< A posteriori state
+    alignas(32) CovScalar PPre[PP][N];      ///< A priori error covariance, packed upper triangle
+    alignas(32) CovScalar P[PP][N];         ///< A posteriori error covariance, packed upper triangle, updated in place
+    bool predicted[N];                      ///< Whether the lane was not corrected since its last prediction, PPre is then its a posteriori covariance too
+    alignas(32) Scalar preHistory[4][N];    ///< Previous a priori quaternion for sign correction
+    alignas(32) Scalar postHistory[4][N];   ///< Previous a posteriori quaternion for sign correction
+    /// @}
+
+    /// @defgroup batchInputs Latest inputs of each lane, see IMUFusion
+    /// @{
+    alignas(32) Scalar w[3][N];             ///< Latest angular velocity in rad/s
+    alignas(32) Scalar a[3][N];             ///< Latest acceleration in m/s^2
+    alignas(32) Scalar m[3][N];             ///< Latest magnetic vector in milliTeslas
+    Scalar wDeltaT[N], aDeltaT[N];          ///< Latest time slices
+    Scalar w_norm[N], a_norm[N], m_norm[N]; ///< Input magnitudes
+    Scalar m_norm_mean[N];                  ///< Mean magnitude of the magnetic vector
+    Scalar m_dip_angle_mean[N];             ///< Mean dip angle of the magnetic vector
+    bool magDataReady[N];                   ///< Whether new magnetometer data arrived
+    /// @}
+
+    /// @defgroup batchState Snapshot quantities of each lane, see IMUFusion::State
+    /// @{
+    alignas(32) Scalar velocity[3][N];
+    alignas(32) Scalar dispTranslation[3][N];
+    alignas(32) Scalar prevRotation[4][N];
+    Scalar startupTime_[N];
+    quint64 timestamp[N];
+    quint64 lastGyroTimestamp[N], lastAccTimestamp[N], lastMagTimestamp[N];
+    unsigned int gyroSilentCycles[N], accSilentCycles[N], magSilentCycles[N];
+    /// @}
+};
+
+#endif /* IMUFUSIONBATCH_H */
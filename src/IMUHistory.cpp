@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUHistory.cpp
+ * @brief Implementation of the QML list model over the latest full rate fused states of an IMU
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"IMUHistory.h"
+#include"IMULogging.h"
+
+#include<QQuaternion>
+#include<QVector3D>
+
+IMUHistory::IMUHistory(QObject* parent) :
+    QAbstractListModel(parent),
+    windowSize(256),
+    cursor(0)
+{
+}
+
+void IMUHistory::setSource(IMU* source)
+{
+    if(this->source == source)
+        return;
+
+    if(this->source)
+        disconnect(this->source, nullptr, this, nullptr);
+    this->source = source;
+    if(source)
+        connect(source, SIGNAL(stateChanged()), this, SLOT(pull()));
+
+    beginResetModel();
+    records.clear();
+    cursor = 0;
+    endResetModel();
+    emit countChanged();
+    emit sourceChanged();
+    pull();
+}
+
+void IMUHistory::setWindowSize(int windowSize)
+{
+    if(windowSize <= 0){
+        qCWarning(imuLog) << "Window size must be larger than 0, got " << windowSize;
+        return;
+    }
+    if(windowSize == this->windowSize)
+        return;
+
+    this->windowSize = windowSize;
+    if(records.size() > windowSize)
+        removeOldest(records.size() - windowSize);
+    emit windowSizeChanged();
+}
+
+int IMUHistory::rowCount(QModelIndex const& parent) const
+{
+    return parent.isValid() ? 0 : records.size();
+}
+
+QVariant IMUHistory::data(QModelIndex const& index, int role) const
+{
+    if(!index.isValid() || index.row() >= records.size())
+        return QVariant();
+
+    StateRecord const& record = records[index.row()];
+    switch(role){
+        case TimestampRole:
+            return QVariant((double)record.timestamp);
+        case RotationRole:
+            return QVariant(QQuaternion(record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3]));
+        case LinearAccelerationRole:
+            return QVariant(QVector3D(record.linearAcceleration[0], record.linearAcceleration[1], record.linearAcceleration[2]));
+        case DispTranslationRole:
+            return QVariant(QVector3D(record.dispTranslation[0], record.dispTranslation[1], record.dispTranslation[2]));
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> IMUHistory::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[TimestampRole] = "timestamp";
+    roles[RotationRole] = "rotation";
+    roles[LinearAccelerationRole] = "linearAcceleration";
+    roles[DispTranslationRole] = "dispTranslation";
+    return roles;
+}
+
+void IMUHistory::pull()
+{
+    if(!source)
+        return;
+
+    //Copied out first, the fusion thread may overwrite the oldest ones while they are read
+    StateRing const& history = source->getHistory();
+    StateRing::Span span = history.since(cursor);
+    cursor = span.sequence() + span.size();
+    if(span.size() == 0)
+        return;
+    incoming.resize(0);
+    for(int i = 0; i < 2; i++)
+        for(std::size_t j = 0; j < span.runSize(i); j++)
+            incoming.append(span.run(i)[j]);
+    const quint64 oldest = history.oldest();
+    int torn = oldest > span.sequence() ? (int)qMin<quint64>(oldest - span.sequence(), incoming.size()) : 0;
+
+    //Only the newest windowSize rows are ever shown
+    int first = qMax(torn, incoming.size() - windowSize);
+    int count = incoming.size() - first;
+    if(count <= 0)
+        return;
+    if(records.size() + count > windowSize)
+        removeOldest(records.size() + count - windowSize);
+
+    beginInsertRows(QModelIndex(), records.size(), records.size() + count - 1);
+    for(int i = first; i < incoming.size(); i++)
+        records.append(incoming[i]);
+    endInsertRows();
+    emit countChanged();
+}
+
+void IMUHistory::clear()
+{
+    if(source)
+        cursor = source->getHistory().sequence();
+    if(!records.isEmpty())
+        removeOldest(records.size());
+}
+
+void IMUHistory::removeOldest(int count)
+{
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    records.remove(0, count);
+    endRemoveRows();
+    emit countChanged();
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUHistory.h
+ * @brief QML list model over the latest full rate fused states of an IMU
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMUHISTORY_H
+#define IMUHISTORY_H
+
+#include<QAbstractListModel>
+#include<QPointer>
+#include<QVector>
+
+#include"IMU.h"
+#include"StateRing.h"
+
+/**
+ * @brief Window over the latest fused states of a source IMU, one row per sample that changed the state
+ *
+ * The rows are the ones recorded in IMU::getHistory() since startup, at the full sensor rate. They are pulled in one
+ * batch whenever the source publishes, so a plot or a logger gets every state with a single rowsInserted() per
+ * publish instead of one signal per sample. Rows are oldest first, the oldest ones are removed beyond windowSize.
+ */
+class IMUHistory : public QAbstractListModel {
+Q_OBJECT
+    Q_DISABLE_COPY(IMUHistory)
+    Q_PROPERTY(IMU* source READ getSource WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int windowSize READ getWindowSize WRITE setWindowSize NOTIFY windowSizeChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+
+    /**
+     * @brief Roles of the rows
+     */
+    enum Role {
+        TimestampRole = Qt::UserRole + 1,   ///< timestamp: Timestamp of the sample in microseconds, as a double
+        RotationRole,                       ///< rotation: Rotation of the IMU frame w.r.t ground inertial frame, as a quaternion
+        LinearAccelerationRole,             ///< linearAcceleration: Linear acceleration w.r.t ground inertial frame in m/s^2, as a vector3d
+        DispTranslationRole                 ///< dispTranslation: Translation of the IMU frame in the global frame since the last displacement reset, as a vector3d
+    };
+
+    /**
+     * @brief Creates a new empty history
+     *
+     * @param parent The QObject parent
+     */
+    IMUHistory(QObject* parent = 0);
+
+    /**
+     * @brief Returns the source IMU
+     *
+     * @return Source IMU, nullptr if none
+     */
+    IMU* getSource(){ return source; }
+
+    /**
+     * @brief Sets the source IMU, the rows start over from the states it still keeps
+     *
+     * @param source New source IMU, nullptr to detach
+     */
+    void setSource(IMU* source);
+
+    /**
+     * @brief Gets the largest number of rows
+     *
+     * @return Largest number of rows
+     */
+    int getWindowSize(){ return windowSize; }
+
+    /**
+     * @brief Sets the largest number of rows, the oldest ones are removed beyond it
+     *
+     * @param windowSize New largest number of rows, must be larger than 0, no more than the capacity of IMU::getHistory() are ever available
+     */
+    void setWindowSize(int windowSize);
+
+    /**
+     * @brief Gets the number of rows
+     *
+     * @param parent Unused, the model is a flat list
+     *
+     * @return Number of rows
+     */
+    int rowCount(QModelIndex const& parent = QModelIndex()) const;
+
+    /**
+     * @brief Gets a role of a row
+     *
+     * @param index Index of the row
+     * @param role One of Role
+     *
+     * @return Value of the role, invalid if the index or the role is invalid
+     */
+    QVariant data(QModelIndex const& index, int role) const;
+
+    /**
+     * @brief Gets the names the roles are accessed with from QML
+     *
+     * @return Names of the roles
+     */
+    QHash<int, QByteArray> roleNames() const;
+
+    /**
+     * @brief Gets the rows, e.g for C++ consumers that read them in bulk
+     *
+     * @return Rows, oldest first
+     */
+    QVector<StateRecord> const& getRecords() const { return records; }
+
+public slots:
+
+    /**
+     * @brief Appends the states recorded by the source since the last pull, called whenever the source publishes
+     */
+    void pull();
+
+    /**
+     * @brief Removes all rows, the next pull only appends newer states
+     */
+    void clear();
+
+signals:
+
+    /**
+     * @brief Emitted when the source IMU changes
+     */
+    void sourceChanged();
+
+    /**
+     * @brief Emitted when the largest number of rows changes
+     */
+    void windowSizeChanged();
+
+    /**
+     * @brief Emitted when the number of rows changes
+     */
+    void countChanged();
+
+private:
+
+    /**
+     * @brief Removes the oldest rows
+     *
+     * @param count Number of rows to remove, at most rowCount()
+     */
+    void removeOldest(int count);
+
+    QPointer<IMU> source;               ///< Source IMU whose history is pulled
+    int windowSize;                     ///< Largest number of rows
+    quint64 cursor;                     ///< Sequence number of the next state to pull from the history of the source
+    QVector<StateRecord> records;       ///< Rows, oldest first
+    QVector<StateRecord> incoming;      ///< States being pulled, checked before they become rows
+};
+
+#endif /* IMUHISTORY_H */
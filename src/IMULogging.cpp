@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMULogging.cpp
+ * @brief Implementation of the logging categories and the per sample rate limiting
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"IMULogging.h"
+
+#include<chrono>
+
+Q_LOGGING_CATEGORY(imuSensors, "imu.sensors")
+Q_LOGGING_CATEGORY(imuFusion, "imu.fusion")
+Q_LOGGING_CATEGORY(imuLog, "imu.log")
+Q_LOGGING_CATEGORY(imuSamples, "imu.samples")
+Q_LOGGING_CATEGORY(imuBias, "imu.bias")
+
+namespace{
+
+    int defaultSampleInterval()
+    {
+        bool valid = false;
+        int interval = qgetenv("QML_IMU_SAMPLE_LOG_INTERVAL").toInt(&valid);
+        return valid && interval >= 0 ? interval : 1000;
+    }
+
+    std::atomic<int> sampleInterval(defaultSampleInterval());
+}
+
+void IMULogging::setSampleInterval(int milliseconds)
+{
+    sampleInterval.store(milliseconds > 0 ? milliseconds : 0, std::memory_order_relaxed);
+}
+
+int IMULogging::getSampleInterval()
+{
+    return sampleInterval.load(std::memory_order_relaxed);
+}
+
+bool IMULogging::RateLimiter::ready()
+{
+    qint64 now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    qint64 previous = last.load(std::memory_order_relaxed);
+    if(previous >= 0 && now - previous < sampleInterval.load(std::memory_order_relaxed))
+        return false;
+
+    //Only one of the threads that race here gets the message through
+    return last.compare_exchange_strong(previous, now, std::memory_order_relaxed);
+}
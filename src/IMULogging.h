@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMULogging.h
+ * @brief Logging categories of the plugin and rate limited per sample logging that can be compiled out
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMULOGGING_H
+#define IMULOGGING_H
+
+#include<QLoggingCategory>
+
+#include<atomic>
+
+/**
+ * Categories can be filtered as usual, e.g QT_LOGGING_RULES="imu.samples.debug=false;imu.sensors.debug=true"
+ */
+Q_DECLARE_LOGGING_CATEGORY(imuSensors)  ///< imu.sensors: opening sensors, missing, silent or lagging sensors
+Q_DECLARE_LOGGING_CATEGORY(imuFusion)   ///< imu.fusion: startup and fusion settings
+Q_DECLARE_LOGGING_CATEGORY(imuLog)      ///< imu.log: recording and reading sensor logs
+Q_DECLARE_LOGGING_CATEGORY(imuSamples)  ///< imu.samples: per sample traces, see IMU_SAMPLE_DEBUG
+Q_DECLARE_LOGGING_CATEGORY(imuBias)     ///< imu.bias: accelerometer bias estimation
+
+namespace IMULogging{
+
+    /**
+     * @brief Sets the minimum time between two messages of the same IMU_SAMPLE_DEBUG site
+     *
+     * Defaults to the QML_IMU_SAMPLE_LOG_INTERVAL environment variable if set, 1000 otherwise.
+     *
+     * @param milliseconds Minimum milliseconds between two messages of one site, 0 logs every message
+     */
+    void setSampleInterval(int milliseconds);
+
+    /**
+     * @brief Gets the minimum time between two messages of the same IMU_SAMPLE_DEBUG site
+     *
+     * @return Minimum milliseconds between two messages of one site
+     */
+    int getSampleInterval();
+
+    /**
+     * @brief Lets one message through per sample interval, thread safe
+     */
+    class RateLimiter{
+
+    public:
+
+        /**
+         * @brief Creates a new limiter that lets the next message through
+         */
+        RateLimiter() : last(-1){}
+
+        /**
+         * @brief Gets whether a message may be logged now, and if so starts a new interval
+         *
+         * @return Whether a message may be logged now
+         */
+        bool ready();
+
+    private:
+
+        std::atomic<qint64> last;       ///< Time of the last message in milliseconds, -1 if none
+    };
+}
+
+/**
+ * @brief Debug stream for per sample code, e.g IMU_SAMPLE_DEBUG(imuSamples) << "Sample " << timestamp;
+ *
+ * Nothing is formatted unless the category is enabled for debug, and then at most one message per sample interval
+ * of IMULogging goes through for each site. When IMU_NO_SAMPLE_LOGGING is defined, as in release builds unless
+ * CONFIG += imu_sample_logging, the statement and its arguments are compiled out altogether.
+ */
+#ifdef IMU_NO_SAMPLE_LOGGING
+#define IMU_SAMPLE_DEBUG(category) \
+    while(false) QMessageLogger().noDebug()
+#else
+#define IMU_SAMPLE_DEBUG(category) \
+    if(!category().isDebugEnabled() || \
+            ![]() -> IMULogging::RateLimiter& { static IMULogging::RateLimiter limiter; return limiter; }().ready()){} \
+    else QMessageLogger(__FILE__, __LINE__, Q_FUNC_INFO, category().categoryName()).debug()
+#endif
+
+#endif /* IMULOGGING_H */
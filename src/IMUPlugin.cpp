@@ -26,10 +26,16 @@
 #include"IMUPlugin.h"
 
 #include"IMU.h"
+#include"IMUView.h"
+#include"IMUHistory.h"
+#include"IMUStats.h"
 #include"AccelerometerBiasEstimator.h"
 
 void IMUPlugin::registerTypes(const char* uri)
 {
     qmlRegisterType<IMU>(uri, 1, 0, "IMU");
+    qmlRegisterType<IMUView>(uri, 1, 0, "IMUView");
+    qmlRegisterType<IMUHistory>(uri, 1, 0, "IMUHistory");
+    qmlRegisterUncreatableType<IMUStats>(uri, 1, 0, "IMUStats", "IMUStats is only available as IMU.stats");
     qmlRegisterType<AccelerometerBiasEstimator>(uri, 1, 0, "AccelerometerBiasEstimator");
 }
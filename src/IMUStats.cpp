@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUStats.cpp
+ * @brief Implementation of the read-only QML view of the health and cost of the fusion
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"IMUStats.h"
+
+#include<cmath>
+
+IMUStats::IMUStats(QObject* parent) :
+    QObject(parent),
+    gyroRate(0),
+    accRate(0),
+    magRate(0),
+    gyroJitter(0),
+    accJitter(0),
+    magJitter(0),
+    gyroDropped(0),
+    accDropped(0),
+    magDropped(0),
+    gyroOutOfOrder(0),
+    accOutOfOrder(0),
+    magOutOfOrder(0),
+    predictTimeMean(0),
+    predictTimeMax(0),
+    correctTimeMean(0),
+    correctTimeMax(0),
+    innovationMean(0),
+    innovationMax(0),
+    gravityRejected(0),
+    magRejected(0),
+    rollbacks(0),
+    queueDepth(0)
+{}
+
+void IMUStats::update(IMUFusion::Statistics const& statistics, int queueDepth)
+{
+    gyroRate = rate(statistics.gyro);
+    accRate = rate(statistics.acc);
+    magRate = rate(statistics.mag);
+    gyroJitter = jitter(statistics.gyro);
+    accJitter = jitter(statistics.acc);
+    magJitter = jitter(statistics.mag);
+
+    gyroDropped += statistics.gyro.dropped;
+    accDropped += statistics.acc.dropped;
+    magDropped += statistics.mag.dropped;
+    gyroOutOfOrder += statistics.gyro.outOfOrder;
+    accOutOfOrder += statistics.acc.outOfOrder;
+    magOutOfOrder += statistics.mag.outOfOrder;
+
+    predictTimeMean = statistics.predictions > 0 ? statistics.predictTimeSum/statistics.predictions*1e6f : 0.0f;
+    predictTimeMax = statistics.predictTimeMax*1e6f;
+    correctTimeMean = statistics.corrections > 0 ? statistics.correctTimeSum/statistics.corrections*1e6f : 0.0f;
+    correctTimeMax = statistics.correctTimeMax*1e6f;
+    innovationMean = statistics.corrections > 0 ? statistics.innovationSum/statistics.corrections : 0.0f;
+    innovationMax = statistics.innovationMax;
+    gravityRejected += statistics.gravityRejected;
+    magRejected += statistics.magRejected;
+    rollbacks += statistics.rollbacks;
+
+    this->queueDepth = queueDepth;
+    emit updated();
+}
+
+qreal IMUStats::rate(IMUFusion::Statistics::Sensor const& sensor)
+{
+    return sensor.deltaTSum > 0 ? sensor.samples/sensor.deltaTSum : 0.0f;
+}
+
+qreal IMUStats::jitter(IMUFusion::Statistics::Sensor const& sensor)
+{
+    if(sensor.samples == 0)
+        return 0.0f;
+
+    qreal mean = sensor.deltaTSum/sensor.samples;
+    qreal variance = sensor.deltaTSquaredSum/sensor.samples - mean*mean;
+    return variance > 0 ? std::sqrt(variance)*1000.0f : 0.0f;
+}
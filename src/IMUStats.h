@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUStats.h
+ * @brief Read-only QML view of the health and cost of the fusion, updated at a low rate
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMUSTATS_H
+#define IMUSTATS_H
+
+#include<QObject>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief Health and cost statistics of the fusion of an IMU, exposed as its stats property
+ *
+ * The IMU updates all values at once every statsInterval milliseconds and emits updated(). Rates, jitters, step
+ * times, innovations and the queue depth are over the last interval; dropped, out of order, rejected and rolled back
+ * samples are counted since creation.
+ */
+class IMUStats : public QObject {
+Q_OBJECT
+    Q_DISABLE_COPY(IMUStats)
+    Q_PROPERTY(qreal gyroRate READ getGyroRate NOTIFY updated)
+    Q_PROPERTY(qreal accRate READ getAccRate NOTIFY updated)
+    Q_PROPERTY(qreal magRate READ getMagRate NOTIFY updated)
+    Q_PROPERTY(qreal gyroJitter READ getGyroJitter NOTIFY updated)
+    Q_PROPERTY(qreal accJitter READ getAccJitter NOTIFY updated)
+    Q_PROPERTY(qreal magJitter READ getMagJitter NOTIFY updated)
+    Q_PROPERTY(int gyroDropped READ getGyroDropped NOTIFY updated)
+    Q_PROPERTY(int accDropped READ getAccDropped NOTIFY updated)
+    Q_PROPERTY(int magDropped READ getMagDropped NOTIFY updated)
+    Q_PROPERTY(int gyroOutOfOrder READ getGyroOutOfOrder NOTIFY updated)
+    Q_PROPERTY(int accOutOfOrder READ getAccOutOfOrder NOTIFY updated)
+    Q_PROPERTY(int magOutOfOrder READ getMagOutOfOrder NOTIFY updated)
+    Q_PROPERTY(qreal predictTimeMean READ getPredictTimeMean NOTIFY updated)
+    Q_PROPERTY(qreal predictTimeMax READ getPredictTimeMax NOTIFY updated)
+    Q_PROPERTY(qreal correctTimeMean READ getCorrectTimeMean NOTIFY updated)
+    Q_PROPERTY(qreal correctTimeMax READ getCorrectTimeMax NOTIFY updated)
+    Q_PROPERTY(qreal innovationMean READ getInnovationMean NOTIFY updated)
+    Q_PROPERTY(qreal innovationMax READ getInnovationMax NOTIFY updated)
+    Q_PROPERTY(int gravityRejected READ getGravityRejected NOTIFY updated)
+    Q_PROPERTY(int magRejected READ getMagRejected NOTIFY updated)
+    Q_PROPERTY(int rollbacks READ getRollbacks NOTIFY updated)
+    Q_PROPERTY(int queueDepth READ getQueueDepth NOTIFY updated)
+
+public:
+
+    /**
+     * @brief Creates new empty statistics
+     *
+     * @param parent The QObject parent
+     */
+    IMUStats(QObject* parent = 0);
+
+    /**
+     * @brief Replaces the interval values and adds to the counts
+     *
+     * @param statistics Statistics of the fusion core over the last interval
+     * @param queueDepth Largest number of samples waiting for the fusion thread over the last interval
+     */
+    void update(IMUFusion::Statistics const& statistics, int queueDepth);
+
+    /**
+     * @brief Gets the gyroscope rate over the last interval in Hz, from sensor timestamps
+     *
+     * @return Gyroscope rate over the last interval in Hz, from sensor timestamps
+     */
+    qreal getGyroRate(){ return gyroRate; }
+
+    /**
+     * @brief Gets the accelerometer rate over the last interval in Hz, from sensor timestamps
+     *
+     * @return Accelerometer rate over the last interval in Hz, from sensor timestamps
+     */
+    qreal getAccRate(){ return accRate; }
+
+    /**
+     * @brief Gets the magnetometer rate over the last interval in Hz, from sensor timestamps
+     *
+     * @return Magnetometer rate over the last interval in Hz, from sensor timestamps
+     */
+    qreal getMagRate(){ return magRate; }
+
+    /**
+     * @brief Gets the standard deviation of gyroscope time slices over the last interval in ms
+     *
+     * @return Standard deviation of gyroscope time slices over the last interval in ms
+     */
+    qreal getGyroJitter(){ return gyroJitter; }
+
+    /**
+     * @brief Gets the standard deviation of accelerometer time slices over the last interval in ms
+     *
+     * @return Standard deviation of accelerometer time slices over the last interval in ms
+     */
+    qreal getAccJitter(){ return accJitter; }
+
+    /**
+     * @brief Gets the standard deviation of magnetometer time slices over the last interval in ms
+     *
+     * @return Standard deviation of magnetometer time slices over the last interval in ms
+     */
+    qreal getMagJitter(){ return magJitter; }
+
+    /**
+     * @brief Gets the number of gyroscope samples lost in timestamp gaps or to a full fusion queue, since creation
+     *
+     * @return Number of gyroscope samples lost in timestamp gaps or to a full fusion queue, since creation
+     */
+    int getGyroDropped(){ return gyroDropped; }
+
+    /**
+     * @brief Gets the number of accelerometer samples lost in timestamp gaps or to a full fusion queue, since creation
+     *
+     * @return Number of accelerometer samples lost in timestamp gaps or to a full fusion queue, since creation
+     */
+    int getAccDropped(){ return accDropped; }
+
+    /**
+     * @brief Gets the number of magnetometer samples lost in timestamp gaps or to a full fusion queue, since creation
+     *
+     * @return Number of magnetometer samples lost in timestamp gaps or to a full fusion queue, since creation
+     */
+    int getMagDropped(){ return magDropped; }
+
+    /**
+     * @brief Gets the number of gyroscope samples not newer than the previous one, since creation
+     *
+     * @return Number of gyroscope samples not newer than the previous one, since creation
+     */
+    int getGyroOutOfOrder(){ return gyroOutOfOrder; }
+
+    /**
+     * @brief Gets the number of accelerometer samples not newer than the previous one, since creation
+     *
+     * @return Number of accelerometer samples not newer than the previous one, since creation
+     */
+    int getAccOutOfOrder(){ return accOutOfOrder; }
+
+    /**
+     * @brief Gets the number of magnetometer samples not newer than the previous one, since creation
+     *
+     * @return Number of magnetometer samples not newer than the previous one, since creation
+     */
+    int getMagOutOfOrder(){ return magOutOfOrder; }
+
+    /**
+     * @brief Gets the mean prediction step time over the last interval in microseconds
+     *
+     * @return Mean prediction step time over the last interval in microseconds
+     */
+    qreal getPredictTimeMean(){ return predictTimeMean; }
+
+    /**
+     * @brief Gets the longest prediction step over the last interval in microseconds
+     *
+     * @return Longest prediction step over the last interval in microseconds
+     */
+    qreal getPredictTimeMax(){ return predictTimeMax; }
+
+    /**
+     * @brief Gets the mean correction step time over the last interval in microseconds
+     *
+     * @return Mean correction step time over the last interval in microseconds
+     */
+    qreal getCorrectTimeMean(){ return correctTimeMean; }
+
+    /**
+     * @brief Gets the longest correction step over the last interval in microseconds
+     *
+     * @return Longest correction step over the last interval in microseconds
+     */
+    qreal getCorrectTimeMax(){ return correctTimeMax; }
+
+    /**
+     * @brief Gets the mean innovation magnitude |z - h(x)| over the last interval
+     *
+     * @return Mean innovation magnitude |z - h(x)| over the last interval
+     */
+    qreal getInnovationMean(){ return innovationMean; }
+
+    /**
+     * @brief Gets the largest innovation magnitude over the last interval
+     *
+     * @return Largest innovation magnitude over the last interval
+     */
+    qreal getInnovationMax(){ return innovationMax; }
+
+    /**
+     * @brief Gets the number of corrections skipped because the gravity innovation was an outlier, since creation
+     *
+     * @return Number of corrections skipped because the gravity innovation was an outlier, since creation
+     */
+    int getGravityRejected(){ return gravityRejected; }
+
+    /**
+     * @brief Gets the number of magnetic vectors rejected as outliers, since creation
+     *
+     * @return Number of magnetic vectors rejected as outliers, since creation
+     */
+    int getMagRejected(){ return magRejected; }
+
+    /**
+     * @brief Gets the number of late samples fused by rolling back to an earlier state, since creation
+     *
+     * @return Number of late samples fused by rolling back to an earlier state, since creation
+     */
+    int getRollbacks(){ return rollbacks; }
+
+    /**
+     * @brief Gets the largest fusion thread queue depth over the last interval, 0 when not threaded
+     *
+     * @return Largest fusion thread queue depth over the last interval, 0 when not threaded
+     */
+    int getQueueDepth(){ return queueDepth; }
+
+signals:
+
+    /**
+     * @brief Emitted when all values are updated
+     */
+    void updated();
+
+private:
+
+    /**
+     * @brief Gets the mean rate of a sensor from its time slices
+     *
+     * @param sensor Statistics of the sensor
+     *
+     * @return Rate in Hz, 0 if there were no samples
+     */
+    static qreal rate(IMUFusion::Statistics::Sensor const& sensor);
+
+    /**
+     * @brief Gets the standard deviation of the time slices of a sensor
+     *
+     * @param sensor Statistics of the sensor
+     *
+     * @return Standard deviation in milliseconds, 0 if there were no samples
+     */
+    static qreal jitter(IMUFusion::Statistics::Sensor const& sensor);
+
+    qreal gyroRate;                 ///< Gyroscope rate over the last interval in Hz, from sensor timestamps
+    qreal accRate;                  ///< Accelerometer rate over the last interval in Hz, from sensor timestamps
+    qreal magRate;                  ///< Magnetometer rate over the last interval in Hz, from sensor timestamps
+    qreal gyroJitter;               ///< Standard deviation of gyroscope time slices over the last interval in ms
+    qreal accJitter;                ///< Standard deviation of accelerometer time slices over the last interval in ms
+    qreal magJitter;                ///< Standard deviation of magnetometer time slices over the last interval in ms
+    int gyroDropped;                ///< Gyroscope samples lost in timestamp gaps or to a full fusion queue, since creation
+    int accDropped;                 ///< Accelerometer samples lost in timestamp gaps or to a full fusion queue, since creation
+    int magDropped;                 ///< Magnetometer samples lost in timestamp gaps or to a full fusion queue, since creation
+    int gyroOutOfOrder;             ///< Gyroscope samples not newer than the previous one, since creation
+    int accOutOfOrder;              ///< Accelerometer samples not newer than the previous one, since creation
+    int magOutOfOrder;              ///< Magnetometer samples not newer than the previous one, since creation
+    qreal predictTimeMean;          ///< Mean prediction step time over the last interval in microseconds
+    qreal predictTimeMax;           ///< Longest prediction step over the last interval in microseconds
+    qreal correctTimeMean;          ///< Mean correction step time over the last interval in microseconds
+    qreal correctTimeMax;           ///< Longest correction step over the last interval in microseconds
+    qreal innovationMean;           ///< Mean innovation magnitude |z - h(x)| over the last interval
+    qreal innovationMax;            ///< Largest innovation magnitude over the last interval
+    int gravityRejected;            ///< Corrections skipped because the gravity innovation was an outlier, since creation
+    int magRejected;                ///< Magnetic vectors rejected as outliers, since creation
+    int rollbacks;                  ///< Late samples fused by rolling back to an earlier state, since creation
+    int queueDepth;                 ///< Largest fusion thread queue depth over the last interval, 0 when not threaded
+};
+
+#endif /* IMUSTATS_H */
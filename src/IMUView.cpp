@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUView.cpp
+ * @brief Implementation of the lightweight per target view of the fused state of an IMU
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"IMUView.h"
+
+IMUView::IMUView(QQuickItem* parent) :
+    QQuickItem(parent),
+    targetTranslation(0,0,0),
+    targetRotation(1,0,0,0),
+    targetFloorVector(0,0,1),
+    prevRotation(1,0,0,0),
+    origin(0,0,0)
+{
+}
+
+IMUView::~IMUView()
+{
+}
+
+void IMUView::setSource(IMU* source)
+{
+    if(this->source == source)
+        return;
+
+    if(this->source)
+        disconnect(this->source, nullptr, this, nullptr);
+    this->source = source;
+    if(source){
+        connect(source, SIGNAL(stateChanged()), this, SLOT(calculateOutput()));
+
+        //Initial pose is the one at the end of startup, like the displacement of the source
+        connect(source, SIGNAL(startupCompleteChanged()), this, SLOT(resetDisplacement()));
+    }
+
+    resetDisplacement();
+    calculateOutput();
+    emit sourceChanged();
+}
+
+QQuaternion IMUView::getCurrentRotation()
+{
+    IMUFusion::State const& state = source->getState();
+    return QQuaternion(state.rotation(0), state.rotation(1), state.rotation(2), state.rotation(3));
+}
+
+void IMUView::resetDisplacement()
+{
+    if(!source)
+        return;
+
+    IMUFusion::State const& state = source->getState();
+    prevRotation = getCurrentRotation();
+    origin = QVector3D(state.translation(0), state.translation(1), state.translation(2));
+}
+
+QVector3D IMUView::getLinearDisplacement()
+{
+    if(!source)
+        return QVector3D(0,0,0);
+
+    IMUFusion::State const& state = source->getState();
+    QVector3D dispTranslation = QVector3D(state.translation(0), state.translation(1), state.translation(2)) - origin;
+    return IMU::calculateLinearDisplacement(prevRotation, dispTranslation, getCurrentRotation(), targetTranslation, targetRotation);
+}
+
+QQuaternion IMUView::getAngularDisplacement()
+{
+    if(!source)
+        return QQuaternion(1,0,0,0);
+
+    return IMU::calculateAngularDisplacement(prevRotation, getCurrentRotation(), targetRotation);
+}
+
+void IMUView::calculateOutput()
+{
+    if(!source || !source->isStartupComplete())
+        return;
+
+    //Calculate floor vector in target frame
+    targetFloorVector = getCurrentRotation().conjugate().rotatedVector(QVector3D(0,0,1));
+    targetFloorVector = targetRotation.conjugate().rotatedVector(targetFloorVector);
+
+    emit stateChanged();
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file IMUView.h
+ * @brief Lightweight per target view of the fused state of an IMU
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef IMUVIEW_H
+#define IMUVIEW_H
+
+#include<QQuickItem>
+#include<QPointer>
+#include<QVector3D>
+#include<QQuaternion>
+
+#include"IMU.h"
+
+/**
+ * @brief Follows one target rigidly attached to the device of a source IMU, without any fusion of its own
+ *
+ * Any number of views can share one source IMU, each with its own target transform and its own displacement
+ * reference, so several targets cost a single sensor stream and a single filter.
+ */
+class IMUView : public QQuickItem {
+Q_OBJECT
+    Q_DISABLE_COPY(IMUView)
+    Q_PROPERTY(IMU* source READ getSource WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QVector3D targetTranslation MEMBER targetTranslation)
+    Q_PROPERTY(QQuaternion targetRotation MEMBER targetRotation)
+    Q_PROPERTY(QVector3D targetFloorVector READ getTargetFloorVector NOTIFY stateChanged)
+
+public:
+
+    /**
+     * @brief Creates a new view with the given QML parent
+     *
+     * @param parent The QML parent
+     */
+    IMUView(QQuickItem* parent = 0);
+
+    /**
+     * @brief Destroys this view
+     */
+    ~IMUView();
+
+    /**
+     * @brief Returns the source IMU
+     *
+     * @return Source IMU, nullptr if none
+     */
+    IMU* getSource(){ return source; }
+
+    /**
+     * @brief Sets the source IMU and resets the displacement to its current pose
+     *
+     * @param source New source IMU, nullptr to detach
+     */
+    void setSource(IMU* source);
+
+public slots:
+
+    /**
+     * @brief Sets the current pose of the source as the last pose for the displacement calculation of this view only
+     */
+    void resetDisplacement();
+
+    /**
+     * @brief Gets the position change of the target point since the last call to resetDisplacement()
+     *
+     * @return Position of current pose in the last pose frame
+     */
+    QVector3D getLinearDisplacement();
+
+    /**
+     * @brief Gets the rotation change of the target frame since the last call to resetDisplacement()
+     *
+     * @return Rotation of current pose in the last pose frame
+     */
+    QQuaternion getAngularDisplacement();
+
+    /**
+     * @brief Returns the latest floor vector
+     *
+     * @return Latest floor vector in the target frame
+     */
+    QVector3D getTargetFloorVector(){ return targetFloorVector; }
+
+signals:
+
+    /**
+     * @brief Emitted when the source IMU changes
+     */
+    void sourceChanged();
+
+    /**
+     * @brief Emitted when the outputs of this view change
+     */
+    void stateChanged();
+
+private slots:
+
+    /**
+     * @brief Calculates the outputs of this view from the latest state of the source
+     */
+    void calculateOutput();
+
+private:
+
+    /**
+     * @brief Gets the current rotation of the source
+     *
+     * @return Current rotation of the IMU frame in the global frame
+     */
+    QQuaternion getCurrentRotation();
+
+    QPointer<IMU> source;               ///< Source IMU that owns the sensors and the fusion
+
+    QVector3D targetTranslation;        ///< Translation of the target in local rigid body frame
+    QQuaternion targetRotation;         ///< Rotation of the target in local rigid body frame
+    QVector3D targetFloorVector;        ///< Floor vector in the target frame, i.e the local frame rotated by targetRotation
+
+    QQuaternion prevRotation;           ///< Rotation of the IMU frame at the last resetDisplacement()
+    QVector3D origin;                   ///< Cumulative translation of the source at the last resetDisplacement()
+};
+
+#endif /* IMUVIEW_H */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SPSCQueue.h
+ * @brief Bounded lock-free single producer single consumer queue
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include<atomic>
+#include<cstddef>
+
+/**
+ * @brief Bounded lock-free queue between exactly one producer thread and exactly one consumer thread
+ *
+ * push() must only be called from the producer and pop() must only be called from the consumer. Both are wait-free
+ * and never allocate; push() fails instead of blocking when the queue is full.
+ *
+ * @param T Element type, must be copy assignable
+ * @param CAPACITY Maximum number of elements in the queue, must be a power of 2
+ */
+template<typename T, std::size_t CAPACITY> class SPSCQueue{
+
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SPSCQueue capacity must be a power of 2");
+
+public:
+
+    /**
+     * @brief Creates a new empty queue
+     */
+    SPSCQueue() : head(0), tail(0){}
+
+    /**
+     * @brief Appends an element, producer only
+     *
+     * @param item Element to append
+     *
+     * @return Whether the element was appended, false if the queue is full
+     */
+    bool push(T const& item){
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+        buffer[t & (CAPACITY - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element, consumer only
+     *
+     * @param item Assigned the removed element
+     *
+     * @return Whether an element was removed, false if the queue is empty
+     */
+    bool pop(T& item){
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+            return false;
+        item = buffer[h & (CAPACITY - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Gets whether the queue is empty, exact only when called from the consumer
+     *
+     * @return Whether the queue is empty
+     */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Gets the number of elements in the queue, approximate while the other side is active
+     *
+     * @return Number of elements in the queue
+     */
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+
+    alignas(64) std::atomic<std::size_t> head;  ///< Index of the next element to pop, written by the consumer only
+    alignas(64) std::atomic<std::size_t> tail;  ///< Index of the next element to push, written by the producer only
+    alignas(64) T buffer[CAPACITY];             ///< Ring buffer, indices are taken modulo CAPACITY
+};
+
+#endif /* SPSCQUEUE_H */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SampleMerger.cpp
+ * @brief Implementation of the timestamp ordered merge of sensor streams
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"SampleMerger.h"
+
+#include<algorithm>
+
+SampleMerger::SampleMerger(unsigned int capacity, quint64 maxLag) :
+    capacity(capacity > 0 ? capacity : 1),
+    maxLag(maxLag),
+    newest(0)
+{
+    heap.reserve(this->capacity + 1); //Never allocates afterwards
+    for(int i = 0; i < NUM_TYPES; i++){
+        gating[i] = i != IMUFusion::Sample::MAGNETOMETER;
+        latest[i] = 0;
+    }
+}
+
+void SampleMerger::setGating(IMUFusion::Sample::Type type, bool gating)
+{
+    this->gating[type] = gating;
+    latest[type] = 0;
+}
+
+void SampleMerger::push(IMUFusion::Sample const& sample)
+{
+    if(sample.timestamp > latest[sample.type])
+        latest[sample.type] = sample.timestamp;
+    if(sample.timestamp > newest)
+        newest = sample.timestamp;
+    heap.push_back(sample);
+    std::push_heap(heap.begin(), heap.end(), Later());
+}
+
+bool SampleMerger::pop(IMUFusion::Sample& sample)
+{
+    if(heap.empty())
+        return false;
+
+    //Release the oldest sample only if no gating stream that is still delivering can send an older one
+    if(heap.size() <= capacity){
+        const quint64 oldest = heap.front().timestamp;
+        for(int i = 0; i < NUM_TYPES; i++)
+            if(gating[i] && latest[i] > 0 && latest[i] < oldest && latest[i] + maxLag >= newest)
+                return false;
+    }
+
+    std::pop_heap(heap.begin(), heap.end(), Later());
+    sample = heap.back();
+    heap.pop_back();
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SampleMerger.h
+ * @brief Merges the sample streams of several sensors into one stream ordered by timestamp
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef SAMPLEMERGER_H
+#define SAMPLEMERGER_H
+
+#include<vector>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief Reorders samples of independently delivered sensor streams by timestamp
+ *
+ * Samples are held in a min-heap and released only when every gating stream has delivered a sample at least as
+ * recent, so that a late batch from one sensor cannot be processed after newer samples of another sensor. Each
+ * stream is assumed to be in order by itself. Gating streams that did not deliver anything yet do not hold samples
+ * back, nor do gating streams that fell more than maxLag behind the most recent sample of any stream, e.g when a
+ * sensor stalls or is closed; the oldest samples are also released regardless once capacity samples are held.
+ */
+class SampleMerger{
+
+public:
+
+    /**
+     * @brief Creates a new empty merger where the gyroscope and the accelerometer streams are gating
+     *
+     * @param capacity Number of samples to hold at most before releasing regardless of the other streams
+     * @param maxLag How far in microseconds a gating stream may fall behind the most recent sample before it stops holding samples back
+     */
+    SampleMerger(unsigned int capacity = 512, quint64 maxLag = 500000);
+
+    /**
+     * @brief Sets whether samples wait for the given stream to catch up
+     *
+     * @param type Stream to set
+     * @param gating Whether samples wait for the stream to catch up, should be false when the sensor is not open; the
+     *               stream counts as not having delivered anything yet until its next sample, e.g after a sensor switch
+     */
+    void setGating(IMUFusion::Sample::Type type, bool gating);
+
+    /**
+     * @brief Adds a new sample
+     *
+     * @param sample New sample
+     */
+    void push(IMUFusion::Sample const& sample);
+
+    /**
+     * @brief Removes the oldest sample if it can be released
+     *
+     * @param sample Assigned the removed sample
+     *
+     * @return Whether a sample was removed
+     */
+    bool pop(IMUFusion::Sample& sample);
+
+    /**
+     * @brief Gets the number of held samples
+     *
+     * @return Number of held samples
+     */
+    unsigned int size() const { return heap.size(); }
+
+private:
+
+    static const int NUM_TYPES = 3;             ///< Number of sample types
+
+    /**
+     * @brief Heap comparator that puts the oldest sample on top
+     */
+    struct Later{
+        bool operator()(IMUFusion::Sample const& lhs, IMUFusion::Sample const& rhs) const {
+            return lhs.timestamp > rhs.timestamp;
+        }
+    };
+
+    unsigned int capacity;                      ///< Number of samples to hold at most
+    quint64 maxLag;                             ///< How far in microseconds a gating stream may fall behind newest
+    quint64 newest;                             ///< Most recent timestamp of any stream, 0 if none yet
+    std::vector<IMUFusion::Sample> heap;        ///< Held samples, oldest on top
+    bool gating[NUM_TYPES];                     ///< Whether samples wait for each stream
+    quint64 latest[NUM_TYPES];                  ///< Latest timestamp of each stream, 0 if none yet
+};
+
+#endif /* SAMPLEMERGER_H */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SensorHub.cpp
+ * @brief Implementation of the process-wide shared sensors
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"SensorHub.h"
+#include"IMULogging.h"
+
+#include<QTimer>
+#include<QtSensors/QGyroscope>
+#include<QtSensors/QAccelerometer>
+#include<QtSensors/QMagnetometer>
+
+QHash<QByteArray, QSensor*>& SensorHub::sensors()
+{
+    static QHash<QByteArray, QSensor*> sensors;
+    return sensors;
+}
+
+QHash<QSensor*, SensorHub::Entry>& SensorHub::entries()
+{
+    static QHash<QSensor*, Entry> entries;
+    return entries;
+}
+
+QList<QByteArray> const& SensorHub::identifiers(QByteArray const& type)
+{
+    static QHash<QByteArray, QList<QByteArray>> identifiers;
+    auto it = identifiers.find(type);
+    if(it == identifiers.end())
+        it = identifiers.insert(type, QSensor::sensorsForType(type));
+    return *it;
+}
+
+QSet<QByteArray>& SensorHub::failed()
+{
+    static QSet<QByteArray> failed;
+    return failed;
+}
+
+QSensor* SensorHub::create(QByteArray const& type)
+{
+    if(type == QGyroscope::type)
+        return new QGyroscope();
+    else if(type == QAccelerometer::type)
+        return new QAccelerometer();
+    else if(type == QMagnetometer::type){
+        QMagnetometer* mag = new QMagnetometer();
+        mag->setReturnGeoValues(true); //Try to cancel out magnetic interference
+        return mag;
+    }
+    return nullptr;
+}
+
+QSensor* SensorHub::acquire(QByteArray const& type, QByteArray const& identifier, QObject* consumer, int dataRate, int bufferSize)
+{
+    QByteArray key = type + '/' + identifier;
+    Request request = {dataRate, bufferSize};
+
+    //Already open, share it
+    QSensor* sensor = sensors().value(key, nullptr);
+    if(sensor){
+        Entry& entry = entries()[sensor];
+        entry.requests[consumer] = request;
+        apply(sensor, entry);
+        qCDebug(imuSensors) << "Sharing " << type << " with identifier " << identifier << " with " << entry.requests.size() << " consumers";
+        return sensor;
+    }
+
+    sensor = create(type);
+    if(!sensor){
+        qCWarning(imuSensors) << "Unknown sensor type " << type;
+        return nullptr;
+    }
+    sensor->setIdentifier(identifier);
+
+    //Sensor could not be opened for some reason
+    if(!sensor->connectToBackend()){
+        qCWarning(imuSensors) << "Could not open " << type << " with identifier " << identifier;
+        failed().insert(key);
+        delete sensor;
+        return nullptr;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.requests[consumer] = request;
+    apply(sensor, entry);
+    if(!sensor->start()){
+        qCWarning(imuSensors) << "Could not start " << type << " with identifier " << identifier;
+        failed().insert(key);
+        delete sensor;
+        return nullptr;
+    }
+
+    qCDebug(imuSensors) << "Opened " << type << " with identifier " << identifier;
+    sensors()[key] = sensor;
+    entries()[sensor] = entry;
+    return sensor;
+}
+
+void SensorHub::discover(QByteArray const& type, QObject* consumer, std::function<bool(QByteArray const&)> const& open)
+{
+    //Destroyed with the consumer, along with the connection
+    QTimer* timer = new QTimer(consumer);
+    timer->setSingleShot(true);
+    QObject::connect(timer, &QTimer::timeout, consumer, [type, timer, open](){
+        timer->deleteLater();
+        for(QByteArray const& identifier : identifiers(type))
+            if(!failed().contains(type + '/' + identifier) && open(identifier))
+                return;
+        qCDebug(imuSensors) << "No " << type << " could be opened";
+    });
+    timer->start(0);
+}
+
+bool SensorHub::isAvailable(QByteArray const& type, QByteArray const& identifier)
+{
+    return identifiers(type).contains(identifier) && !failed().contains(type + '/' + identifier);
+}
+
+void SensorHub::request(QSensor* sensor, QObject* consumer, int dataRate, int bufferSize)
+{
+    auto it = entries().find(sensor);
+    if(it == entries().end() || !it->requests.contains(consumer))
+        return;
+
+    Request request = {dataRate, bufferSize};
+    it->requests[consumer] = request;
+    apply(sensor, *it);
+}
+
+void SensorHub::release(QSensor* sensor, QObject* consumer)
+{
+    auto it = entries().find(sensor);
+    if(it == entries().end())
+        return;
+
+    QObject::disconnect(sensor, nullptr, consumer, nullptr);
+    it->requests.remove(consumer);
+
+    //Others may now be satisfied with less
+    if(!it->requests.isEmpty()){
+        apply(sensor, *it);
+        return;
+    }
+
+    qCDebug(imuSensors) << "Closing " << it->key;
+    sensors().remove(it->key);
+    entries().erase(it);
+    sensor->stop();
+    delete sensor;
+}
+
+void SensorHub::apply(QSensor* sensor, Entry const& entry)
+{
+    //Fastest consumer sets the rate, the most latency sensitive one the buffer size
+    int dataRate = 0;
+    int bufferSize = -1;
+    for(Request const& request : entry.requests){
+        dataRate = qMax(dataRate, request.dataRate);
+        int size = request.bufferSize > 0 ? request.bufferSize : sensor->efficientBufferSize();
+        bufferSize = bufferSize < 0 ? size : qMin(bufferSize, size);
+    }
+    bufferSize = qBound(1, bufferSize, qMax(1, sensor->maxBufferSize()));
+    if(dataRate == 0)
+        dataRate = sensor->dataRate();
+    if(dataRate == sensor->dataRate() && bufferSize == sensor->bufferSize())
+        return;
+
+    //Data rate and buffer size are only taken into account when the sensor starts
+    bool active = sensor->isActive();
+    if(active)
+        sensor->stop();
+    sensor->setDataRate(dataRate);
+    sensor->setBufferSize(bufferSize);
+    if(active)
+        sensor->start();
+    qCDebug(imuSensors) << "Data rate of " << entry.key << " is " << dataRate << ", buffer size is " << bufferSize;
+}
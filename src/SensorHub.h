@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SensorHub.h
+ * @brief Process-wide, reference counted sensors shared by all consumers of the same backend
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef SENSORHUB_H
+#define SENSORHUB_H
+
+#include<QByteArray>
+#include<QHash>
+#include<QList>
+#include<QObject>
+#include<QSet>
+#include<QtSensors/QSensor>
+
+#include<functional>
+
+/**
+ * @brief Opens every sensor backend once per process and hands the same sensor to all of its consumers
+ *
+ * Consumers connect to the readingChanged() signal of the sensor they acquire and read its reading as usual. A
+ * sensor runs at the highest data rate and the smallest buffer size requested by its consumers, and it is stopped
+ * and destroyed when its last consumer releases it. Identifiers are listed once per process and those that fail to
+ * open are remembered, so that only the first consumer of a type pays for probing the backends. GUI thread only,
+ * like the sensors themselves.
+ */
+class SensorHub{
+
+public:
+
+    /**
+     * @brief Acquires the sensor of the given type and identifier, opening and starting it if it is not open yet
+     *
+     * @param type Sensor type, e.g QGyroscope::type
+     * @param identifier Sensor identifier
+     * @param consumer Consumer of the sensor, its connections to the sensor are removed when it releases the sensor
+     * @param dataRate Data rate in Hz requested by the consumer, 0 if it has no preference
+     * @param bufferSize Buffer size requested by the consumer, 0 for the efficient buffer size of the sensor
+     *
+     * @return The shared sensor, nullptr if it could not be opened
+     */
+    static QSensor* acquire(QByteArray const& type, QByteArray const& identifier, QObject* consumer, int dataRate, int bufferSize);
+
+    /**
+     * @brief Acquires the sensor of the given class and identifier, see the untyped acquire()
+     *
+     * @tparam T QGyroscope, QAccelerometer or QMagnetometer
+     */
+    template<class T> static T* acquire(QByteArray const& identifier, QObject* consumer, int dataRate, int bufferSize)
+    {
+        return static_cast<T*>(acquire(T::type, identifier, consumer, dataRate, bufferSize));
+    }
+
+    /**
+     * @brief Opens the first sensor of the given type that can be opened, in a later event loop pass
+     *
+     * The caller returns right away, e.g QML component creation is not held up by the backends. Identifiers that
+     * failed to open before are skipped, so for later consumers this is a lookup of the already open sensor. Nothing
+     * is called if the consumer is destroyed meanwhile.
+     *
+     * @param type Sensor type, e.g QGyroscope::type
+     * @param consumer Consumer of the sensor, open is called in its context
+     * @param open Called with the candidate identifiers in order until it returns true, e.g opens the sensor with acquire()
+     */
+    static void discover(QByteArray const& type, QObject* consumer, std::function<bool(QByteArray const&)> const& open);
+
+    /**
+     * @brief Gets whether a sensor exists and did not fail to open before, without opening it
+     *
+     * @param type Sensor type, e.g QGyroscope::type
+     * @param identifier Sensor identifier
+     *
+     * @return Whether the sensor may be acquired
+     */
+    static bool isAvailable(QByteArray const& type, QByteArray const& identifier);
+
+    /**
+     * @brief Changes the data rate and buffer size requested by a consumer, restarting the sensor if they change
+     *
+     * @param sensor Sensor acquired by the consumer
+     * @param consumer Consumer of the sensor
+     * @param dataRate Data rate in Hz requested by the consumer, 0 if it has no preference
+     * @param bufferSize Buffer size requested by the consumer, 0 for the efficient buffer size of the sensor
+     */
+    static void request(QSensor* sensor, QObject* consumer, int dataRate, int bufferSize);
+
+    /**
+     * @brief Releases a sensor acquired by a consumer, the sensor is destroyed with its last consumer
+     *
+     * @param sensor Sensor acquired by the consumer, nothing is done if nullptr
+     * @param consumer Consumer of the sensor
+     */
+    static void release(QSensor* sensor, QObject* consumer);
+
+private:
+
+    /**
+     * @brief Data rate and buffer size requested by one consumer
+     */
+    struct Request{
+        int dataRate;               ///< Data rate in Hz, 0 if no preference
+        int bufferSize;             ///< Buffer size, 0 for the efficient buffer size
+    };
+
+    /**
+     * @brief One open sensor and its consumers
+     */
+    struct Entry{
+        QByteArray key;                         ///< Type and identifier
+        QHash<QObject*, Request> requests;      ///< Requests of the consumers
+    };
+
+    /**
+     * @brief Gets the open sensors, by type and identifier
+     *
+     * @return Open sensors
+     */
+    static QHash<QByteArray, QSensor*>& sensors();
+
+    /**
+     * @brief Gets the consumers of the open sensors
+     *
+     * @return Consumers of each open sensor
+     */
+    static QHash<QSensor*, Entry>& entries();
+
+    /**
+     * @brief Gets the identifiers of a sensor type, listed from the backends once per process
+     *
+     * @param type Sensor type
+     *
+     * @return Identifiers of the type in the order of the backends
+     */
+    static QList<QByteArray> const& identifiers(QByteArray const& type);
+
+    /**
+     * @brief Gets the sensors that could not be opened, not tried again
+     *
+     * @return Types and identifiers that failed
+     */
+    static QSet<QByteArray>& failed();
+
+    /**
+     * @brief Creates a sensor of the given type
+     *
+     * @param type Sensor type
+     *
+     * @return New sensor of the class of the type so that its reading can be cast, nullptr if the type is unknown
+     */
+    static QSensor* create(QByteArray const& type);
+
+    /**
+     * @brief Applies the highest requested data rate and the smallest requested buffer size, restarting the sensor if they change
+     *
+     * @param sensor Open sensor
+     * @param entry Consumers of the sensor
+     */
+    static void apply(QSensor* sensor, Entry const& entry);
+};
+
+#endif /* SENSORHUB_H */
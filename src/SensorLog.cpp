@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SensorLog.cpp
+ * @brief Implementation of the sensor log writer and reader
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"SensorLog.h"
+#include"IMULogging.h"
+
+#include<cstring>
+
+SensorLogWriter::SensorLogWriter(){}
+
+SensorLogWriter::~SensorLogWriter()
+{
+    close();
+}
+
+bool SensorLogWriter::open(QString const& fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+        qCWarning(imuLog) << "Could not open sensor log " << fileName << " for writing";
+        return false;
+    }
+
+    SensorLog::Header header;
+    std::memcpy(header.magic, SensorLog::MAGIC, sizeof(header.magic));
+    header.version = SensorLog::VERSION;
+    header.recordSize = sizeof(SensorLog::Record);
+    if(file.write((const char*)&header, sizeof(header)) != sizeof(header)){
+        qCWarning(imuLog) << "Could not write sensor log header to " << fileName;
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+void SensorLogWriter::close()
+{
+    if(file.isOpen())
+        file.close();
+}
+
+bool SensorLogWriter::write(IMUFusion::Sample const& sample)
+{
+    SensorLog::Record record;
+    record.timestamp = sample.timestamp;
+    record.x = sample.x;
+    record.y = sample.y;
+    record.z = sample.z;
+    record.type = sample.type;
+    return file.write((const char*)&record, sizeof(record)) == sizeof(record);
+}
+
+SensorLogReader::SensorLogReader() :
+    data(nullptr),
+    records(nullptr),
+    numRecords(0)
+{}
+
+SensorLogReader::~SensorLogReader()
+{
+    close();
+}
+
+bool SensorLogReader::open(QString const& fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        qCWarning(imuLog) << "Could not open sensor log " << fileName << " for reading";
+        return false;
+    }
+
+    qint64 fileSize = file.size();
+    if(fileSize < (qint64)sizeof(SensorLog::Header)){
+        qCWarning(imuLog) << "Sensor log " << fileName << " is too short to be a sensor log";
+        file.close();
+        return false;
+    }
+
+    data = file.map(0, fileSize);
+    if(data == nullptr){
+        qCWarning(imuLog) << "Could not map sensor log " << fileName;
+        file.close();
+        return false;
+    }
+
+    SensorLog::Header const* header = (SensorLog::Header const*)data;
+    if(std::memcmp(header->magic, SensorLog::MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != SensorLog::VERSION || header->recordSize != sizeof(SensorLog::Record)){
+        qCWarning(imuLog) << "Sensor log " << fileName << " is not a compatible sensor log";
+        close();
+        return false;
+    }
+
+    records = (SensorLog::Record const*)(data + sizeof(SensorLog::Header));
+    numRecords = (fileSize - sizeof(SensorLog::Header))/sizeof(SensorLog::Record);
+
+    //Records are used as they are, the log ends before the first one whose type is not a sensor
+    for(quint64 i = 0; i < numRecords; i++)
+        if(records[i].type > IMUFusion::Sample::MAGNETOMETER){
+            qCWarning(imuLog) << "Sensor log " << fileName << " has an invalid record at " << i << ", ignoring the rest";
+            numRecords = i;
+            break;
+        }
+    return true;
+}
+
+void SensorLogReader::close()
+{
+    if(data != nullptr)
+        file.unmap(data);
+    data = nullptr;
+    records = nullptr;
+    numRecords = 0;
+    if(file.isOpen())
+        file.close();
+}
+
+double SensorLogReader::duration() const
+{
+    quint64 first = 0, last = 0;
+    for(quint64 i = 0; i < numRecords; i++){
+        SensorLog::Record const& record = records[i];
+        if(record.type == IMUFusion::Sample::MAGNETOMETER)
+            continue;
+        if(first == 0 || record.timestamp < first)
+            first = record.timestamp;
+        if(record.timestamp > last)
+            last = record.timestamp;
+    }
+    return (last - first)*1e-6;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SensorLog.h
+ * @brief Compact append-only binary log of raw sensor samples and its memory mapped replay
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef SENSORLOG_H
+#define SENSORLOG_H
+
+#include<QFile>
+#include<QString>
+
+#include"IMUFusion.h"
+#include"FusionScheduler.h"
+#include"SampleMerger.h"
+
+/**
+ * @brief On-disk layout of sensor logs, in native byte order
+ *
+ * A log is a Header followed by Records in the order the readings were delivered, i.e before timestamp merging.
+ */
+namespace SensorLog{
+
+    static const char MAGIC[8] = {'Q', 'M', 'L', 'I', 'M', 'U', 'L', 'G'};  ///< Start of every log
+    static const quint32 VERSION = 1;                                       ///< Current format version
+
+    /**
+     * @brief File header
+     */
+    struct Header{
+        char magic[8];                  ///< Always MAGIC
+        quint32 version;                ///< Format version, VERSION
+        quint32 recordSize;             ///< sizeof(Record), to detect incompatible builds
+    };
+
+    /**
+     * @brief One raw sample, in Qt Sensors units
+     */
+    struct Record{
+        quint64 timestamp;              ///< Sensor timestamp in microseconds
+        float x;                        ///< Reading along x axis
+        float y;                        ///< Reading along y axis
+        float z;                        ///< Reading along z axis
+        quint32 type;                   ///< IMUFusion::Sample::Type
+    };
+
+    static_assert(sizeof(Header) == 16, "Unexpected sensor log header layout");
+    static_assert(sizeof(Record) == 24, "Unexpected sensor log record layout");
+}
+
+/**
+ * @brief Appends raw samples to a sensor log
+ */
+class SensorLogWriter{
+
+public:
+
+    /**
+     * @brief Creates a new writer that is not open
+     */
+    SensorLogWriter();
+
+    /**
+     * @brief Closes the log if open
+     */
+    ~SensorLogWriter();
+
+    /**
+     * @brief Creates or truncates a log and writes its header
+     *
+     * @param fileName Path of the log
+     *
+     * @return Whether the log could be opened
+     */
+    bool open(QString const& fileName);
+
+    /**
+     * @brief Flushes and closes the log
+     */
+    void close();
+
+    /**
+     * @brief Gets whether a log is open
+     *
+     * @return Whether a log is open
+     */
+    bool isOpen() const { return file.isOpen(); }
+
+    /**
+     * @brief Appends a sample
+     *
+     * @param sample New sample
+     *
+     * @return Whether the sample could be written
+     */
+    bool write(IMUFusion::Sample const& sample);
+
+private:
+
+    QFile file;                         ///< The log, buffered
+};
+
+/**
+ * @brief Reads a sensor log through a memory mapping
+ */
+class SensorLogReader{
+
+public:
+
+    /**
+     * @brief Creates a new reader that is not open
+     */
+    SensorLogReader();
+
+    /**
+     * @brief Closes the log if open
+     */
+    ~SensorLogReader();
+
+    /**
+     * @brief Maps a log into memory and validates its header and records
+     *
+     * The log is cut before the first record of an unknown type, so that at() only returns valid samples.
+     *
+     * @param fileName Path of the log
+     *
+     * @return Whether the log could be opened and is compatible
+     */
+    bool open(QString const& fileName);
+
+    /**
+     * @brief Unmaps and closes the log
+     */
+    void close();
+
+    /**
+     * @brief Gets the number of records in the log
+     *
+     * @return Number of records, trailing partial records and everything from the first invalid record on are ignored
+     */
+    quint64 size() const { return numRecords; }
+
+    /**
+     * @brief Gets the recorded duration, from the first to the last gyroscope or accelerometer timestamp
+     *
+     * @return Recorded duration in seconds, 0 if there are no such samples
+     */
+    double duration() const;
+
+    /**
+     * @brief Gets a sample from the log
+     *
+     * @param index Index of the record, less than size()
+     *
+     * @return Sample at the given index
+     */
+    IMUFusion::Sample at(quint64 index) const {
+        SensorLog::Record const& record = records[index];
+        IMUFusion::Sample sample;
+        sample.type = (IMUFusion::Sample::Type)record.type;
+        sample.timestamp = record.timestamp;
+        sample.x = record.x;
+        sample.y = record.y;
+        sample.z = record.z;
+        return sample;
+    }
+
+    /**
+     * @brief Drives a fusion core with the whole log, in the same order as the IMU item would
+     *
+     * Samples go through a SampleMerger and a FusionScheduler before the core, exactly like the live readings.
+     *
+     * @param fusion Fusion core to drive
+     * @param published Called as published(fusion) after every sample that changed the outputs
+     * @param merger Merger to use, should be empty; its leftover samples are processed at the end
+     */
+    template<typename Callback> void replay(IMUFusion& fusion, Callback published, SampleMerger& merger) const {
+        FusionScheduler scheduler;
+        IMUFusion::Sample sample;
+        for(quint64 i = 0; i < numRecords; i++){
+            merger.push(at(i));
+            while(merger.pop(sample))
+                if(scheduler.process(fusion, sample))
+                    published(fusion);
+        }
+
+        //End of log, nothing can arrive later
+        merger.setGating(IMUFusion::Sample::GYROSCOPE, false);
+        merger.setGating(IMUFusion::Sample::ACCELEROMETER, false);
+        while(merger.pop(sample))
+            if(scheduler.process(fusion, sample))
+                published(fusion);
+    }
+
+    /**
+     * @brief Drives a fusion core with the whole log using a default merger, see replay(fusion, published, merger)
+     *
+     * @param fusion Fusion core to drive
+     * @param published Called as published(fusion) after every sample that changed the outputs
+     */
+    template<typename Callback> void replay(IMUFusion& fusion, Callback published) const {
+        SampleMerger merger;
+        replay(fusion, published, merger);
+    }
+
+private:
+
+    QFile file;                             ///< The log
+    uchar* data;                            ///< Mapping of the whole log, nullptr when not open
+    SensorLog::Record const* records;       ///< First record in the mapping
+    quint64 numRecords;                     ///< Number of complete records
+};
+
+#endif /* SENSORLOG_H */
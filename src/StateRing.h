@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file StateRing.h
+ * @brief Lock-free ring of the latest fused states, written by one thread and read in place by any number of others
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef STATERING_H
+#define STATERING_H
+
+#include<QtGlobal>
+
+#include<atomic>
+#include<cstddef>
+#include<iterator>
+#include<vector>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief Fused state after one sample, in a fixed layout
+ */
+struct StateRecord{
+    quint64 timestamp;              ///< Timestamp of the latest gyroscope or accelerometer sample in microseconds
+    qreal rotation[4];              ///< Rotation of the IMU frame w.r.t ground inertial frame, in w, x, y, z order
+    qreal linearAcceleration[3];    ///< Linear acceleration w.r.t ground inertial frame in m/s^2
+    qreal dispTranslation[3];       ///< Translation of the IMU frame in the global frame since the last displacement reset
+};
+
+/**
+ * @brief Keeps the latest fused states, overwriting the oldest ones, for consumers that want the full rate stream
+ *
+ * record() must only be called from one thread at a time, the one that drives the fusion core. Any number of
+ * consumers on other threads keep their own cursor, a sequence number, and get everything recorded since it with
+ * since(), in place and without locking. A consumer that falls behind by more than the capacity loses the oldest
+ * records; since the producer never waits, a record may also be overwritten while it is being read, which
+ * oldest() tells after the fact:
+ *
+ * @code
+ * StateRing::Span span = ring.since(cursor);
+ * for(StateRecord const& record : span)
+ *     plot(record);
+ * quint64 valid = ring.oldest(); //Records of span before valid may be torn
+ * cursor = span.sequence() + span.size();
+ * @endcode
+ *
+ * Neither side allocates after construction.
+ *
+ * Torn records are detected, not prevented: consumers read the records with plain loads while the producer may be
+ * storing to them, which the C++ memory model calls a data race and ThreadSanitizer reports. This is a deliberate
+ * benign race, a seqlock without atomic copies so that spans stay in place. It relies on the loads of a span not being
+ * moved after the acquire fence in oldest(), which pairs with the release fence that record() issues before reusing a
+ * slot, so that every record that may have raced is behind oldest() and discarded unused. Both fences are needed as
+ * they are; making the reads defined means copying the records out through relaxed atomics instead.
+ */
+class StateRing{
+
+public:
+
+    /**
+     * @brief Records of a ring from a sequence number to the newest, as at most two contiguous runs
+     */
+    class Span{
+
+    public:
+
+        /**
+         * @brief Iterates over the records of a span, oldest first
+         */
+        class const_iterator : public std::iterator<std::forward_iterator_tag, StateRecord const>{
+
+        public:
+
+            const_iterator(Span const* span, std::size_t index) : span(span), index(index){}
+            StateRecord const& operator*() const { return span->at(index); }
+            StateRecord const* operator->() const { return &span->at(index); }
+            const_iterator& operator++(){ index++; return *this; }
+            const_iterator operator++(int){ const_iterator it = *this; index++; return it; }
+            bool operator==(const_iterator const& other) const { return index == other.index; }
+            bool operator!=(const_iterator const& other) const { return index != other.index; }
+
+        private:
+
+            Span const* span;       ///< Span iterated over
+            std::size_t index;      ///< Index of the current record in the span
+        };
+
+        /**
+         * @brief Creates an empty span
+         */
+        Span() : first(0){
+            runs[0] = runs[1] = nullptr;
+            sizes[0] = sizes[1] = 0;
+        }
+
+        /**
+         * @brief Gets the sequence number of the first record of the span
+         *
+         * @return Sequence number of the first record, the one after the span is sequence() + size()
+         */
+        quint64 sequence() const { return first; }
+
+        /**
+         * @brief Gets the number of records in the span
+         *
+         * @return Number of records
+         */
+        std::size_t size() const { return sizes[0] + sizes[1]; }
+
+        /**
+         * @brief Gets a record of the span
+         *
+         * @param index Index of the record, oldest first, less than size()
+         *
+         * @return Record, in the ring
+         */
+        StateRecord const& at(std::size_t index) const { return index < sizes[0] ? runs[0][index] : runs[1][index - sizes[0]]; }
+
+        /**
+         * @brief Gets one of the contiguous runs of the span, e.g to copy them in bulk
+         *
+         * @param i 0 for the older run, 1 for the newer run that starts at the beginning of the ring
+         *
+         * @return First record of the run, nullptr if the run is empty
+         */
+        StateRecord const* run(int i) const { return runs[i]; }
+
+        /**
+         * @brief Gets the number of records in one of the contiguous runs of the span
+         *
+         * @param i 0 for the older run, 1 for the newer run
+         *
+         * @return Number of records in the run
+         */
+        std::size_t runSize(int i) const { return sizes[i]; }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+
+    private:
+
+        friend class StateRing;
+
+        quint64 first;                  ///< Sequence number of the first record
+        StateRecord const* runs[2];     ///< Contiguous runs, older first
+        std::size_t sizes[2];           ///< Number of records in each run
+    };
+
+    /**
+     * @brief Creates a new empty ring
+     *
+     * @param capacity Number of the latest records to keep, must be a power of 2
+     */
+    explicit StateRing(std::size_t capacity = 4096) :
+        records(capacity),
+        mask(capacity - 1),
+        written(0),
+        valid(0)
+    {
+        Q_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    /**
+     * @brief Appends the state of a fusion core, overwriting the oldest record if full, producer only
+     *
+     * @param state Latest snapshot of the fusion core
+     */
+    void record(IMUFusion::State const& state){
+        const quint64 n = written.load(std::memory_order_relaxed);
+
+        //Tell the consumers before the slot changes, pairs with the fence in oldest()
+        if(n + 1 > records.size()){
+            valid.store(n + 1 - records.size(), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        StateRecord& record = records[n & mask];
+        record.timestamp = state.timestamp;
+        for(int i = 0; i < 4; i++)
+            record.rotation[i] = state.rotation(i);
+        for(int i = 0; i < 3; i++){
+            record.linearAcceleration[i] = state.linearAcceleration(i);
+            record.dispTranslation[i] = state.dispTranslation(i);
+        }
+        written.store(n + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Gets the records from a sequence number to the newest, in place
+     *
+     * @param sequence Sequence number of the first record wanted, records that are no longer kept are skipped
+     *
+     * @return Records from sequence, or from the oldest kept one, to the newest
+     */
+    Span since(quint64 sequence) const {
+        Span span;
+        const quint64 end = written.load(std::memory_order_acquire);
+        const quint64 kept = end > records.size() ? end - records.size() : 0;
+        span.first = qMax(sequence, kept);
+        if(span.first >= end){
+            span.first = end;
+            return span;
+        }
+
+        const std::size_t begin = span.first & mask;
+        const std::size_t count = end - span.first;
+        span.runs[0] = &records[begin];
+        span.sizes[0] = qMin(count, records.size() - begin);
+        span.sizes[1] = count - span.sizes[0];
+        span.runs[1] = span.sizes[1] > 0 ? &records[0] : nullptr;
+        return span;
+    }
+
+    /**
+     * @brief Gets the sequence number of the oldest record that was not overwritten, to be called after reading a span
+     *
+     * @return Records before this one may have been overwritten while they were read and must be discarded
+     */
+    quint64 oldest() const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return valid.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the sequence number of the next record
+     *
+     * @return Number of records recorded so far
+     */
+    quint64 sequence() const { return written.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Gets the number of records kept at most
+     *
+     * @return Capacity of the ring
+     */
+    std::size_t capacity() const { return records.size(); }
+
+private:
+
+    std::vector<StateRecord> records;           ///< Ring buffer, the record with sequence number n at n & mask
+    const std::size_t mask;                     ///< Capacity minus 1
+    alignas(64) std::atomic<quint64> written;   ///< Sequence number of the next record, written by the producer only
+    alignas(64) std::atomic<quint64> valid;     ///< Sequence number of the oldest record not being overwritten, written by the producer only
+};
+
+#endif /* STATERING_H */
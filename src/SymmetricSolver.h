@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file SymmetricSolver.h
+ * @brief In-place solvers for symmetric linear systems such as the Kalman innovation covariance
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef SYMMETRICSOLVER_H
+#define SYMMETRICSOLVER_H
+
+#include<algorithm>
+#include<cmath>
+#include<limits>
+
+namespace SymmetricSolver{
+
+/**
+ * @brief Decomposition used to solve S*X = B for symmetric S
+ */
+enum Method{
+    CHOLESKY,   ///< S = L*Lt, fastest, requires S positive definite
+    LDLT,       ///< S = L*D*Lt, no square roots, tolerates indefinite S as long as no pivot vanishes
+    SVD         ///< Delegated to cv::solve(..., cv::DECOMP_SVD), slowest and allocates
+};
+
+/**
+ * @brief Solves S*X = B with Cholesky decomposition, in place
+ *
+ * @param S Row-major n x n symmetric matrix, overwritten by its factor
+ * @param n Dimension of S
+ * @param B Row-major n x m right hand side, overwritten by the solution X on success
+ * @param m Number of columns of B
+ *
+ * @return Whether S was found to be positive definite; B is left in an unspecified state otherwise
+ */
+template<typename T> bool cholesky(T* S, int n, T* B, int m)
+{
+    //Factor S = L*Lt, L is stored in the lower triangle of S
+    for(int j = 0; j < n; j++){
+        T* Sj = S + j*n;
+        T d = Sj[j];
+        for(int k = 0; k < j; k++)
+            d -= Sj[k]*Sj[k];
+        if(!(d > 0)) //Also catches nans
+            return false;
+        d = std::sqrt(d);
+        Sj[j] = d;
+        for(int i = j + 1; i < n; i++){
+            T* Si = S + i*n;
+            T s = Si[j];
+            for(int k = 0; k < j; k++)
+                s -= Si[k]*Sj[k];
+            Si[j] = s/d;
+        }
+    }
+
+    //Forward substitution L*Y = B
+    for(int i = 0; i < n; i++){
+        T const* Si = S + i*n;
+        T* Bi = B + i*m;
+        for(int k = 0; k < i; k++){
+            T const* Bk = B + k*m;
+            for(int c = 0; c < m; c++)
+                Bi[c] -= Si[k]*Bk[c];
+        }
+        for(int c = 0; c < m; c++)
+            Bi[c] /= Si[i];
+    }
+
+    //Back substitution Lt*X = Y
+    for(int i = n - 1; i >= 0; i--){
+        T* Bi = B + i*m;
+        for(int k = i + 1; k < n; k++){
+            T const* Bk = B + k*m;
+            T l = S[k*n + i];
+            for(int c = 0; c < m; c++)
+                Bi[c] -= l*Bk[c];
+        }
+        for(int c = 0; c < m; c++)
+            Bi[c] /= S[i*n + i];
+    }
+    return true;
+}
+
+/**
+ * @brief Solves S*X = B with LDLt decomposition, in place
+ *
+ * @param S Row-major n x n symmetric matrix, overwritten by its factors (unit L below, D on the diagonal)
+ * @param n Dimension of S
+ * @param B Row-major n x m right hand side, overwritten by the solution X on success
+ * @param m Number of columns of B
+ *
+ * @return Whether all pivots were significantly nonzero; B is left in an unspecified state otherwise
+ */
+template<typename T> bool ldlt(T* S, int n, T* B, int m)
+{
+    T scale = 0;
+    for(int i = 0; i < n; i++)
+        scale = std::max(scale, std::abs(S[i*n + i]));
+    const T tolerance = scale*n*std::numeric_limits<T>::epsilon();
+
+    //Factor S = L*D*Lt, S(j,k < j) temporarily holds L(j,k)*D(k) while row j is processed
+    for(int j = 0; j < n; j++){
+        T* Sj = S + j*n;
+        T d = Sj[j];
+        for(int k = 0; k < j; k++){
+            T ljk = Sj[k]/S[k*n + k];
+            d -= ljk*Sj[k];
+        }
+        if(!(std::abs(d) > tolerance))
+            return false;
+        Sj[j] = d;
+        for(int i = j + 1; i < n; i++){
+            T* Si = S + i*n;
+            T s = Si[j];
+            for(int k = 0; k < j; k++)
+                s -= Si[k]*Sj[k]/S[k*n + k];
+            Si[j] = s;
+        }
+        for(int k = 0; k < j; k++)
+            Sj[k] /= S[k*n + k];
+    }
+
+    //Forward substitution L*Y = B
+    for(int i = 0; i < n; i++){
+        T const* Si = S + i*n;
+        T* Bi = B + i*m;
+        for(int k = 0; k < i; k++){
+            T const* Bk = B + k*m;
+            for(int c = 0; c < m; c++)
+                Bi[c] -= Si[k]*Bk[c];
+        }
+    }
+
+    //Diagonal D*Z = Y
+    for(int i = 0; i < n; i++){
+        T* Bi = B + i*m;
+        for(int c = 0; c < m; c++)
+            Bi[c] /= S[i*n + i];
+    }
+
+    //Back substitution Lt*X = Z
+    for(int i = n - 1; i >= 0; i--){
+        T* Bi = B + i*m;
+        for(int k = i + 1; k < n; k++){
+            T const* Bk = B + k*m;
+            T l = S[k*n + i];
+            for(int c = 0; c < m; c++)
+                Bi[c] -= l*Bk[c];
+        }
+    }
+    return true;
+}
+
+} //namespace SymmetricSolver
+
+#endif /* SYMMETRICSOLVER_H */
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file TrajectoryLog.cpp
+ * @brief Implementation of the trajectory log writer and reader
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"TrajectoryLog.h"
+#include"IMULogging.h"
+
+#include<cstring>
+
+//Appends the zigzag varint of a difference
+static void encode(std::vector<char>& out, qint64 delta)
+{
+    quint64 zigzag = ((quint64)delta << 1) ^ (quint64)(delta >> 63);
+    while(zigzag >= 0x80){
+        out.push_back((char)(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    out.push_back((char)zigzag);
+}
+
+//Reads a zigzag varint difference, returns false if the data ends first
+static bool decode(char const*& in, char const* end, qint64& delta)
+{
+    quint64 zigzag = 0;
+    for(int shift = 0; shift < 64; shift += 7){
+        if(in == end)
+            return false;
+        uchar byte = (uchar)*in++;
+        zigzag |= (quint64)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)){
+            delta = (qint64)(zigzag >> 1) ^ -(qint64)(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+//Bit pattern of a float as a signed integer, close floats of the same sign having close patterns
+static qint32 floatBits(float value)
+{
+    qint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(qint32 bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//Value of a record in the given float column, in Record order
+static float& column(TrajectoryLog::Record& record, unsigned int c)
+{
+    if(c < 4)
+        return record.rotation[c];
+    else if(c < 7)
+        return record.linearAcceleration[c - 4];
+    else if(c < 10)
+        return record.velocity[c - 7];
+    else
+        return record.dispTranslation[c - 10];
+}
+
+TrajectoryLogWriter::TrajectoryLogWriter() :
+    compressed(true),
+    chunkSize(0),
+    lossless(false),
+    current(nullptr),
+    droppedRecords(0),
+    failed(false),
+    running(false)
+{}
+
+TrajectoryLogWriter::~TrajectoryLogWriter()
+{
+    close();
+}
+
+bool TrajectoryLogWriter::open(QString const& fileName, bool compressed, unsigned int chunkSize, bool lossless)
+{
+    close();
+
+    this->fileName = fileName;
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+        qCWarning(imuLog) << "Could not open trajectory log " << fileName << " for writing";
+        return false;
+    }
+
+    TrajectoryLog::Header header;
+    std::memcpy(header.magic, TrajectoryLog::MAGIC, sizeof(header.magic));
+    header.version = TrajectoryLog::VERSION;
+    header.numColumns = TrajectoryLog::NUM_COLUMNS;
+    if(file.write((const char*)&header, sizeof(header)) != sizeof(header)){
+        qCWarning(imuLog) << "Could not write trajectory log header to " << fileName;
+        file.close();
+        return false;
+    }
+
+    //Whole pool up front, then nothing is allocated on the calling thread
+    this->compressed = compressed;
+    this->chunkSize = qMax(1u, chunkSize);
+    this->lossless = lossless;
+    chunks.resize(NUM_CHUNKS);
+    for(Chunk& chunk : chunks){
+        chunk.size = 0;
+        chunk.timestamps.resize(this->chunkSize);
+        chunk.columns.resize(this->chunkSize*TrajectoryLog::NUM_COLUMNS);
+    }
+    current = &chunks[0];
+    for(unsigned int i = 1; i < NUM_CHUNKS; i++)
+        spare.push(&chunks[i]);
+    payload.reserve(this->chunkSize*(10 + 5*TrajectoryLog::NUM_COLUMNS));
+    droppedRecords = 0;
+    failed = false;
+
+    running = true;
+    thread = std::thread(&TrajectoryLogWriter::run, this);
+    return true;
+}
+
+void TrajectoryLogWriter::close()
+{
+    if(!isOpen())
+        return;
+
+    //Partial chunk goes last, there is always room for every chunk of the pool
+    if(current && current->size > 0)
+        full.push(current);
+    current = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+        wakeCondition.notify_one();
+    }
+    thread.join();
+
+    Chunk* chunk;
+    while(spare.pop(chunk));
+    chunks.clear();
+    file.close();
+    if(droppedRecords > 0)
+        qCWarning(imuLog) << "Dropped " << droppedRecords << " states from trajectory log " << fileName;
+}
+
+void TrajectoryLogWriter::write(IMUFusion::State const& state)
+{
+    if(!current && !spare.pop(current)){
+        if(!lossless){
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        spareCondition.wait(lock, [this]{ return spare.pop(current); });
+    }
+
+    const unsigned int i = current->size;
+    current->timestamps[i] = state.timestamp;
+    float* column = &current->columns[i];
+    for(int j = 0; j < 4; j++, column += chunkSize)
+        *column = state.rotation(j);
+    for(int j = 0; j < 3; j++, column += chunkSize)
+        *column = state.linearAcceleration(j);
+    for(int j = 0; j < 3; j++, column += chunkSize)
+        *column = state.velocity(j);
+    for(int j = 0; j < 3; j++, column += chunkSize)
+        *column = state.dispTranslation(j);
+
+    if(++current->size < chunkSize)
+        return;
+    full.push(current);
+    current = nullptr;
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wakeCondition.notify_one();
+}
+
+void TrajectoryLogWriter::run()
+{
+    Chunk* chunk;
+    while(true){
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [this]{ return !full.empty() || !running.load(); });
+        }
+
+        //Stopping only once every full chunk is written
+        if(!full.pop(chunk)){
+            if(!running.load())
+                return;
+            continue;
+        }
+        if(!failed && !writeChunk(*chunk)){
+            qCWarning(imuLog) << "Could not write to trajectory log " << fileName << ", dropping further states";
+            failed = true;
+        }
+        if(failed)
+            droppedRecords.fetch_add(chunk->size, std::memory_order_relaxed);
+        chunk->size = 0;
+        spare.push(chunk);
+        if(lossless){
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            spareCondition.notify_one();
+        }
+    }
+}
+
+bool TrajectoryLogWriter::writeChunk(Chunk const& chunk)
+{
+    //Columns one after the other, each value as its difference to the previous one
+    payload.clear();
+    quint64 prevTimestamp = 0;
+    for(unsigned int i = 0; i < chunk.size; i++){
+        encode(payload, (qint64)(chunk.timestamps[i] - prevTimestamp));
+        prevTimestamp = chunk.timestamps[i];
+    }
+    for(unsigned int c = 0; c < TrajectoryLog::NUM_COLUMNS; c++){
+        float const* column = &chunk.columns[c*chunkSize];
+        qint64 prev = 0;
+        for(unsigned int i = 0; i < chunk.size; i++){
+            qint64 bits = floatBits(column[i]);
+            encode(payload, bits - prev);
+            prev = bits;
+        }
+    }
+
+    QByteArray compressedPayload;
+    TrajectoryLog::ChunkHeader header;
+    header.numRecords = chunk.size;
+    header.flags = 0;
+    header.rawSize = payload.size();
+    char const* data = payload.data();
+    header.payloadSize = payload.size();
+    if(compressed){
+        compressedPayload = qCompress((uchar const*)payload.data(), payload.size());
+        header.flags = TrajectoryLog::COMPRESSED;
+        data = compressedPayload.constData();
+        header.payloadSize = compressedPayload.size();
+    }
+
+    return file.write((const char*)&header, sizeof(header)) == sizeof(header) &&
+        file.write(data, header.payloadSize) == (qint64)header.payloadSize && file.flush();
+}
+
+TrajectoryLogReader::TrajectoryLogReader(){}
+
+bool TrajectoryLogReader::open(QString const& fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        qCWarning(imuLog) << "Could not open trajectory log " << fileName << " for reading";
+        return false;
+    }
+
+    TrajectoryLog::Header header;
+    if(file.read((char*)&header, sizeof(header)) != sizeof(header) ||
+            std::memcmp(header.magic, TrajectoryLog::MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != TrajectoryLog::VERSION || header.numColumns != TrajectoryLog::NUM_COLUMNS){
+        qCWarning(imuLog) << "Trajectory log " << fileName << " is not a compatible trajectory log";
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+void TrajectoryLogReader::close()
+{
+    if(file.isOpen())
+        file.close();
+}
+
+bool TrajectoryLogReader::readChunk(std::vector<TrajectoryLog::Record>& records)
+{
+    records.clear();
+    TrajectoryLog::ChunkHeader header;
+    if(!file.isOpen() || file.read((char*)&header, sizeof(header)) != sizeof(header))
+        return false;
+
+    //Every record takes at least one byte per column and the timestamp, nothing is allocated for a corrupt count
+    if(header.numRecords > header.rawSize/(1 + TrajectoryLog::NUM_COLUMNS) || header.payloadSize > file.size() - file.pos())
+        return false;
+    QByteArray payload = file.read(header.payloadSize);
+    if(payload.size() != (int)header.payloadSize)
+        return false;
+    if(header.flags & TrajectoryLog::COMPRESSED)
+        payload = qUncompress(payload);
+    if(payload.size() != (int)header.rawSize)
+        return false;
+
+    records.resize(header.numRecords);
+    char const* in = payload.constData();
+    char const* end = in + payload.size();
+    qint64 delta;
+    quint64 timestamp = 0;
+    for(TrajectoryLog::Record& record : records){
+        if(!decode(in, end, delta))
+            return false;
+        timestamp += delta;
+        record.timestamp = timestamp;
+    }
+
+    for(unsigned int c = 0; c < TrajectoryLog::NUM_COLUMNS; c++){
+        qint64 bits = 0;
+        for(TrajectoryLog::Record& record : records){
+            if(!decode(in, end, delta))
+                return false;
+            bits += delta;
+            column(record, c) = bitsFloat((qint32)bits);
+        }
+    }
+    return in == end;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file TrajectoryLog.h
+ * @brief Chunked, columnar, delta encoded logs of fused trajectories, written on a thread of their own
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef TRAJECTORYLOG_H
+#define TRAJECTORYLOG_H
+
+#include<QByteArray>
+#include<QFile>
+#include<QString>
+
+#include<atomic>
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include"IMUFusion.h"
+#include"SPSCQueue.h"
+
+/**
+ * @brief On-disk layout of trajectory logs, in native byte order
+ *
+ * A log is a Header followed by chunks, each a ChunkHeader and its payload. The payload holds the columns of the
+ * chunk's records one after the other: the timestamps, then each of the NUM_COLUMNS float columns in Record order.
+ * Every value is stored as the zigzag varint of its difference to the previous value of its column in the chunk,
+ * the first one to zero, floats being differenced as their bit patterns; successive states are close, so most
+ * differences take one or two bytes instead of four or eight. Chunks decode on their own, and a log cut short by
+ * a crash loses its last chunk only.
+ */
+namespace TrajectoryLog{
+
+    static const char MAGIC[8] = {'Q', 'M', 'L', 'I', 'M', 'U', 'T', 'J'};  ///< Start of every log
+    static const quint32 VERSION = 1;                                       ///< Current format version
+    static const quint32 NUM_COLUMNS = 13;                                  ///< Float columns, see Record
+    static const quint32 COMPRESSED = 1;                                    ///< ChunkHeader flag, payload is compressed with qCompress()
+
+    /**
+     * @brief File header
+     */
+    struct Header{
+        char magic[8];                  ///< Always MAGIC
+        quint32 version;                ///< Format version, VERSION
+        quint32 numColumns;             ///< NUM_COLUMNS, to detect incompatible builds
+    };
+
+    /**
+     * @brief Header of one chunk
+     */
+    struct ChunkHeader{
+        quint32 numRecords;             ///< Number of records in the chunk
+        quint32 flags;                  ///< COMPRESSED or 0
+        quint32 payloadSize;            ///< Size of the payload in the file in bytes
+        quint32 rawSize;                ///< Size of the payload before compression in bytes
+    };
+
+    /**
+     * @brief One fused state, decoded
+     */
+    struct Record{
+        quint64 timestamp;              ///< Timestamp of the latest gyroscope or accelerometer sample in microseconds
+        float rotation[4];              ///< Rotation of the IMU frame w.r.t ground inertial frame, in w, x, y, z order
+        float linearAcceleration[3];    ///< Linear acceleration w.r.t ground inertial frame in m/s^2
+        float velocity[3];              ///< Estimated linear velocity in the global frame in m/s
+        float dispTranslation[3];       ///< Translation of the IMU frame in the global frame since the last displacement reset
+    };
+
+    static_assert(sizeof(Header) == 16, "Unexpected trajectory log header layout");
+    static_assert(sizeof(ChunkHeader) == 16, "Unexpected trajectory log chunk header layout");
+}
+
+/**
+ * @brief Streams fused states to a trajectory log without doing any encoding or I/O on the calling thread
+ *
+ * write() only copies the state into the columns of the current chunk. Full chunks are handed to a thread of the
+ * writer that encodes, compresses and writes them, from a fixed pool of chunks, so that nothing is allocated on the
+ * calling thread once open; the writer thread allocates only the compressed payload of each chunk. If the disk falls behind by the whole pool, states are dropped and counted instead of blocking the caller,
+ * unless the log is lossless, e.g for offline replays that run faster than the disk.
+ */
+class TrajectoryLogWriter{
+
+public:
+
+    /**
+     * @brief Creates a new writer that is not open
+     */
+    TrajectoryLogWriter();
+
+    /**
+     * @brief Closes the log if open
+     */
+    ~TrajectoryLogWriter();
+
+    /**
+     * @brief Creates or truncates a log, writes its header and starts the writer thread
+     *
+     * @param fileName Path of the log
+     * @param compressed Whether chunks are compressed, smaller at the cost of some CPU on the writer thread
+     * @param chunkSize Number of records per chunk
+     * @param lossless Whether write() waits for the writer thread instead of dropping states when it falls behind
+     *
+     * @return Whether the log could be opened
+     */
+    bool open(QString const& fileName, bool compressed = true, unsigned int chunkSize = 4096, bool lossless = false);
+
+    /**
+     * @brief Writes the partial chunk, stops the writer thread and closes the log, write() must not be running
+     */
+    void close();
+
+    /**
+     * @brief Gets whether a log is open
+     *
+     * @return Whether a log is open
+     */
+    bool isOpen() const { return thread.joinable(); }
+
+    /**
+     * @brief Appends a state, from one thread at a time, never blocks unless the log is lossless
+     *
+     * @param state Latest snapshot of the fusion core
+     */
+    void write(IMUFusion::State const& state);
+
+    /**
+     * @brief Gets the number of states dropped because the writer thread fell behind or failed to write
+     *
+     * @return Number of dropped states since open()
+     */
+    quint64 dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+
+    /**
+     * @brief Records of one chunk, column by column
+     */
+    struct Chunk{
+        unsigned int size;                      ///< Number of records
+        std::vector<quint64> timestamps;        ///< Timestamp column
+        std::vector<float> columns;             ///< Float columns one after the other, chunkSize values each
+    };
+
+    /**
+     * @brief Writer thread body, writes full chunks until stopped and then the remaining ones
+     */
+    void run();
+
+    /**
+     * @brief Encodes, compresses and writes a chunk, writer thread only
+     *
+     * @param chunk Chunk to write
+     *
+     * @return Whether the chunk was written
+     */
+    bool writeChunk(Chunk const& chunk);
+
+    static const unsigned int NUM_CHUNKS = 4;   ///< Chunks in the pool, one filled while the others are written
+
+    QFile file;                                 ///< The log, written by the writer thread only while open
+    QString fileName;                           ///< Path of the log
+    bool compressed;                            ///< Whether chunks are compressed
+    unsigned int chunkSize;                     ///< Number of records per chunk
+    bool lossless;                              ///< Whether write() waits for spare chunks instead of dropping states
+
+    std::vector<Chunk> chunks;                  ///< Pool of chunks
+    Chunk* current;                             ///< Chunk being filled, nullptr if none is free
+    SPSCQueue<Chunk*, NUM_CHUNKS> full;         ///< Chunks waiting to be written
+    SPSCQueue<Chunk*, NUM_CHUNKS> spare;        ///< Chunks written and ready to be filled again
+    std::vector<char> payload;                  ///< Encoded payload of the chunk being written, writer thread only
+    std::atomic<quint64> droppedRecords;        ///< States dropped since open()
+    bool failed;                                ///< Whether a write failed, writer thread only
+
+    std::mutex wakeMutex;                       ///< Guards the wakeup of the writer thread
+    std::condition_variable wakeCondition;      ///< Signaled when a chunk is full or the writer is stopped
+    std::condition_variable spareCondition;     ///< Signaled when a chunk was written, for lossless logs
+    std::atomic<bool> running;                  ///< Whether the writer thread should keep waiting for chunks
+    std::thread thread;                         ///< The writer thread, running while open
+};
+
+/**
+ * @brief Reads a trajectory log chunk by chunk
+ */
+class TrajectoryLogReader{
+
+public:
+
+    /**
+     * @brief Creates a new reader that is not open
+     */
+    TrajectoryLogReader();
+
+    /**
+     * @brief Opens a log and validates its header
+     *
+     * @param fileName Path of the log
+     *
+     * @return Whether the log could be opened and is compatible
+     */
+    bool open(QString const& fileName);
+
+    /**
+     * @brief Closes the log
+     */
+    void close();
+
+    /**
+     * @brief Decodes the next chunk
+     *
+     * @param records Assigned the records of the chunk
+     *
+     * @return Whether a chunk was decoded, false at the end of the log or at a truncated or corrupt chunk
+     */
+    bool readChunk(std::vector<TrajectoryLog::Record>& records);
+
+private:
+
+    QFile file;                                 ///< The log
+};
+
+#endif /* TRAJECTORYLOG_H */
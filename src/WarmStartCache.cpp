@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file WarmStartCache.cpp
+ * @brief Implementation of the on-disk warm start cache
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#include"WarmStartCache.h"
+#include"IMULogging.h"
+
+#include<QFile>
+#include<QSaveFile>
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+
+/**
+ * @brief Checks that a record holds values a filter can start from, and brings its rotation to unit norm
+ *
+ * @param record Record just read, its rotation is normalized if valid
+ *
+ * @return Whether all values are finite, the rotation is not degenerate and the bias covariance is symmetric with a non-negative diagonal that bounds the rest
+ */
+static bool validate(WarmStartCache::Record& record)
+{
+    double const* values = (double const*)&record;
+    for(std::size_t i = 0; i < sizeof(record)/sizeof(double); i++)
+        if(!std::isfinite(values[i]))
+            return false;
+
+    double norm = 0;
+    for(int i = 0; i < 4; i++)
+        norm += record.rotation[i]*record.rotation[i];
+    norm = std::sqrt(norm);
+    if(norm < 0.5 || norm > 2.0)
+        return false;
+    for(int i = 0; i < 4; i++)
+        record.rotation[i] /= norm;
+
+    //Symmetric, and every 2x2 principal minor non-negative, what positive semidefiniteness needs at least
+    for(int i = 0; i < 6; i++){
+        double cii = record.biasCov[i*6 + i];
+        if(cii < 0)
+            return false;
+        for(int j = i + 1; j < 6; j++){
+            double cij = record.biasCov[i*6 + j], cji = record.biasCov[j*6 + i], cjj = record.biasCov[j*6 + j];
+            if(std::fabs(cij - cji) > 1e-9*std::max(1.0, std::fabs(cij)) || cij*cij > cii*cjj*(1 + 1e-9))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool WarmStartCache::save(QString const& fileName, IMUFusion::WarmStart const& warmStart)
+{
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+
+    Record record;
+    for(int i = 0; i < 4; i++)
+        record.rotation[i] = warmStart.rotation(i);
+    for(int i = 0; i < 3; i++){
+        record.gyroBias[i] = warmStart.gyroBias(i);
+        record.accBias[i] = warmStart.accBias(i);
+    }
+    for(int i = 0; i < 6*6; i++)
+        record.biasCov[i] = warmStart.biasCov.val[i];
+    record.m_norm_mean = warmStart.m_norm_mean;
+    record.m_dip_angle_mean = warmStart.m_dip_angle_mean;
+
+    //Written aside and renamed over the previous cache on commit, so a crash never leaves half a cache
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        qCWarning(imuFusion) << "Could not open warm start cache " << fileName << " for writing";
+        return false;
+    }
+    if(file.write((const char*)&header, sizeof(header)) != sizeof(header) ||
+            file.write((const char*)&record, sizeof(record)) != sizeof(record) || !file.commit()){
+        qCWarning(imuFusion) << "Could not write warm start cache " << fileName;
+        return false;
+    }
+    return true;
+}
+
+bool WarmStartCache::load(QString const& fileName, IMUFusion::WarmStart& warmStart)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        qCDebug(imuFusion) << "No warm start cache at " << fileName;
+        return false;
+    }
+
+    Header header;
+    Record record;
+    if(file.read((char*)&header, sizeof(header)) != sizeof(header) ||
+            std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != VERSION || header.recordSize != sizeof(Record) ||
+            file.read((char*)&record, sizeof(record)) != sizeof(record)){
+        qCWarning(imuFusion) << "Warm start cache " << fileName << " is not a compatible warm start cache";
+        return false;
+    }
+    if(!validate(record)){
+        qCWarning(imuFusion) << "Warm start cache " << fileName << " holds invalid values, starting cold";
+        return false;
+    }
+
+    for(int i = 0; i < 4; i++)
+        warmStart.rotation(i) = record.rotation[i];
+    for(int i = 0; i < 3; i++){
+        warmStart.gyroBias(i) = record.gyroBias[i];
+        warmStart.accBias(i) = record.accBias[i];
+    }
+    for(int i = 0; i < 6*6; i++)
+        warmStart.biasCov.val[i] = record.biasCov[i];
+    warmStart.m_norm_mean = record.m_norm_mean;
+    warmStart.m_dip_angle_mean = record.m_dip_angle_mean;
+    return true;
+}
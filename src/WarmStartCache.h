@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file WarmStartCache.h
+ * @brief On-disk copy of what a new fusion core is warm started from
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef WARMSTARTCACHE_H
+#define WARMSTARTCACHE_H
+
+#include<QString>
+
+#include"IMUFusion.h"
+
+/**
+ * @brief On-disk layout and access of warm start caches, in native byte order
+ *
+ * A cache is a Header followed by a single Record, see IMUFusion::getWarmStart() and IMUFusion::warmStart().
+ */
+namespace WarmStartCache{
+
+    static const char MAGIC[8] = {'Q', 'M', 'L', 'I', 'M', 'U', 'W', 'S'};  ///< Start of every cache
+    static const quint32 VERSION = 1;                                       ///< Current format version
+
+    /**
+     * @brief File header
+     */
+    struct Header{
+        char magic[8];                  ///< Always MAGIC
+        quint32 version;                ///< Format version, VERSION
+        quint32 recordSize;             ///< sizeof(Record), to detect incompatible builds
+    };
+
+    /**
+     * @brief Values of IMUFusion::WarmStart, in double precision whatever qreal is
+     */
+    struct Record{
+        double rotation[4];             ///< Rotation, w, x, y, z
+        double gyroBias[3];             ///< Gyroscope bias in rad/s
+        double accBias[3];              ///< Accelerometer bias in m/s^2
+        double biasCov[6*6];            ///< Covariance of the biases, row major
+        double m_norm_mean;             ///< Mean magnitude of the magnetic vector, -1 if unknown
+        double m_dip_angle_mean;        ///< Mean dip angle of the magnetic vector, -1 if unknown
+    };
+
+    static_assert(sizeof(Header) == 16, "Unexpected warm start cache header layout");
+    static_assert(sizeof(Record) == 384, "Unexpected warm start cache record layout");
+
+    /**
+     * @brief Replaces a cache, the previous one stays intact if writing fails
+     *
+     * @param fileName Path of the cache
+     * @param warmStart Values to store
+     *
+     * @return Whether the cache was written
+     */
+    bool save(QString const& fileName, IMUFusion::WarmStart const& warmStart);
+
+    /**
+     * @brief Reads a cache, rejecting values a filter cannot start from
+     *
+     * Non-finite values, a rotation far from unit norm or a bias covariance that is not symmetric with a non-negative
+     * diagonal bounding the rest reject the cache, so that a corrupt one is not fed to every relaunch; the rotation is
+     * normalized.
+     *
+     * @param fileName Path of the cache
+     * @param warmStart Assigned the stored values if the cache is compatible and valid
+     *
+     * @return Whether the cache exists, is compatible and holds valid values
+     */
+    bool load(QString const& fileName, IMUFusion::WarmStart& warmStart);
+}
+
+#endif /* WARMSTARTCACHE_H */
@@ -0,0 +1,48 @@
+#Headless fusion core, needs only QtCore and OpenCV; included by the plugin, the core library, the tools and the benchmarks
+
+CONFIG += c++11 thread
+
+INCLUDEPATH += $$PWD
+
+#Fusion runs in qreal, add CONFIG+=imu_float for float with double covariances, and CONFIG+=imu_float_covariance for float covariances too
+imu_float: DEFINES += IMU_FUSION_FLOAT
+imu_float_covariance: DEFINES += IMU_FUSION_FLOAT IMU_FUSION_FLOAT_COVARIANCE
+
+#x86 builds are vectorized for SSE2 only, add CONFIG+=imu_avx2 for AVX2 and FMA capable CPUs, mostly to widen IMUFusionBatch
+imu_avx2{
+    QMAKE_CXXFLAGS += -mavx2 -mfma
+    QMAKE_CXXFLAGS_RELEASE += -mavx2 -mfma
+}
+
+HEADERS += \
+    $$PWD/ExtendedKalmanFilter.h \
+    $$PWD/FixedExtendedKalmanFilter.h \
+    $$PWD/SymmetricSolver.h \
+    $$PWD/IMULogging.h \
+    $$PWD/SPSCQueue.h \
+    $$PWD/StateRing.h \
+    $$PWD/IMUFusion.h \
+    $$PWD/IMUFusionBatch.h \
+    $$PWD/FusionScheduler.h \
+    $$PWD/FusionPipeline.h \
+    $$PWD/FusionWorker.h \
+    $$PWD/SampleMerger.h \
+    $$PWD/SensorLog.h \
+    $$PWD/TrajectoryLog.h \
+    $$PWD/WarmStartCache.h \
+    $$PWD/AccelerometerBiasFilter.h
+
+SOURCES += \
+    $$PWD/ExtendedKalmanFilter.cpp \
+    $$PWD/IMULogging.cpp \
+    $$PWD/IMUFusion.cpp \
+    $$PWD/FusionScheduler.cpp \
+    $$PWD/FusionPipeline.cpp \
+    $$PWD/FusionWorker.cpp \
+    $$PWD/SampleMerger.cpp \
+    $$PWD/SensorLog.cpp \
+    $$PWD/TrajectoryLog.cpp \
+    $$PWD/WarmStartCache.cpp \
+    $$PWD/AccelerometerBiasFilter.cpp
+
+LIBS += -lopencv_core
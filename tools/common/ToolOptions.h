@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2014 EPFL
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**
+ * @file ToolOptions.h
+ * @brief Command line parameter, engine, measurement update and integrator parsing shared by the tools and benchmarks
+ * @author Ayberk Özgür
+ * @version 1.0
+ * @date 2026-10-14
+ */
+
+#ifndef TOOLOPTIONS_H
+#define TOOLOPTIONS_H
+
+#include <cstdio>
+
+#include <QString>
+#include <QStringList>
+
+#include "IMUFusion.h"
+
+namespace ToolOptions{
+
+/**
+ * @brief Parses name=value assignments into the parameters, reporting the first invalid one to stderr
+ *
+ * @param assignments Assignments, e.g the values of a repeatable --set option; startupTime is accepted too
+ * @param params Parameters to assign
+ * @param startupTime Assigned the startupTime value if given
+ *
+ * @return Whether all assignments were valid
+ */
+inline bool applyParameters(QStringList const& assignments, IMUFusion::Parameters& params, qreal& startupTime)
+{
+    for(auto const& assignment : assignments){
+        QStringList nameValue = assignment.split('=');
+        bool valid = nameValue.size() == 2;
+        qreal value = valid ? nameValue[1].toDouble(&valid) : 0;
+        if(valid && nameValue[0] == "startupTime")
+            startupTime = value;
+        else if(!valid || !params.set(nameValue[0], value)){
+            std::fprintf(stderr, "Invalid parameter assignment: %s\n", qPrintable(assignment));
+            std::fprintf(stderr, "Known parameters: startupTime %s\n", qPrintable(IMUFusion::Parameters::names().join(' ')));
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the engine from its command line name, reporting an unknown one to stderr
+ *
+ * @param name quaternion, error-state or error-state-bias
+ * @param params Parameters to assign
+ *
+ * @return Whether the name is known
+ */
+inline bool applyEngine(QString const& name, IMUFusion::Parameters& params)
+{
+    if(name == "quaternion")
+        params.engine = IMUFusion::QUATERNION_ENGINE;
+    else if(name == "error-state")
+        params.engine = IMUFusion::ERROR_STATE_ENGINE;
+    else if(name == "error-state-bias")
+        params.engine = IMUFusion::ERROR_STATE_BIAS_ENGINE;
+    else{
+        std::fprintf(stderr, "Unknown engine: %s\n", qPrintable(name));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the measurement update from its command line name, reporting an unknown one to stderr
+ *
+ * @param name full, active or sequential
+ * @param params Parameters to assign
+ *
+ * @return Whether the name is known
+ */
+inline bool applyMeasurementUpdate(QString const& name, IMUFusion::Parameters& params)
+{
+    if(name == "full")
+        params.measurementUpdate = IMUFusion::FULL_UPDATE;
+    else if(name == "active")
+        params.measurementUpdate = IMUFusion::ACTIVE_ROWS_UPDATE;
+    else if(name == "sequential")
+        params.measurementUpdate = IMUFusion::SEQUENTIAL_UPDATE;
+    else{
+        std::fprintf(stderr, "Unknown measurement update: %s\n", qPrintable(name));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the integrator from its command line name, reporting an unknown one to stderr
+ *
+ * @param name first-order, exponential, coning or rk4
+ * @param params Parameters to assign
+ *
+ * @return Whether the name is known
+ */
+inline bool applyIntegrator(QString const& name, IMUFusion::Parameters& params)
+{
+    if(name == "first-order")
+        params.integrator = IMUFusion::FIRST_ORDER_INTEGRATOR;
+    else if(name == "exponential")
+        params.integrator = IMUFusion::EXPONENTIAL_INTEGRATOR;
+    else if(name == "coning")
+        params.integrator = IMUFusion::CONING_INTEGRATOR;
+    else if(name == "rk4")
+        params.integrator = IMUFusion::RK4_INTEGRATOR;
+    else{
+        std::fprintf(stderr, "Unknown integrator: %s\n", qPrintable(name));
+        return false;
+    }
+    return true;
+}
+
+}
+
+#endif /* TOOLOPTIONS_H */
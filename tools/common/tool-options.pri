@@ -0,0 +1,5 @@
+#Command line parsing shared by the tools and benchmarks, header only
+
+INCLUDEPATH += $$PWD
+
+HEADERS += $$PWD/ToolOptions.h
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "AccelerometerBiasFilter.h"
+#include "IMUFusion.h"
+#include "IMUFusionBatch.h"
+#include "SensorLog.h"
+#include "ToolOptions.h"
+
+//One recorded session and what its re-fusion found
+struct Session{
+    QString fileName;
+    qint64 fileSize;
+    bool valid;
+    quint64 samples;
+    quint64 published;
+    double duration;                //Recorded duration in seconds
+    double drift;                   //Translation since startup at the end of the session in meters
+    double driftRate;               //drift per recorded minute
+    double gyroBias;                //Norm of the estimated gyroscope bias in deg/s
+    double accBias;                 //Norm of the estimated accelerometer bias in m/s^2
+    double staticAccBias;           //Norm of the AccelerometerBiasFilter bias in m/s^2
+    double staticAccBiasCov;        //AccelerometerBiasFilter covariance trace
+    IMUFusion::Statistics statistics;
+};
+
+//Sessions re-fused together by a worker with --batch, one per lane
+static const int BATCH_LANES = 8;
+
+//Batch of the same precision as IMUFusion
+template<typename Fusion> struct BatchOf;
+template<typename Scalar, typename CovScalar> struct BatchOf<BasicIMUFusion<Scalar, CovScalar>>{
+    typedef IMUFusionBatch<BATCH_LANES, Scalar, CovScalar> Type;
+};
+typedef BatchOf<IMUFusion>::Type FleetBatch;
+
+//Everything one worker touches while it runs, kept apart from the other workers' so that nothing is shared
+struct alignas(64) Worker{
+    Worker() : sessions(0), samples(0), seconds(0){}
+
+    SensorLogReader readers[BATCH_LANES]; //Remapped for every session, only the first one without --batch
+    quint64 sessions;
+    quint64 samples;
+    double seconds;                 //Time spent fusing
+};
+
+//Collects the logs given directly or found under the given directories
+static void findLogs(QStringList const& paths, std::vector<Session>& sessions)
+{
+    QStringList fileNames;
+    for(auto const& path : paths){
+        if(QFileInfo(path).isDir()){
+            QDirIterator it(path, QStringList() << "*.imulog", QDir::Files, QDirIterator::Subdirectories);
+            while(it.hasNext())
+                fileNames << it.next();
+        }
+        else
+            fileNames << path;
+    }
+    fileNames.sort();
+    fileNames.removeDuplicates();
+
+    for(auto const& fileName : fileNames){
+        Session session = Session();
+        session.fileName = fileName;
+        session.fileSize = QFileInfo(fileName).size();
+        sessions.push_back(session);
+    }
+}
+
+//Runs the accelerometer readings of a session through the static bias estimator
+static void estimateStaticBias(SensorLogReader const& reader, Session& session)
+{
+    AccelerometerBiasFilter biasFilter;
+    for(quint64 i = 0; i < reader.size(); i++){
+        IMUFusion::Sample sample = reader.at(i);
+        if(sample.type == IMUFusion::Sample::ACCELEROMETER)
+            biasFilter.push(sample.timestamp, sample.x, sample.y, sample.z);
+    }
+    session.staticAccBias = cv::norm(biasFilter.getBias());
+    session.staticAccBiasCov = biasFilter.getCovTrace();
+}
+
+//Fills in the figures of a session from the final state of its fusion and its translation since startup
+static void finishSession(SensorLogReader const& reader, Session& session, IMUFusion::State const& s, IMUFusion::Vector const& translation)
+{
+    session.duration = reader.duration();
+    session.drift = cv::norm(translation);
+    session.driftRate = session.duration > 0 ? session.drift*60/session.duration : 0;
+    session.gyroBias = cv::norm(s.gyroBias)*180.0/M_PI;
+    session.accBias = cv::norm(s.accBias);
+}
+
+//Re-fuses one session from scratch with its own fusion core and accelerometer bias filter
+static void process(Worker& worker, Session& session, IMUFusion::Parameters const& params, qreal startupTime)
+{
+    SensorLogReader& reader = worker.readers[0];
+    if(!reader.open(session.fileName) || reader.size() == 0)
+        return;
+    session.valid = true;
+    session.samples = reader.size();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    IMUFusion fusion(startupTime);
+    fusion.setParameters(params);
+    fusion.setStatisticsEnabled(true);
+    reader.replay(fusion, [&](IMUFusion const&){ session.published++; });
+    estimateStaticBias(reader, session);
+
+    worker.seconds += timer.nsecsElapsed()*1e-9;
+    worker.sessions++;
+    worker.samples += session.samples;
+
+    IMUFusion::State const& s = fusion.getState();
+    finishSession(reader, session, s, s.translation);
+    session.statistics = fusion.takeStatistics();
+}
+
+//Gets the next sample of a log in the order replay() fuses it, false at the end of the log
+static bool nextSample(SensorLogReader const& reader, SampleMerger& merger, quint64& index, IMUFusion::Sample& sample)
+{
+    while(!merger.pop(sample)){
+        if(index == reader.size()){
+
+            //End of log, nothing can arrive later
+            merger.setGating(IMUFusion::Sample::GYROSCOPE, false);
+            merger.setGating(IMUFusion::Sample::ACCELEROMETER, false);
+            return merger.pop(sample);
+        }
+        merger.push(reader.at(index++));
+    }
+    return true;
+}
+
+//Re-fuses up to BATCH_LANES sessions from scratch together, one per lane of a batch, each with its own merger and accelerometer bias filter
+static void processBatch(Worker& worker, Session* const* sessions, int numSessions, IMUFusion::Parameters const& params, qreal startupTime)
+{
+    FleetBatch batch(startupTime);
+    SampleMerger mergers[BATCH_LANES];
+    quint64 next[BATCH_LANES];
+    bool open[BATCH_LANES];
+    for(int l = 0; l < BATCH_LANES; l++){
+        next[l] = 0;
+        open[l] = l < numSessions && worker.readers[l].open(sessions[l]->fileName) && worker.readers[l].size() > 0;
+        if(!open[l])
+            continue;
+        sessions[l]->valid = true;
+        sessions[l]->samples = worker.readers[l].size();
+        batch.setParameters(l, params);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    //Every step takes the next sample of each lane whose log is not over yet
+    IMUFusion::Sample samples[BATCH_LANES];
+    bool present[BATCH_LANES];
+    for(;;){
+        bool any = false;
+        for(int l = 0; l < BATCH_LANES; l++){
+            present[l] = open[l] && nextSample(worker.readers[l], mergers[l], next[l], samples[l]);
+            any |= present[l];
+        }
+        if(!any)
+            break;
+        unsigned int changed = batch.processSamples(samples, present);
+        for(int l = 0; l < numSessions; l++)
+            if(changed & (1u << l))
+                sessions[l]->published++;
+    }
+    for(int l = 0; l < numSessions; l++)
+        if(open[l])
+            estimateStaticBias(worker.readers[l], *sessions[l]);
+
+    worker.seconds += timer.nsecsElapsed()*1e-9;
+
+    //Lanes are never reset, their displacement is their translation since startup
+    for(int l = 0; l < numSessions; l++){
+        if(!open[l])
+            continue;
+        worker.sessions++;
+        worker.samples += sessions[l]->samples;
+        IMUFusion::State s = batch.getState(l);
+        finishSession(worker.readers[l], *sessions[l], s, s.dispTranslation);
+    }
+}
+
+//Mean, p50, p95 and max of one figure over the valid sessions
+static void printDistribution(char const* name, std::vector<Session> const& sessions, double Session::* figure)
+{
+    std::vector<double> values;
+    for(auto const& session : sessions)
+        if(session.valid && std::isfinite(session.*figure))
+            values.push_back(session.*figure);
+    if(values.empty())
+        return;
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for(double value : values)
+        sum += value;
+    std::printf("%-28s %12g %12g %12g %12g\n", name, sum/values.size(),
+        values[values.size()/2], values[std::min(values.size() - 1, values.size()*95/100)], values.back());
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Re-fuses many sensor logs in parallel and aggregates their drift, bias and innovation statistics");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "Sensor logs, or directories searched recursively for *.imulog", "logs...");
+    QCommandLineOption setOption(QStringList() << "s" << "set", "Sets a parameter, e.g R_g_k_0=1.5, can be repeated", "name=value");
+    QCommandLineOption engineOption(QStringList() << "e" << "engine", "Engine: quaternion, error-state or error-state-bias", "engine", "error-state-bias");
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads", "Number of worker threads, default all cores", "count");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Writes the figures of every session to this CSV file", "file");
+    QCommandLineOption batchOption(QStringList() << "b" << "batch", "Re-fuses 8 sessions at a time per thread in an IMUFusionBatch, needs the quaternion engine; no innovation, outlier or dropped sample statistics");
+    parser.addOption(setOption);
+    parser.addOption(engineOption);
+    parser.addOption(threadsOption);
+    parser.addOption(outputOption);
+    parser.addOption(batchOption);
+    parser.process(app);
+
+    if(parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    IMUFusion::Parameters params;
+    qreal startupTime = 1.0f;
+    if(!ToolOptions::applyParameters(parser.values(setOption), params, startupTime) ||
+            !ToolOptions::applyEngine(parser.value(engineOption), params))
+        return 1;
+    const bool batched = parser.isSet(batchOption);
+    if(batched && params.engine != IMUFusion::QUATERNION_ENGINE){
+        std::fprintf(stderr, "--batch needs --engine quaternion\n");
+        return 1;
+    }
+
+    std::vector<Session> sessions;
+    findLogs(parser.positionalArguments(), sessions);
+    if(sessions.empty()){
+        std::fprintf(stderr, "No sensor logs found\n");
+        return 1;
+    }
+
+    //Longest sessions first, so that the last ones to be taken are short and the workers finish together
+    std::vector<std::size_t> order(sessions.size());
+    for(std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [&](std::size_t lhs, std::size_t rhs){ return sessions[lhs].fileSize > sessions[rhs].fileSize; });
+
+    //Idle workers take the next session, or the next BATCH_LANES of them; the sessions, readers and fusion cores of different workers never meet
+    const std::size_t take = batched ? BATCH_LANES : 1;
+    int numThreads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : (int)std::thread::hardware_concurrency();
+    numThreads = std::max(1, std::min(numThreads, (int)((sessions.size() + take - 1)/take)));
+    std::vector<Worker> workers(numThreads);
+    std::atomic<std::size_t> nextSession(0);
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < numThreads; t++)
+        threads.push_back(std::thread([&, t](){
+            Worker& worker = workers[t];
+            for(std::size_t i = nextSession.fetch_add(take); i < order.size(); i = nextSession.fetch_add(take)){
+                if(!batched){
+                    process(worker, sessions[order[i]], params, startupTime);
+                    continue;
+                }
+                Session* batch[BATCH_LANES];
+                int numSessions = (int)std::min(take, order.size() - i);
+                for(int l = 0; l < numSessions; l++)
+                    batch[l] = &sessions[order[i + l]];
+                processBatch(worker, batch, numSessions, params, startupTime);
+            }
+            for(auto& reader : worker.readers)
+                reader.close();
+        }));
+    for(auto& thread : threads)
+        thread.join();
+    double seconds = timer.nsecsElapsed()*1e-9;
+
+    //Totals
+    quint64 valid = 0, samples = 0, corrections = 0, rollbacks = 0, dropped = 0, outOfOrder = 0, gravityRejected = 0, magRejected = 0;
+    double recorded = 0, innovationSum = 0, innovationMax = 0, busy = 0;
+    for(auto const& worker : workers)
+        busy += worker.seconds;
+    for(auto& session : sessions){
+        if(!session.valid){
+            std::fprintf(stderr, "Could not read any samples from %s\n", qPrintable(session.fileName));
+            continue;
+        }
+        IMUFusion::Statistics const& st = session.statistics;
+        valid++;
+        samples += session.samples;
+        recorded += session.duration;
+        corrections += st.corrections;
+        rollbacks += st.rollbacks;
+        gravityRejected += st.gravityRejected;
+        magRejected += st.magRejected;
+        dropped += st.gyro.dropped + st.acc.dropped + st.mag.dropped;
+        outOfOrder += st.gyro.outOfOrder + st.acc.outOfOrder + st.mag.outOfOrder;
+        innovationSum += st.innovationSum;
+        innovationMax = std::max(innovationMax, (double)st.innovationMax);
+    }
+
+    std::printf("sessions:           %llu of %zu\n", (unsigned long long)valid, sessions.size());
+    std::printf("samples:            %llu\n", (unsigned long long)samples);
+    std::printf("recorded duration:  %.1f h\n", recorded/3600);
+    std::printf("wall time:          %.3f s on %d threads\n", seconds, numThreads);
+    std::printf("samples/s:          %.0f\n", samples/seconds);
+    std::printf("real time factor:   %.0fx\n", recorded/seconds);
+    std::printf("thread utilization: %.0f%%\n", 100*busy/(seconds*numThreads));
+    if(batched)
+        std::printf("batched:            %d sessions per thread, no fusion statistics\n", BATCH_LANES);
+    else{
+        std::printf("corrections:        %llu, %llu rollbacks\n", (unsigned long long)corrections, (unsigned long long)rollbacks);
+        std::printf("samples dropped:    %llu, %llu out of order\n", (unsigned long long)dropped, (unsigned long long)outOfOrder);
+        std::printf("innovation:         mean %g, max %g\n", corrections > 0 ? innovationSum/corrections : 0.0, innovationMax);
+        std::printf("outliers rejected:  %llu gravity, %llu magnetic\n", (unsigned long long)gravityRejected, (unsigned long long)magRejected);
+    }
+
+    std::printf("\n%-28s %12s %12s %12s %12s\n", "per session", "mean", "p50", "p95", "max");
+    printDistribution("drift (m/min)", sessions, &Session::driftRate);
+    if(params.engine == IMUFusion::ERROR_STATE_BIAS_ENGINE){
+        printDistribution("gyro bias (deg/s)", sessions, &Session::gyroBias);
+        printDistribution("acc bias (m/s^2)", sessions, &Session::accBias);
+    }
+    printDistribution("static acc bias (m/s^2)", sessions, &Session::staticAccBias);
+
+    if(parser.isSet(outputOption)){
+        QFile outputFile(parser.value(outputOption));
+        if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)){
+            std::fprintf(stderr, "Could not open %s for writing\n", qPrintable(outputFile.fileName()));
+            return 1;
+        }
+        QTextStream output(&outputFile);
+        output << "file,samples,published,duration,drift,drift_rate,gyro_bias,acc_bias,static_acc_bias,static_acc_bias_cov,"
+            "corrections,innovation_mean,innovation_max,gravity_rejected,mag_rejected,rollbacks,dropped,out_of_order\n";
+        for(auto const& session : sessions){
+            if(!session.valid)
+                continue;
+            IMUFusion::Statistics const& st = session.statistics;
+            output << session.fileName << ',' << session.samples << ',' << session.published << ','
+                << session.duration << ',' << session.drift << ',' << session.driftRate << ','
+                << session.gyroBias << ',' << session.accBias << ','
+                << session.staticAccBias << ',' << session.staticAccBiasCov << ','
+                << st.corrections << ',' << (st.corrections > 0 ? st.innovationSum/st.corrections : 0.0) << ','
+                << st.innovationMax << ',' << st.gravityRejected << ',' << st.magRejected << ',' << st.rollbacks << ','
+                << st.gyro.dropped + st.acc.dropped + st.mag.dropped << ','
+                << st.gyro.outOfOrder + st.acc.outOfOrder + st.mag.outOfOrder << '\n';
+        }
+    }
+    return valid == sessions.size() ? 0 : 1;
+}
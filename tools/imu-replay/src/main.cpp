@@ -0,0 +1,145 @@
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "IMUFusion.h"
+#include "SensorLog.h"
+#include "ToolOptions.h"
+#include "TrajectoryLog.h"
+#include "WarmStartCache.h"
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a sensor log recorded by the IMU item through the fusion core as fast as possible");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Sensor log recorded with the recordFile property of IMU");
+    QCommandLineOption setOption(QStringList() << "s" << "set", "Sets a parameter, e.g R_g_k_0=1.5, can be repeated", "name=value");
+    QCommandLineOption updateOption(QStringList() << "u" << "measurement-update", "Measurement update: full, active or sequential", "mode", "active");
+    QCommandLineOption integratorOption(QStringList() << "i" << "integrator", "Integrator: first-order, exponential, coning or rk4", "integrator", "first-order");
+    QCommandLineOption engineOption(QStringList() << "e" << "engine", "Engine: quaternion, error-state or error-state-bias", "engine", "quaternion");
+    QCommandLineOption deferredOption(QStringList() << "c" << "deferred-covariance", "Defers the covariance prediction to the next correction");
+    QCommandLineOption alignOption(QStringList() << "a" << "time-alignment", "Fuses accelerometer and magnetometer samples at their exact timestamp");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Writes every published state to this CSV file", "file");
+    QCommandLineOption trajectoryOption(QStringList() << "t" << "trajectory", "Writes every published state to this trajectory log", "file");
+    QCommandLineOption repeatOption(QStringList() << "r" << "repeat", "Replays the log this many times, for timing", "count", "1");
+    QCommandLineOption warmStartOption(QStringList() << "w" << "warm-start", "Warm starts from this cache if it exists and saves the final state to it", "file");
+    QCommandLineOption warmStartupOption("warm-startup-time", "Startup time in seconds after a warm start", "seconds", "0.1");
+    parser.addOption(setOption);
+    parser.addOption(engineOption);
+    parser.addOption(updateOption);
+    parser.addOption(integratorOption);
+    parser.addOption(deferredOption);
+    parser.addOption(alignOption);
+    parser.addOption(outputOption);
+    parser.addOption(trajectoryOption);
+    parser.addOption(repeatOption);
+    parser.addOption(warmStartOption);
+    parser.addOption(warmStartupOption);
+    parser.process(app);
+
+    if(parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    IMUFusion::Parameters params;
+    qreal startupTime = 1.0f;
+    if(!ToolOptions::applyParameters(parser.values(setOption), params, startupTime))
+        return 1;
+
+    if(!ToolOptions::applyEngine(parser.value(engineOption), params) ||
+            !ToolOptions::applyMeasurementUpdate(parser.value(updateOption), params) ||
+            !ToolOptions::applyIntegrator(parser.value(integratorOption), params))
+        return 1;
+
+    params.deferredCovariance = parser.isSet(deferredOption);
+    params.timeAlignment = parser.isSet(alignOption);
+
+    int repeat = parser.value(repeatOption).toInt();
+    if(repeat <= 0)
+        repeat = 1;
+
+    SensorLogReader reader;
+    if(!reader.open(parser.positionalArguments()[0]) || reader.size() == 0){
+        std::fprintf(stderr, "Could not read any samples from %s\n", qPrintable(parser.positionalArguments()[0]));
+        return 1;
+    }
+
+    IMUFusion::WarmStart warmStart;
+    bool warm = parser.isSet(warmStartOption) && WarmStartCache::load(parser.value(warmStartOption), warmStart);
+    qreal warmStartupTime = parser.value(warmStartupOption).toDouble();
+
+    QFile outputFile;
+    QTextStream output;
+    if(parser.isSet(outputOption)){
+        outputFile.setFileName(parser.value(outputOption));
+        if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)){
+            std::fprintf(stderr, "Could not open %s for writing\n", qPrintable(outputFile.fileName()));
+            return 1;
+        }
+        output.setDevice(&outputFile);
+        output << "timestamp,q_w,q_x,q_y,q_z,a_x,a_y,a_z,d_x,d_y,d_z\n";
+    }
+
+    //Lossless, the replay runs much faster than the disk
+    TrajectoryLogWriter trajectory;
+    if(parser.isSet(trajectoryOption) && !trajectory.open(parser.value(trajectoryOption), true, 4096, true)){
+        std::fprintf(stderr, "Could not open %s for writing\n", qPrintable(parser.value(trajectoryOption)));
+        return 1;
+    }
+
+    //Replay, the final run's fusion core is reported
+    IMUFusion fusion;
+    quint64 published = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < repeat; i++){
+        fusion = IMUFusion(startupTime);
+        fusion.setParameters(params);
+        if(warm)
+            fusion.warmStart(warmStart, warmStartupTime);
+        bool writeOutput = output.device() != nullptr && i == repeat - 1;
+        bool writeTrajectory = trajectory.isOpen() && i == repeat - 1;
+
+        reader.replay(fusion, [&](IMUFusion const& f){
+            published++;
+            if(writeOutput){
+                IMUFusion::State const& s = f.getState();
+                output << s.timestamp << ','
+                    << s.rotation(0) << ',' << s.rotation(1) << ',' << s.rotation(2) << ',' << s.rotation(3) << ','
+                    << s.linearAcceleration(0) << ',' << s.linearAcceleration(1) << ',' << s.linearAcceleration(2) << ','
+                    << s.dispTranslation(0) << ',' << s.dispTranslation(1) << ',' << s.dispTranslation(2) << '\n';
+            }
+            if(writeTrajectory)
+                trajectory.write(f.getState());
+        });
+    }
+    double seconds = timer.nsecsElapsed()*1e-9;
+    trajectory.close();
+
+    double recorded = reader.duration();
+
+    bool saved = parser.isSet(warmStartOption) && fusion.getWarmStart(warmStart) &&
+        WarmStartCache::save(parser.value(warmStartOption), warmStart);
+
+    IMUFusion::State const& s = fusion.getState();
+    std::printf("samples:            %llu x %d\n", (unsigned long long)reader.size(), repeat);
+    std::printf("published states:   %llu\n", (unsigned long long)(published/repeat));
+    std::printf("recorded duration:  %.3f s\n", recorded);
+    std::printf("replay time:        %.3f s\n", seconds/repeat);
+    std::printf("samples/s:          %.0f\n", reader.size()*repeat/seconds);
+    std::printf("real time factor:   %.0fx\n", recorded*repeat/seconds);
+    std::printf("warm start:         %s, %s\n", warm ? "restored" : "cold", saved ? "saved" : "not saved");
+    std::printf("final rotation:     (%f, %f, %f, %f)\n", s.rotation(0), s.rotation(1), s.rotation(2), s.rotation(3));
+    std::printf("final displacement: (%f, %f, %f)\n", s.dispTranslation(0), s.dispTranslation(1), s.dispTranslation(2));
+    if(params.engine == IMUFusion::ERROR_STATE_BIAS_ENGINE){
+        std::printf("final gyro bias:    (%f, %f, %f) rad/s\n", s.gyroBias(0), s.gyroBias(1), s.gyroBias(2));
+        std::printf("final acc bias:     (%f, %f, %f) m/s^2\n", s.accBias(0), s.accBias(1), s.accBias(2));
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "IMUFusion.h"
+#include "SensorLog.h"
+#include "ToolOptions.h"
+
+//Search range of one coefficient, given as name=min:max[:steps][:log]
+struct Range{
+    QString name;
+    double min;
+    double max;
+    int steps;
+    bool logarithmic;
+};
+
+//One row of ground truth, displacement is optional
+struct GroundTruth{
+    quint64 timestamp;
+    double q[4];
+    bool hasDisplacement;
+    double d[3];
+};
+
+//One evaluated parameter set
+struct Candidate{
+    IMUFusion::Parameters params;
+    double score;
+};
+
+static bool parseRange(QString const& spec, Range& range)
+{
+    QStringList nameRange = spec.split('=');
+    if(nameRange.size() != 2)
+        return false;
+    range.name = nameRange[0];
+
+    QStringList fields = nameRange[1].split(':');
+    range.logarithmic = fields.size() > 2 && fields.last() == "log";
+    if(range.logarithmic)
+        fields.removeLast();
+    if(fields.size() != 2 && fields.size() != 3)
+        return false;
+
+    bool minValid, maxValid, stepsValid = true;
+    range.min = fields[0].toDouble(&minValid);
+    range.max = fields[1].toDouble(&maxValid);
+    range.steps = fields.size() == 3 ? fields[2].toInt(&stepsValid) : 5;
+    qreal dummy;
+    return minValid && maxValid && stepsValid && range.steps > 0 && range.max >= range.min &&
+        (!range.logarithmic || range.min > 0) && IMUFusion::Parameters().get(range.name, dummy);
+}
+
+//Value at position t in [0, 1] of the range
+static double interpolate(Range const& range, double t)
+{
+    if(range.logarithmic)
+        return range.min*std::pow(range.max/range.min, t);
+    return range.min + (range.max - range.min)*t;
+}
+
+//Loads a CSV with a header row, e.g the output of imu-replay; columns are found by name
+static bool loadGroundTruth(QString const& fileName, std::vector<GroundTruth>& truth)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+
+    QStringList header = in.readLine().split(',');
+    const char* names[] = {"timestamp", "q_w", "q_x", "q_y", "q_z", "d_x", "d_y", "d_z"};
+    int columns[8];
+    for(int i = 0; i < 8; i++)
+        columns[i] = header.indexOf(names[i]);
+    for(int i = 0; i < 5; i++)
+        if(columns[i] < 0)
+            return false;
+    bool hasDisplacement = columns[5] >= 0 && columns[6] >= 0 && columns[7] >= 0;
+
+    while(!in.atEnd()){
+        QStringList fields = in.readLine().split(',');
+        if(fields.size() < header.size())
+            continue;
+        GroundTruth row;
+        row.timestamp = fields[columns[0]].toULongLong();
+        for(int i = 0; i < 4; i++)
+            row.q[i] = fields[columns[1 + i]].toDouble();
+        row.hasDisplacement = hasDisplacement;
+        for(int i = 0; i < 3; i++)
+            row.d[i] = hasDisplacement ? fields[columns[5 + i]].toDouble() : 0;
+        truth.push_back(row);
+    }
+    return !truth.empty();
+}
+
+//Rotation error in degrees plus weighted displacement error in meters
+static double rowError(IMUFusion::State const& state, GroundTruth const& truth, double displacementWeight)
+{
+    double dot = 0;
+    for(int i = 0; i < 4; i++)
+        dot += state.rotation(i)*truth.q[i];
+    double error = 2*std::acos(std::min(1.0, std::fabs(dot)))*180.0/M_PI;
+
+    if(truth.hasDisplacement && displacementWeight > 0){
+        double d2 = 0;
+        for(int i = 0; i < 3; i++)
+            d2 += (state.dispTranslation(i) - truth.d[i])*(state.dispTranslation(i) - truth.d[i]);
+        error += displacementWeight*std::sqrt(d2);
+    }
+    return error;
+}
+
+//Replays the whole log with its own fusion core and compares every ground truth row with the latest state before it
+static double score(SensorLogReader const& reader, IMUFusion::Parameters const& params, qreal startupTime,
+        std::vector<GroundTruth> const& truth, double displacementWeight)
+{
+    IMUFusion fusion(startupTime);
+    fusion.setParameters(params);
+
+    std::size_t next = 0;
+    double error = 0;
+    unsigned int count = 0;
+    IMUFusion::State last;
+    bool hasLast = false;
+
+    reader.replay(fusion, [&](IMUFusion const& f){
+        IMUFusion::State const& state = f.getState();
+        for(; next < truth.size() && truth[next].timestamp < state.timestamp; next++)
+            if(hasLast){
+                error += rowError(last, truth[next], displacementWeight);
+                count++;
+            }
+        last = state;
+        hasLast = true;
+    });
+    for(; next < truth.size() && hasLast; next++){
+        error += rowError(last, truth[next], displacementWeight);
+        count++;
+    }
+
+    double mean = count > 0 ? error/count : std::numeric_limits<double>::infinity();
+    return std::isnan(mean) ? std::numeric_limits<double>::infinity() : mean;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Searches for the fusion coefficients that best match ground truth over a sensor log");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Sensor log recorded with the recordFile property of IMU");
+    parser.addPositionalArgument("truth", "Ground truth CSV with timestamp,q_w,q_x,q_y,q_z and optionally d_x,d_y,d_z columns");
+    QCommandLineOption rangeOption(QStringList() << "p" << "param",
+        "Searches a coefficient in a range, e.g R_g_k_0=0.1:10:8:log, steps default to 5, can be repeated", "name=min:max[:steps][:log]");
+    QCommandLineOption setOption(QStringList() << "s" << "set", "Sets a fixed coefficient, e.g startupTime=2, can be repeated", "name=value");
+    QCommandLineOption randomOption(QStringList() << "random", "Evaluates this many uniformly random sets instead of the grid", "count");
+    QCommandLineOption seedOption(QStringList() << "seed", "Random seed", "seed", "1");
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads", "Number of worker threads, default all cores", "count");
+    QCommandLineOption weightOption(QStringList() << "w" << "displacement-weight", "Degrees of error per meter of displacement error", "weight", "0");
+    QCommandLineOption topOption(QStringList() << "t" << "top", "Number of best sets to list", "count", "5");
+    parser.addOption(rangeOption);
+    parser.addOption(setOption);
+    parser.addOption(randomOption);
+    parser.addOption(seedOption);
+    parser.addOption(threadsOption);
+    parser.addOption(weightOption);
+    parser.addOption(topOption);
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if(args.size() != 2)
+        parser.showHelp(1);
+
+    //Fixed coefficients
+    IMUFusion::Parameters base;
+    qreal startupTime = 1.0f;
+    if(!ToolOptions::applyParameters(parser.values(setOption), base, startupTime))
+        return 1;
+
+    //Searched coefficients
+    std::vector<Range> ranges;
+    for(auto const& spec : parser.values(rangeOption)){
+        Range range;
+        if(!parseRange(spec, range)){
+            std::fprintf(stderr, "Invalid range: %s\n", qPrintable(spec));
+            std::fprintf(stderr, "Known parameters: %s\n", qPrintable(IMUFusion::Parameters::names().join(' ')));
+            return 1;
+        }
+        ranges.push_back(range);
+    }
+    if(ranges.empty()){
+        std::fprintf(stderr, "Nothing to search, give at least one --param\n");
+        return 1;
+    }
+
+    SensorLogReader reader;
+    if(!reader.open(args[0]) || reader.size() == 0){
+        std::fprintf(stderr, "Could not read any samples from %s\n", qPrintable(args[0]));
+        return 1;
+    }
+    std::vector<GroundTruth> truth;
+    if(!loadGroundTruth(args[1], truth)){
+        std::fprintf(stderr, "Could not read ground truth from %s\n", qPrintable(args[1]));
+        return 1;
+    }
+
+    //Generate all sets up front so that results do not depend on the scheduling
+    std::vector<Candidate> candidates;
+    if(parser.isSet(randomOption)){
+        int count = std::max(1, parser.value(randomOption).toInt());
+        std::mt19937 random(parser.value(seedOption).toUInt());
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for(int i = 0; i < count; i++){
+            Candidate candidate = {base, 0};
+            for(auto const& range : ranges)
+                candidate.params.set(range.name, interpolate(range, uniform(random)));
+            candidates.push_back(candidate);
+        }
+    }
+    else{
+        std::vector<int> index(ranges.size(), 0);
+        for(;;){
+            Candidate candidate = {base, 0};
+            for(std::size_t i = 0; i < ranges.size(); i++)
+                candidate.params.set(ranges[i].name,
+                    interpolate(ranges[i], ranges[i].steps > 1 ? index[i]/(double)(ranges[i].steps - 1) : 0.5));
+            candidates.push_back(candidate);
+
+            //Next grid point, odometer style
+            std::size_t i = 0;
+            for(; i < ranges.size() && ++index[i] == ranges[i].steps; i++)
+                index[i] = 0;
+            if(i == ranges.size())
+                break;
+        }
+    }
+
+    //Workers take the next unevaluated set, each with its own fusion core; only the read-only log and truth are shared
+    int numThreads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : (int)std::thread::hardware_concurrency();
+    numThreads = std::max(1, std::min(numThreads, (int)candidates.size()));
+    std::atomic<std::size_t> nextCandidate(0);
+    double displacementWeight = parser.value(weightOption).toDouble();
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> workers;
+    for(int t = 0; t < numThreads; t++)
+        workers.push_back(std::thread([&](){
+            for(std::size_t i = nextCandidate++; i < candidates.size(); i = nextCandidate++)
+                candidates[i].score = score(reader, candidates[i].params, startupTime, truth, displacementWeight);
+        }));
+    for(auto& worker : workers)
+        worker.join();
+    double seconds = timer.nsecsElapsed()*1e-9;
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](Candidate const& lhs, Candidate const& rhs){ return lhs.score < rhs.score; });
+
+    std::printf("evaluated %zu sets on %d threads in %.2f s, %.0f replays/s\n",
+        candidates.size(), numThreads, seconds, candidates.size()/seconds);
+
+    int top = std::max(1, std::min(parser.value(topOption).toInt(), (int)candidates.size()));
+    for(int i = 0; i < top; i++){
+        std::printf("%3d. score %10.4f:", i + 1, candidates[i].score);
+        for(auto const& range : ranges){
+            qreal value;
+            candidates[i].params.get(range.name, value);
+            std::printf("  %s=%g", qPrintable(range.name), value);
+        }
+        std::printf("\n");
+    }
+
+    //Best configuration, ready to paste into the IMU item
+    std::printf("\nIMU {\n");
+    std::printf("    startupTime: %g\n", startupTime);
+    for(auto const& name : IMUFusion::Parameters::names()){
+        qreal value;
+        candidates[0].params.get(name, value);
+        std::printf("    %s: %g\n", qPrintable(name), value);
+    }
+    std::printf("}\n");
+    return 0;
+}
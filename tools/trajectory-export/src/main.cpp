@@ -0,0 +1,67 @@
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+
+#include "TrajectoryLog.h"
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts a trajectory log written by the IMU item or imu-replay to CSV");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Trajectory log written with the trajectoryFile property of IMU or imu-replay --trajectory");
+    parser.addPositionalArgument("output", "CSV file to write, standard output if omitted");
+    QCommandLineOption velocityOption(QStringList() << "v" << "velocity", "Writes the velocity columns as well");
+    parser.addOption(velocityOption);
+    parser.process(app);
+    if(parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    TrajectoryLogReader reader;
+    if(!reader.open(parser.positionalArguments()[0])){
+        std::fprintf(stderr, "Could not read trajectory log %s\n", qPrintable(parser.positionalArguments()[0]));
+        return 1;
+    }
+
+    QFile outputFile;
+    if(parser.positionalArguments().size() > 1){
+        outputFile.setFileName(parser.positionalArguments()[1]);
+        if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)){
+            std::fprintf(stderr, "Could not open %s for writing\n", qPrintable(outputFile.fileName()));
+            return 1;
+        }
+    }
+    else if(!outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text)){
+        std::fprintf(stderr, "Could not write to standard output\n");
+        return 1;
+    }
+
+    //Same columns as imu-replay --output, so that the result can be given to imu-tuner as ground truth
+    bool velocity = parser.isSet(velocityOption);
+    QTextStream output(&outputFile);
+    output << "timestamp,q_w,q_x,q_y,q_z,a_x,a_y,a_z,d_x,d_y,d_z" << (velocity ? ",v_x,v_y,v_z\n" : "\n");
+
+    std::vector<TrajectoryLog::Record> records;
+    quint64 count = 0;
+    while(reader.readChunk(records)){
+        for(TrajectoryLog::Record const& r : records){
+            output << r.timestamp << ','
+                << r.rotation[0] << ',' << r.rotation[1] << ',' << r.rotation[2] << ',' << r.rotation[3] << ','
+                << r.linearAcceleration[0] << ',' << r.linearAcceleration[1] << ',' << r.linearAcceleration[2] << ','
+                << r.dispTranslation[0] << ',' << r.dispTranslation[1] << ',' << r.dispTranslation[2];
+            if(velocity)
+                output << ',' << r.velocity[0] << ',' << r.velocity[1] << ',' << r.velocity[2];
+            output << '\n';
+        }
+        count += records.size();
+    }
+    output.flush();
+
+    std::fprintf(stderr, "%llu states\n", (unsigned long long)count);
+    return 0;
+}
@@ -0,0 +1,11 @@
+TEMPLATE = app
+
+QT = core
+
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+
+#Same fusion core and precision flags as the plugin
+include(../../src/imu-core.pri)
+
+SOURCES += src/main.cpp